@@ -13,12 +13,25 @@
 #include "ttkmd.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <deque>
 #include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <system_error>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -29,12 +42,140 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <elf.h>
 #include <linux/mman.h>
+#include <linux/mempolicy.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
 
 namespace tt {
 
+// Inclusive rectangle of tiles in NOC0 coordinates.
+struct NocRect
+{
+    uint16_t x_start;
+    uint16_t y_start;
+    uint16_t x_end;
+    uint16_t y_end;
+};
+
+// A window dedicated to one tile; see Device::reserve_window().
+struct WindowReservation
+{
+    uint16_t x;
+    uint16_t y;
+    size_t size;
+};
+
+// Host NUMA topology from sysfs.  On single-node hosts, or where the
+// information isn't available, nodes come back as -1 and binding is a no-op.
+class NumaUtils
+{
+    // Parse a sysfs list such as "0-3,8-11".
+    static std::vector<int> read_list(const std::string& path)
+    {
+        std::vector<int> items;
+        FILE* f = fopen(path.c_str(), "r");
+        if (!f) {
+            return items;
+        }
+
+        char line[4096];
+        if (fgets(line, sizeof(line), f)) {
+            for (char* p = line;;) {
+                char* end;
+                int lo = strtol(p, &end, 10);
+                int hi = lo;
+                if (end == p) {
+                    break;
+                }
+                if (*end == '-') {
+                    hi = strtol(end + 1, &end, 10);
+                }
+                for (int i = lo; i <= hi; i++) {
+                    items.push_back(i);
+                }
+                if (*end != ',') {
+                    break;
+                }
+                p = end + 1;
+            }
+        }
+
+        fclose(f);
+        return items;
+    }
+
+public:
+    // Node the PCI function is attached to, or -1.
+    static int get_pci_node(uint64_t domain, uint64_t bus, uint64_t device, uint64_t function)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/bus/pci/devices/%04lx:%02lx:%02lx.%lx/numa_node", domain, bus, device,
+                 function);
+
+        int node = -1;
+        FILE* f = fopen(path, "r");
+        if (f) {
+            if (fscanf(f, "%d", &node) != 1) {
+                node = -1;
+            }
+            fclose(f);
+        }
+        return node;
+    }
+
+    static std::vector<int> get_nodes() { return read_list("/sys/devices/system/node/online"); }
+
+    static std::vector<int> get_node_cpus(int node)
+    {
+        return read_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    }
+
+    // Prefer `node` for pages of [mem, mem + len) not yet faulted in.  Falls
+    // back to other nodes rather than failing when the node is out of memory
+    // (or huge pages).  Returns false if the policy couldn't be applied.
+    static bool bind_memory(void* mem, size_t len, int node)
+    {
+        if (node < 0 || node >= 64) {
+            return false;
+        }
+
+        unsigned long mask = 1UL << node;
+        return syscall(SYS_mbind, mem, len, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0) == 0;
+    }
+
+    // Restrict the calling thread to the CPUs of `node`.
+    static bool pin_thread_to_node(int node)
+    {
+        if (node < 0) {
+            return false;
+        }
+
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu : get_node_cpus(node)) {
+            CPU_SET(cpu, &cpus);
+        }
+
+        return CPU_COUNT(&cpus) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+    }
+};
+
+class CopyEngine;
+class DmaBuffer;
+class Firmware;
+class Kernel;
+
+// A core's kernel arguments, by its NOC0 coordinates; see Device::launch().
+using KernelArgs = std::function<std::vector<uint32_t>(uint16_t x, uint16_t y)>;
+
 // Supports Wormhole and Blackhole architectures.
 class Device
 {
@@ -48,6 +189,41 @@ class Device
     uint64_t pci_bus{0};
     uint64_t pci_device{0};
     uint64_t pci_function{0};
+    int numa_node{-1};
+    uint64_t harvested_tensix_x{0};     // Bit n set: NOC0 column n has no usable Tensix
+    uint64_t harvested_tensix_y{0};     // Bit n set: NOC0 row n has no usable Tensix
+    bool harvesting_known{false};       // The masks came from telemetry or the caller
+    std::vector<WindowReservation> reservations;
+    std::shared_ptr<CopyEngine> copy_engine;
+    std::vector<std::pair<uint16_t, uint16_t>> reserved_cores;
+    std::map<std::pair<uint16_t, uint16_t>, uint64_t> core_images;     // Firmware::get_hash() per core
+
+    // Blackhole telemetry says how many of its 14 Tensix columns are enabled.
+    // With coordinate translation the harvested ones are always the last (15
+    // and 16 on a p100), so the count is enough.  Without telemetry (e.g. a
+    // hung ARC) the harvesting stays unknown.
+    void read_harvesting()
+    {
+        static constexpr uint32_t TAG_ENABLED_TENSIX_COL = 34;
+        static constexpr uint16_t COLUMNS[] = {1, 2, 3, 4, 5, 6, 7, 10, 11, 12, 13, 14, 15, 16};
+        static constexpr size_t NUM_COLUMNS = sizeof(COLUMNS) / sizeof(COLUMNS[0]);
+        uint32_t enabled;
+
+        try {
+            enabled = read_telemetry(TAG_ENABLED_TENSIX_COL);
+        } catch (const std::system_error&) {
+            return;
+        }
+        size_t count = __builtin_popcount(enabled);
+        if (enabled == ~0U || count == 0 || count > NUM_COLUMNS) {
+            return;
+        }
+
+        for (size_t i = count; i < NUM_COLUMNS; i++) {
+            harvested_tensix_x |= 1ULL << COLUMNS[i];
+        }
+        harvesting_known = true;
+    }
 
 public:
     Device(const char* chardev_path)
@@ -72,6 +248,15 @@ public:
         tt_device_get_attr(device, TT_DEVICE_ATTR_PCI_BUS, &pci_bus);
         tt_device_get_attr(device, TT_DEVICE_ATTR_PCI_DEVICE, &pci_device);
         tt_device_get_attr(device, TT_DEVICE_ATTR_PCI_FUNCTION, &pci_function);
+
+        if (is_simulated()) {
+            harvesting_known = true;
+        } else {
+            numa_node = NumaUtils::get_pci_node(pci_domain, pci_bus, pci_device, pci_function);
+            if (is_blackhole()) {
+                read_harvesting();
+            }
+        }
     }
 
     tt_device_t* handle() const { return device; }
@@ -79,6 +264,9 @@ public:
     bool is_wormhole() const { return device_arch == TT_DEVICE_ARCH_WORMHOLE; }
     bool is_blackhole() const { return device_arch == TT_DEVICE_ARCH_BLACKHOLE; }
 
+    // Opened as "sim:<arch>"; see tt_device_open().
+    bool is_simulated() const { return path.rfind("sim:", 0) == 0; }
+
     std::string get_path() const { return path; }
 
     uint64_t get_vendor_id() const { return vendor_id; }
@@ -88,6 +276,22 @@ public:
     uint64_t get_pci_device() const { return pci_device; }
     uint64_t get_pci_function() const { return pci_function; }
 
+    // Host NUMA node the device is attached to, or -1 if unknown.
+    int get_numa_node() const { return numa_node; }
+
+    // Run the calling thread on the device's node; false if it stays unpinned.
+    bool pin_thread_to_local_node() const { return NumaUtils::pin_thread_to_node(numa_node); }
+
+    tt_device_stats_t get_stats() const
+    {
+        tt_device_stats_t stats;
+        int r = tt_device_get_stats(device, &stats);
+        if (r) {
+            throw std::system_error(-r, std::generic_category(), "Failed to get device stats");
+        }
+        return stats;
+    }
+
     uint32_t noc_read32(uint16_t x, uint16_t y, uint64_t addr)
     {
         uint32_t value;
@@ -122,6 +326,219 @@ public:
         }
     }
 
+    // Vectored I/O: descriptors are grouped by tile and page; see tt_noc_readv().
+    void noc_readv(const tt_noc_iov_t* iov, size_t count)
+    {
+        int r = tt_noc_readv(device, iov, count);
+        if (r) {
+            throw std::system_error(-r, std::generic_category(), "Failed to read NOC addresses");
+        }
+    }
+
+    void noc_readv(const std::vector<tt_noc_iov_t>& iov)
+    {
+        noc_readv(iov.data(), iov.size());
+    }
+
+    void noc_writev(const tt_noc_iov_t* iov, size_t count)
+    {
+        int r = tt_noc_writev(device, iov, count);
+        if (r) {
+            throw std::system_error(-r, std::generic_category(), "Failed to write NOC addresses");
+        }
+    }
+
+    void noc_writev(const std::vector<tt_noc_iov_t>& iov)
+    {
+        noc_writev(iov.data(), iov.size());
+    }
+
+    // Multicast to every Tensix tile in rect.  The rectangle is split around
+    // columns and rows that aren't Tensix (or are harvested), so e.g. the whole
+    // Blackhole grid takes two multicasts and Wormhole four.  Throws until the
+    // harvesting is known (see set_harvested_tensix()), rather than writing to
+    // disabled tiles.
+    void noc_multicast_write(NocRect rect, uint64_t addr, const void* src, size_t size)
+    {
+        if (!harvesting_known) {
+            throw std::runtime_error("Tensix harvesting unknown; call set_harvested_tensix() first");
+        }
+        for (const NocRect& r : split_tensix_rect(rect)) {
+            int r_ = tt_noc_multicast_write(device, r.x_start, r.y_start, r.x_end, r.y_end, addr, src, size);
+            if (r_) {
+                throw std::system_error(-r_, std::generic_category(), "Failed to multicast NOC write");
+            }
+        }
+    }
+
+    // Dedicate a window to [0, size) of (x, y); noc_read/noc_write there become
+    // a plain copy with no syscalls.  Few windows are big enough to be worth it
+    // (8 of 4 GiB on Blackhole), so reservations are explicit.
+    void reserve_window(uint16_t x, uint16_t y, size_t size = TT_TLB_SIZE_4G)
+    {
+        int r = tt_noc_reserve(device, x, y, size);
+        if (r) {
+            throw std::system_error(-r, std::generic_category(), "Failed to reserve TLB window");
+        }
+        reservations.push_back({x, y, size});
+    }
+
+    void release_window(uint16_t x, uint16_t y)
+    {
+        int r = tt_noc_unreserve(device, x, y);
+        if (r) {
+            throw std::system_error(-r, std::generic_category(), "Failed to release TLB window");
+        }
+        reservations.erase(std::remove_if(reservations.begin(), reservations.end(),
+                                          [&](const WindowReservation& w) { return w.x == x && w.y == y; }),
+                           reservations.end());
+    }
+
+    // One 4 GiB window per GDDR channel (Blackhole); uses all 8.
+    void reserve_gddr_windows()
+    {
+        for (auto [x, y] : get_gddr_coordinates()) {
+            reserve_window(x, y, TT_TLB_SIZE_4G);
+        }
+    }
+
+    const std::vector<WindowReservation>& get_reserved_windows() const { return reservations; }
+
+    // Cache pins so mapping the same memory again is free; see tt_dma_cache_enable().
+    // Memory given to DmaMapping must then be invalidated before it's freed.
+    void enable_dma_cache(size_t max_pinned_bytes)
+    {
+        int r = tt_dma_cache_enable(device, max_pinned_bytes);
+        if (r) {
+            throw std::system_error(-r, std::generic_category(), "Failed to enable DMA cache");
+        }
+    }
+
+    void disable_dma_cache() { tt_dma_cache_disable(device); }
+
+    // Windows threads calling noc_read() etc. may own between them; see
+    // tt_device_set_thread_window_budget().
+    void set_thread_window_budget(uint64_t windows)
+    {
+        int r = tt_device_set_thread_window_budget(device, windows);
+        if (r) {
+            throw std::system_error(-r, std::generic_category(), "Failed to set thread window budget");
+        }
+    }
+
+    void invalidate_dma_cache(void* addr, size_t len) { tt_dma_cache_invalidate(device, addr, len); }
+
+    // Whether device DMA snoops the CPU caches, so pinned memory needs no cache
+    // maintenance.  x86 hosts always do; elsewhere it's what the device tree
+    // says about the PCIe controller above the device.
+    bool is_dma_coherent() const
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return true;
+#else
+        if (is_simulated()) {
+            return true;
+        }
+
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/bus/pci/devices/%04lx:%02lx:%02lx.%lx", pci_domain, pci_bus, pci_device,
+                 pci_function);
+
+        std::error_code ec;
+        auto dir = std::filesystem::canonical(path, ec);
+        for (; !ec && dir.has_relative_path(); dir = dir.parent_path()) {
+            if (std::filesystem::exists(dir / "of_node" / "dma-coherent", ec)) {
+                return true;
+            }
+        }
+        return false;
+#endif
+    }
+
+    // Columns/rows is_tensix() leaves out.  Blackhole columns are read from
+    // telemetry when the device is opened; this overrides them.  Wormhole
+    // harvesting isn't read, so Tensix multicasts there need it set first.
+    uint64_t get_harvested_tensix_x() const { return harvested_tensix_x; }
+    uint64_t get_harvested_tensix_y() const { return harvested_tensix_y; }
+
+    void set_harvested_tensix(uint64_t x_mask, uint64_t y_mask)
+    {
+        harvested_tensix_x = x_mask;
+        harvested_tensix_y = y_mask;
+        harvesting_known = true;
+    }
+
+    bool is_harvesting_known() const { return harvesting_known; }
+
+    bool is_tensix(uint16_t x, uint16_t y) const
+    {
+        if (x >= 64 || y >= 64 || (harvested_tensix_x >> x) & 1 || (harvested_tensix_y >> y) & 1) {
+            return false;
+        }
+        if (is_wormhole()) {
+            return ((y != 6) && (y >= 1) && (y <= 11)) && ((x != 5) && (x >= 1) && (x <= 9));
+        } else if (is_blackhole()) {
+            return (y >= 2 && y <= 11) && ((x >= 1 && x <= 7) || (x >= 10 && x <= 16));
+        }
+        return false;
+    }
+
+    // Bounding rectangle of the Tensix grid.
+    NocRect get_tensix_rect() const
+    {
+        if (is_wormhole()) {
+            return {1, 1, 9, 11};
+        } else if (is_blackhole()) {
+            return {1, 2, 16, 11};
+        }
+        throw std::runtime_error("Unknown device architecture");
+    }
+
+    // Cover the Tensix tiles of rect with as few rectangles as possible.
+    std::vector<NocRect> split_tensix_rect(NocRect rect) const
+    {
+        // Runs of consecutive columns (rows) that contain Tensix tiles.
+        auto runs = [](uint16_t start, uint16_t end, auto usable) {
+            std::vector<std::pair<uint16_t, uint16_t>> out;
+            for (uint16_t i = start; i <= end; ++i) {
+                if (!usable(i)) {
+                    continue;
+                }
+                if (!out.empty() && out.back().second == i - 1) {
+                    out.back().second = i;
+                } else {
+                    out.push_back({i, i});
+                }
+            }
+            return out;
+        };
+
+        auto xs = runs(rect.x_start, rect.x_end, [&](uint16_t x) {
+            for (uint16_t y = rect.y_start; y <= rect.y_end; ++y) {
+                if (is_tensix(x, y)) {
+                    return true;
+                }
+            }
+            return false;
+        });
+        auto ys = runs(rect.y_start, rect.y_end, [&](uint16_t y) {
+            for (uint16_t x = rect.x_start; x <= rect.x_end; ++x) {
+                if (is_tensix(x, y)) {
+                    return true;
+                }
+            }
+            return false;
+        });
+
+        std::vector<NocRect> out;
+        for (auto [x0, x1] : xs) {
+            for (auto [y0, y1] : ys) {
+                out.push_back({x0, y0, x1, y1});
+            }
+        }
+        return out;
+    }
+
     uint32_t read_telemetry(uint32_t tag)
     {
         auto [ARC_X, ARC_Y] = get_arc_coordinates();
@@ -220,8 +637,81 @@ public:
         throw std::runtime_error("Unknown device architecture");
     }
 
+    // Load the copy engine firmware onto a Tensix core and keep it running;
+    // dma_read() then has the device push data into host memory.  Defaults to
+    // the last free Tensix core in the grid.  Blackhole only, and not on
+    // simulated devices.
+    void start_copy_engine(const std::string& firmware = "tensix/copy_engine.bin");
+    void start_copy_engine(uint16_t x, uint16_t y, const std::string& firmware = "tensix/copy_engine.bin");
+    void stop_copy_engine();
+
+    CopyEngine* get_copy_engine() const { return copy_engine.get(); }
+
+    // Cores running resident firmware (e.g. a CopyEngine); nothing else should
+    // be loaded there.  reserve_core() throws if the core is already taken.
+    void reserve_core(uint16_t x, uint16_t y)
+    {
+        if (is_reserved_core(x, y)) {
+            throw std::runtime_error("Core is already reserved");
+        }
+        reserved_cores.push_back({x, y});
+    }
+
+    void release_core(uint16_t x, uint16_t y)
+    {
+        reserved_cores.erase(std::remove(reserved_cores.begin(), reserved_cores.end(), std::make_pair(x, y)),
+                             reserved_cores.end());
+    }
+
+    bool is_reserved_core(uint16_t x, uint16_t y) const
+    {
+        return std::find(reserved_cores.begin(), reserved_cores.end(), std::make_pair(x, y)) != reserved_cores.end();
+    }
+
+    const std::vector<std::pair<uint16_t, uint16_t>>& get_reserved_cores() const { return reserved_cores; }
+
+    // Load fw into the L1 of (x, y), which should be in reset.  The code is
+    // skipped if the core already has this image, as far as this Device knows;
+    // variables are always rewritten, since the last run may have changed
+    // them.  Returns whether the code was uploaded.
+    bool load_firmware(uint16_t x, uint16_t y, const Firmware& fw);
+
+    // Firmware::get_hash() of the image (x, y) was last loaded with; 0 if
+    // unknown.  Forget it after writing the core's L1 any other way.
+    uint64_t get_core_image(uint16_t x, uint16_t y) const
+    {
+        auto it = core_images.find({x, y});
+        return it == core_images.end() ? 0 : it->second;
+    }
+
+    void set_core_image(uint16_t x, uint16_t y, uint64_t hash) { core_images[{x, y}] = hash; }
+    void forget_core_image(uint16_t x, uint16_t y) { core_images.erase({x, y}); }
+
+    // Run a program on every free Tensix core in grid; see Kernel.  args(x, y)
+    // gives a core its arguments (tensix/kernel.h), none if empty.  The cores
+    // stay reserved until the returned Kernel is destroyed.  Blackhole only.
+    std::unique_ptr<Kernel> launch(NocRect grid, const std::vector<uint8_t>& program, const KernelArgs& args = {});
+    std::unique_ptr<Kernel> launch(NocRect grid, const Firmware& fw, const KernelArgs& args = {});
+
+    // From a file: an ELF if the name ends in .elf, else a raw binary.
+    std::unique_ptr<Kernel> launch(NocRect grid, const std::string& path, const KernelArgs& args = {});
+
+    // Transfers below this size (and anything without a running copy engine, a
+    // NOC address, or 64-byte alignment) use MMIO; see dma_read()/dma_write().
+    static constexpr size_t DMA_ENGINE_MIN_SIZE = 64 * 1024;
+
+    // Read len bytes at addr of (x, y), e.g. a GDDR channel, into buf at off.
+    // Large reads go through the copy engine: the core reads into L1 and writes
+    // over PCIe to the buffer, which is much faster than MMIO reads.
+    void dma_read(uint16_t x, uint16_t y, uint64_t addr, DmaBuffer& buf, size_t off, size_t len);
+
+    // The other direction: the core pulls from buf over PCIe and writes (x, y).
+    // Waits for completion; get_copy_engine()->submit() queues without waiting.
+    void dma_write(uint16_t x, uint16_t y, uint64_t addr, DmaBuffer& buf, size_t off, size_t len);
+
     ~Device()
     {
+        copy_engine.reset();
         tt_device_close(device);
     }
 
@@ -258,8 +748,13 @@ public:
                 << std::setw(4) << device.get_pci_domain()   << ":"
                 << std::setw(2) << device.get_pci_bus()      << ":"
                 << std::setw(2) << device.get_pci_device()   << "."
-                << std::setw(1) << device.get_pci_function() << std::dec
-                << " ---" << std::endl;
+                << std::setw(1) << device.get_pci_function() << std::dec;
+
+        if (device.get_numa_node() >= 0) {
+            std::cout << "  NUMA node: " << device.get_numa_node();
+        }
+
+        std::cout << " ---" << std::endl;
     }
 
     static inline int noc_sanity_check(Device& device)
@@ -377,6 +872,7 @@ public:
     }
 
     // Address must be aligned to the TLB size to map.
+    // Mapping to the window's current target is free (no ioctl).
     void map(uint8_t x, uint8_t y, uint64_t addr)
     {
         int r = tt_tlb_map_unicast(device.handle(), tlb, x, y, addr);
@@ -475,16 +971,7 @@ public:
             uint8_t* src_ptr = (uint8_t*)tlb.get_mmio() + offset;
 
             tlb.map(x, y, aligned_addr);
-
-#if 0
-            memcpy(dst_ptr, src_ptr, chunk_size);
-#else
-            for (size_t i = 0; i < chunk_size / sizeof(uint32_t); ++i) {
-                uint32_t* src32 = (uint32_t*)src_ptr;
-                volatile uint32_t* dst32 = (volatile uint32_t*)dst_ptr;
-                dst32[i] = src32[i];
-            }
-#endif
+            tt_memcpy_from_device(dst_ptr, src_ptr, chunk_size);
 
             dst_ptr += chunk_size;
             len -= chunk_size;
@@ -507,16 +994,7 @@ public:
             uint8_t* dst_ptr = (uint8_t*)tlb.get_mmio() + offset;
 
             tlb.map(x, y, aligned_addr);
-
-#if 0
-            memcpy(dst_ptr, src_ptr, chunk_size);
-#else
-            for (size_t i = 0; i < chunk_size / sizeof(uint32_t); ++i) {
-                uint32_t* src32 = (uint32_t*)src_ptr;
-                volatile uint32_t* dst32 = (volatile uint32_t*)dst_ptr;
-                dst32[i] = src32[i];
-            }
-#endif
+            tt_memcpy_to_device(dst_ptr, src_ptr, chunk_size);
 
             src_ptr += chunk_size;
             len -= chunk_size;
@@ -525,82 +1003,2508 @@ public:
     }
 };
 
-class DmaBuffer
+// NocEngine runs NOC reads and writes on a pool of worker threads.  Each worker
+// owns a private WC TLB window, so workers never contend for a mapping, and a
+// large transfer is split into window-sized chunks that run in parallel.
+//
+// Submitting returns a token; the caller either waits on/polls the token or
+// passes a callback, which runs on a worker thread when the transfer finishes.
+// Buffers must stay valid until then.
+class NocEngine
 {
-    Device& device;
-    tt_dma_t* dma;
-    void* mem;
-    size_t len;
-    uint64_t iova;
-    uint64_t noc_addr;
+public:
+    using Token = uint64_t;
+    using Callback = std::function<void(int status)>;  // status: 0 or -errno
+
+private:
+    struct Transfer
+    {
+        size_t remaining;       // Chunks not yet finished
+        int status{0};          // First error, as -errno
+        bool done{false};
+        Callback callback;
+    };
+
+    struct Chunk
+    {
+        std::shared_ptr<Transfer> transfer;
+        Token token;
+        uint16_t x;
+        uint16_t y;
+        uint64_t addr;
+        uint8_t* buf;
+        size_t len;
+        bool write;
+    };
+
+    size_t window_size;
+    std::vector<std::unique_ptr<TlbWindow>> windows;
+    std::vector<std::thread> workers;
+
+    std::mutex lock;
+    std::condition_variable work_cv;
+    std::condition_variable done_cv;
+    std::deque<Chunk> queue;
+    std::unordered_map<Token, std::shared_ptr<Transfer>> transfers;
+    Token next_token{1};
+    size_t in_flight{0};
+    bool stopping{false};
 
 public:
-    DmaBuffer(Device& device, size_t len, int flags = TT_DMA_FLAG_NOC)
-        : device(device)
-        , mem(MAP_FAILED)
-        , len(len)
-        , iova(~0ULL)
-        , noc_addr(~0ULL)
+    NocEngine(Device& device, size_t num_workers = 4, size_t window_size = TT_TLB_SIZE_2M)
+        : window_size(window_size)
     {
-        if (len % getpagesize() != 0) {
-            throw std::invalid_argument("Buffer size must be a multiple of page size");
+        if (num_workers == 0) {
+            throw std::invalid_argument("NocEngine needs at least one worker");
         }
 
-        if (len % (1ULL << 30) == 0) {
-            mem = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB, -1, 0);
+        // Allocate every window up front so running out of TLBs throws here.
+        for (size_t i = 0; i < num_workers; ++i) {
+            windows.push_back(std::make_unique<TlbWindow>(device, window_size, TT_MMIO_CACHE_MODE_WC));
         }
-
-        if (mem == MAP_FAILED && (len % (1ULL << 21) == 0)) {
-            mem = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        for (size_t i = 0; i < num_workers; ++i) {
+            workers.emplace_back(&NocEngine::worker, this, windows[i].get());
         }
+    }
 
-        if (mem == MAP_FAILED) {
-            mem = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-        }
+    Token submit_write(uint16_t x, uint16_t y, uint64_t addr, const void* src, size_t len, Callback cb = nullptr)
+    {
+        return submit(x, y, addr, const_cast<void*>(src), len, true, std::move(cb));
+    }
 
-        if (mem == MAP_FAILED) {
-            throw std::system_error(errno, std::generic_category(), "Failed to allocate DMA buffer");
-        }
+    Token submit_read(uint16_t x, uint16_t y, uint64_t addr, void* dst, size_t len, Callback cb = nullptr)
+    {
+        return submit(x, y, addr, dst, len, false, std::move(cb));
+    }
 
-        int r = tt_dma_map(device.handle(), mem, len, flags, &dma);
-        if (r) {
-            munmap(mem, len);
-            throw std::system_error(-r, std::generic_category(), "Failed to map DMA buffer");
+    // True once the transfer has finished; throws if it failed.  A finished
+    // token is forgotten, so later calls for it also return true.  Transfers
+    // submitted with a callback aren't tracked: poll() and wait() return at
+    // once for them, and only the callback says when they're done.
+    bool poll(Token token)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        auto it = transfers.find(token);
+        if (it == transfers.end()) {
+            return true;
         }
+        if (!it->second->done) {
+            return false;
+        }
+        return reap(it);
+    }
 
-        r = tt_dma_get_dma_addr(dma, &iova);
-        if (r) {
-            tt_dma_unmap(device.handle(), dma);
-            munmap(mem, len);
-            throw std::system_error(-r, std::generic_category(), "Failed to get DMA address");
+    // Blocks until the transfer has finished; throws if it failed.  If
+    // another thread collects the result first, this just returns.
+    void wait(Token token)
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        auto it = transfers.find(token);
+        if (it == transfers.end()) {
+            return;
         }
+        std::shared_ptr<Transfer> transfer = it->second;
+        done_cv.wait(guard, [&] { return transfer->done; });
 
-        r = tt_dma_get_noc_addr(dma, &noc_addr);
-        if ((flags & (TT_DMA_FLAG_NOC | TT_DMA_FLAG_NOC_TOP_DOWN)) && r) {
-            tt_dma_unmap(device.handle(), dma);
-            munmap(mem, len);
-            throw std::system_error(-r, std::generic_category(), "Failed to get NOC address");
+        it = transfers.find(token);
+        if (it == transfers.end()) {
+            return;
         }
+        reap(it);
     }
 
-    void* get_mem() { return mem; }
-    uint64_t get_iova() const { return iova; }
-    uint64_t get_noc_addr() const { return noc_addr; }
-    size_t get_len() const { return len; }
+    // Blocks until every submitted chunk has finished.  Does not throw; use
+    // wait() or poll() on individual tokens to collect errors.
+    void drain()
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        done_cv.wait(guard, [&] { return queue.empty() && in_flight == 0; });
+    }
 
-    ~DmaBuffer()
+    size_t get_num_workers() const { return workers.size(); }
+
+    ~NocEngine()
     {
-        munmap(mem, len);
-        tt_dma_unmap(device.handle(), dma);
+        drain();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        work_cv.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
     }
 
 private:
-    DmaBuffer(const DmaBuffer&) = delete;
-    DmaBuffer& operator=(const DmaBuffer&) = delete;
-    DmaBuffer(DmaBuffer&&) = delete;
-    DmaBuffer& operator=(DmaBuffer&&) = delete;
-};
+    NocEngine(const NocEngine&) = delete;
+    NocEngine& operator=(const NocEngine&) = delete;
+    NocEngine(NocEngine&&) = delete;
+    NocEngine& operator=(NocEngine&&) = delete;
+
+    Token submit(uint16_t x, uint16_t y, uint64_t addr, void* buf, size_t len, bool write, Callback cb)
+    {
+        if (addr % 4 != 0 || len % 4 != 0) {
+            throw std::invalid_argument("Misaligned");
+        }
 
+        auto transfer = std::make_shared<Transfer>();
+        transfer->callback = std::move(cb);
 
+        // Split on window boundaries so each chunk needs a single mapping.
+        std::vector<Chunk> chunks;
+        uint8_t* ptr = static_cast<uint8_t*>(buf);
+        while (len > 0) {
+            size_t chunk = std::min<size_t>(len, window_size - (addr & (window_size - 1)));
+            chunks.push_back({transfer, 0, x, y, addr, ptr, chunk, write});
+            addr += chunk;
+            ptr += chunk;
+            len -= chunk;
+        }
+
+        std::unique_lock<std::mutex> guard(lock);
+        Token token = next_token++;
+        transfer->remaining = chunks.size();
+
+        if (chunks.empty()) {
+            transfer->done = true;
+        }
+
+        if (!transfer->callback) {
+            transfers.emplace(token, transfer);
+        }
+
+        for (auto& c : chunks) {
+            c.token = token;
+            queue.push_back(std::move(c));
+        }
+        guard.unlock();
+
+        if (chunks.empty() && transfer->callback) {
+            transfer->callback(0);
+        }
+
+        work_cv.notify_all();
+        return token;
+    }
+
+    // Called with the lock held on a finished transfer.
+    bool reap(std::unordered_map<Token, std::shared_ptr<Transfer>>::iterator it)
+    {
+        int status = it->second->status;
+        transfers.erase(it);
+        if (status) {
+            throw std::system_error(-status, std::generic_category(), "NOC transfer failed");
+        }
+        return true;
+    }
+
+    void worker(TlbWindow* window)
+    {
+        TlbWindow& tlb = *window;
+
+        for (;;) {
+            std::unique_lock<std::mutex> guard(lock);
+            work_cv.wait(guard, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            Chunk c = std::move(queue.front());
+            queue.pop_front();
+            in_flight++;
+            guard.unlock();
+
+            int status = 0;
+            try {
+                if (c.write) {
+                    TlbWindowUtils::noc_write(tlb, c.x, c.y, c.addr, c.buf, c.len);
+                } else {
+                    TlbWindowUtils::noc_read(tlb, c.x, c.y, c.addr, c.buf, c.len);
+                }
+            } catch (const std::system_error& e) {
+                status = -e.code().value();
+            }
+
+            guard.lock();
+            Transfer& t = *c.transfer;
+            if (status && !t.status) {
+                t.status = status;
+            }
+            bool finished = --t.remaining == 0;
+            if (finished) {
+                t.done = true;
+            }
+            guard.unlock();
+
+            if (finished && t.callback) {
+                t.callback(t.status);
+            }
+
+            guard.lock();
+            in_flight--;
+            guard.unlock();
+            done_cv.notify_all();
+        }
+    }
+};
+
+// Huge pages set aside for DMA buffers, so a buffer's page count (and so its
+// pinning cost) doesn't depend on what the kernel can find when it's created.
+// For each of 1 GiB and 2 MiB pages the pool reserves up to a configured
+// number of bytes, on construction or on first use, and hands out whole pages.
+// A request the pool can't serve falls back to fresh hugetlb pages, then
+// transparent huge pages (MADV_HUGEPAGE), then ordinary pages.
+//
+// Reserved pages are faulted in on the pool's NUMA node, so a request for a
+// different node skips them; give the pool the device's node to avoid that.
+//
+// Pages returned to the pool are reused without being cleared.
+class HugePagePool
+{
+public:
+    struct Allocation
+    {
+        void* mem{MAP_FAILED};
+        size_t len{0};
+        size_t page_size{0};    // 0: THP, unknown until the pages are faulted in
+        bool pooled{false};
+    };
+
+    struct Stats
+    {
+        size_t reserved_1g;     // Bytes held in 1 GiB pages
+        size_t free_1g;
+        size_t reserved_2m;     // Bytes held in 2 MiB pages
+        size_t free_2m;
+        uint64_t from_pool;     // Allocations by where they came from
+        uint64_t from_hugetlb;
+        uint64_t from_thp;
+        uint64_t from_small_pages;
+    };
+
+private:
+    struct Tier
+    {
+        size_t page_size;
+        int mmap_flags;
+        size_t target;
+        uint8_t* base{nullptr};
+        size_t len{0};
+        std::map<size_t, size_t> free_list;     // offset -> length
+        size_t free_bytes{0};
+        bool reserved{false};
+
+        Tier(size_t page_size, int mmap_flags, size_t target)
+            : page_size(page_size)
+            , mmap_flags(mmap_flags)
+            , target(target)
+        {
+        }
+    };
+
+    static constexpr size_t PAGE_1G = 1ULL << 30;
+    static constexpr size_t PAGE_2M = 1ULL << 21;
+
+    std::mutex mutex;
+    Tier tiers[2];
+    int numa_node;
+    Stats stats{};
+
+    static inline size_t default_1g = 0;
+    static inline size_t default_2m = 0;
+    static inline int default_node = -1;
+
+    // Take as many pages as the system will give, up to the target.
+    void reserve(Tier& t)
+    {
+        t.reserved = true;
+
+        for (size_t pages = t.target / t.page_size; pages > 0; pages /= 2) {
+            size_t len = pages * t.page_size;
+            void* mem = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | t.mmap_flags, -1, 0);
+            if (mem == MAP_FAILED) {
+                continue;
+            }
+
+            // Fault the pages in on the chosen node now rather than at first use.
+            NumaUtils::bind_memory(mem, len, numa_node);
+            t.base = static_cast<uint8_t*>(mem);
+            for (size_t offset = 0; offset < len; offset += t.page_size) {
+                t.base[offset] = 0;
+            }
+
+            t.len = len;
+            t.free_bytes = len;
+            t.free_list.emplace(0, len);
+            return;
+        }
+    }
+
+    bool take(Tier& t, size_t len, Allocation& a)
+    {
+        for (auto it = t.free_list.begin(); it != t.free_list.end(); ++it) {
+            if (it->second < len) {
+                continue;
+            }
+
+            size_t offset = it->first;
+            size_t remainder = it->second - len;
+            t.free_list.erase(it);
+            if (remainder) {
+                t.free_list.emplace(offset + len, remainder);
+            }
+            t.free_bytes -= len;
+
+            a.mem = t.base + offset;
+            a.len = len;
+            a.page_size = t.page_size;
+            a.pooled = true;
+            return true;
+        }
+        return false;
+    }
+
+    void put(Tier& t, size_t offset, size_t len)
+    {
+        t.free_bytes += len;
+
+        auto next = t.free_list.lower_bound(offset);
+        if (next != t.free_list.end() && offset + len == next->first) {
+            len += next->second;
+            next = t.free_list.erase(next);
+        }
+        if (next != t.free_list.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += len;
+                return;
+            }
+        }
+        t.free_list.emplace(offset, len);
+    }
+
+public:
+    // Sizes are rounded down to whole pages.  With reserve_now false, each size
+    // is reserved when a buffer of that page size is first requested.
+    HugePagePool(size_t bytes_1g, size_t bytes_2m, bool reserve_now = true, int numa_node = -1)
+        : tiers{{PAGE_1G, MAP_HUGETLB | MAP_HUGE_1GB, bytes_1g}, {PAGE_2M, MAP_HUGETLB | MAP_HUGE_2MB, bytes_2m}}
+        , numa_node(numa_node)
+    {
+        if (reserve_now) {
+            reserve();
+        }
+    }
+
+    void reserve()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Tier& t : tiers) {
+            if (!t.reserved) {
+                reserve(t);
+            }
+        }
+    }
+
+    // Sizes (and NUMA node, e.g. Device::get_numa_node()) for the pool DmaBuffer
+    // uses by default; takes effect only if called before the first DmaBuffer is
+    // created.  Nothing is reserved by default.
+    static void configure_default(size_t bytes_1g, size_t bytes_2m, int numa_node = -1)
+    {
+        default_1g = bytes_1g;
+        default_2m = bytes_2m;
+        default_node = numa_node;
+    }
+
+    static HugePagePool& get_default()
+    {
+        static HugePagePool pool(default_1g, default_2m, false, default_node);
+        return pool;
+    }
+
+    int get_numa_node() const { return numa_node; }
+
+    // Memory for a buffer wanted on `node` (-1: anywhere); the reservation is
+    // only used if it's on that node.  Throws std::system_error if even
+    // ordinary pages can't be had.
+    Allocation allocate(size_t len, int node = -1)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Allocation a;
+        bool use_reserve = node < 0 || node == numa_node;
+
+        for (Tier& t : tiers) {
+            if (!use_reserve || len % t.page_size != 0 || t.target < t.page_size) {
+                continue;
+            }
+            if (!t.reserved) {
+                reserve(t);
+            }
+            if (take(t, len, a)) {
+                stats.from_pool++;
+                return a;
+            }
+        }
+
+        for (Tier& t : tiers) {
+            if (len % t.page_size != 0) {
+                continue;
+            }
+            a.mem = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | t.mmap_flags, -1, 0);
+            if (a.mem != MAP_FAILED) {
+                a.len = len;
+                a.page_size = t.page_size;
+                stats.from_hugetlb++;
+                return a;
+            }
+        }
+
+        if (len >= PAGE_2M) {
+            // THP needs 2 MiB alignment; over-allocate and trim.
+            size_t map_len = len + PAGE_2M;
+            void* mem = mmap(0, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem != MAP_FAILED) {
+                uintptr_t start = (uintptr_t)mem;
+                uintptr_t aligned = (start + PAGE_2M - 1) & ~(PAGE_2M - 1);
+                if (aligned > start) {
+                    munmap(mem, aligned - start);
+                }
+                munmap((void*)(aligned + len), start + map_len - (aligned + len));
+
+                if (madvise((void*)aligned, len, MADV_HUGEPAGE) == 0) {
+                    a.mem = (void*)aligned;
+                    a.len = len;
+                    a.page_size = 0;
+                    stats.from_thp++;
+                    return a;
+                }
+                munmap((void*)aligned, len);
+            }
+        }
+
+        a.mem = mmap(0, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (a.mem == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "Failed to allocate DMA buffer");
+        }
+        a.len = len;
+        a.page_size = getpagesize();
+        stats.from_small_pages++;
+        return a;
+    }
+
+    void free(const Allocation& a)
+    {
+        if (!a.pooled) {
+            munmap(a.mem, a.len);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Tier& t : tiers) {
+            uint8_t* mem = static_cast<uint8_t*>(a.mem);
+            if (mem >= t.base && mem < t.base + t.len) {
+                put(t, mem - t.base, a.len);
+                return;
+            }
+        }
+    }
+
+    // Page size backing a THP allocation once it has been faulted in: 2 MiB if
+    // its mapping is entirely huge pages, otherwise the base page size.
+    static size_t get_thp_page_size(const void* mem, size_t len)
+    {
+        FILE* f = fopen("/proc/self/smaps", "r");
+        if (!f) {
+            return getpagesize();
+        }
+
+        char line[256];
+        bool in_mapping = false;
+        size_t huge_kb = 0;
+        while (fgets(line, sizeof(line), f)) {
+            unsigned long lo, hi;
+            if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2) {
+                in_mapping = (uintptr_t)mem >= lo && (uintptr_t)mem < hi;
+            } else if (in_mapping && sscanf(line, "AnonHugePages: %zu kB", &huge_kb) == 1) {
+                break;
+            }
+        }
+        fclose(f);
+
+        return huge_kb * 1024 >= len ? PAGE_2M : getpagesize();
+    }
+
+    Stats get_stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats s = stats;
+        s.reserved_1g = tiers[0].len;
+        s.free_1g = tiers[0].free_bytes;
+        s.reserved_2m = tiers[1].len;
+        s.free_2m = tiers[1].free_bytes;
+        return s;
+    }
+
+    ~HugePagePool()
+    {
+        for (Tier& t : tiers) {
+            if (t.base) {
+                munmap(t.base, t.len);
+            }
+        }
+    }
+
+private:
+    HugePagePool(const HugePagePool&) = delete;
+    HugePagePool& operator=(const HugePagePool&) = delete;
+    HugePagePool(HugePagePool&&) = delete;
+    HugePagePool& operator=(HugePagePool&&) = delete;
+};
+
+// Where a DmaBuffer's memory comes from.
+enum class DmaPolicy
+{
+    Pinned,     // Host memory pinned with tt_dma_map()
+    Coherent,   // Allocated by the driver with tt_dma_alloc()
+    Auto,       // Pinned if the host is I/O coherent (coherent as fallback);
+                // otherwise coherent
+};
+
+class DmaBuffer
+{
+    Device& device;
+    HugePagePool& pool;
+    HugePagePool::Allocation alloc;
+    tt_dma_t* dma;
+    void* mem;
+    size_t len;
+    uint64_t iova;
+    uint64_t noc_addr;
+    bool coherent{false};
+
+    void allocate_pinned(int flags, int numa_node)
+    {
+        int node = numa_node == LOCAL_NODE ? device.get_numa_node() : numa_node;
+        alloc = pool.allocate(len, node);
+        mem = alloc.mem;
+
+        // Before the pages are faulted in by pinning (pooled pages already are,
+        // on the node asked for).
+        NumaUtils::bind_memory(mem, len, node);
+
+        int r = tt_dma_map(device.handle(), mem, len, flags, &dma);
+        if (r) {
+            pool.free(alloc);
+            throw std::system_error(-r, std::generic_category(), "Failed to map DMA buffer");
+        }
+
+        r = tt_dma_get_dma_addr(dma, &iova);
+        if (r) {
+            tt_dma_unmap(device.handle(), dma);
+            pool.free(alloc);
+            throw std::system_error(-r, std::generic_category(), "Failed to get DMA address");
+        }
+
+        r = tt_dma_get_noc_addr(dma, &noc_addr);
+        if ((flags & (TT_DMA_FLAG_NOC | TT_DMA_FLAG_NOC_TOP_DOWN)) && r) {
+            tt_dma_unmap(device.handle(), dma);
+            pool.free(alloc);
+            throw std::system_error(-r, std::generic_category(), "Failed to get NOC address");
+        }
+
+        if (alloc.page_size == 0) {
+            alloc.page_size = HugePagePool::get_thp_page_size(mem, len);
+        }
+    }
+
+    void allocate_coherent(int flags)
+    {
+        int r = tt_dma_alloc(device.handle(), len, flags, &dma);
+        if (r) {
+            throw std::system_error(-r, std::generic_category(), "Failed to allocate coherent DMA buffer");
+        }
+
+        tt_dma_get_mem(dma, &mem);
+        tt_dma_get_dma_addr(dma, &iova);
+        tt_dma_get_noc_addr(dma, &noc_addr);
+
+        alloc.mem = mem;
+        alloc.len = len;
+        alloc.page_size = getpagesize();    // Contiguous, but mapped with small pages
+        coherent = true;
+    }
+
+public:
+    static constexpr int LOCAL_NODE = -2;   // The device's NUMA node
+    static constexpr int ANY_NODE = -1;     // Wherever the kernel puts it
+
+    DmaBuffer(Device& device, size_t len, int flags = TT_DMA_FLAG_NOC, int numa_node = LOCAL_NODE,
+              HugePagePool& pool = HugePagePool::get_default())
+        : device(device)
+        , pool(pool)
+        , len(len)
+        , iova(~0ULL)
+        , noc_addr(~0ULL)
+    {
+        if (len % getpagesize() != 0) {
+            throw std::invalid_argument("Buffer size must be a multiple of page size");
+        }
+
+        allocate_pinned(flags, numa_node);
+    }
+
+    DmaBuffer(Device& device, size_t len, DmaPolicy policy, int flags = TT_DMA_FLAG_NOC)
+        : device(device)
+        , pool(HugePagePool::get_default())
+        , len(len)
+        , iova(~0ULL)
+        , noc_addr(~0ULL)
+    {
+        if (len % getpagesize() != 0) {
+            throw std::invalid_argument("Buffer size must be a multiple of page size");
+        }
+
+        if (policy == DmaPolicy::Pinned) {
+            allocate_pinned(flags, LOCAL_NODE);
+            return;
+        }
+        if (policy == DmaPolicy::Coherent || !device.is_dma_coherent()) {
+            allocate_coherent(flags);
+            return;
+        }
+
+        // Both work here.  Pinned memory can be freed, whereas the driver
+        // keeps coherent buffers (256 at most) until the device is closed, so
+        // that's only the fallback.
+        try {
+            allocate_pinned(flags, LOCAL_NODE);
+        } catch (const std::system_error&) {
+            allocate_coherent(flags);
+        }
+    }
+
+    void* get_mem() { return mem; }
+    uint64_t get_iova() const { return iova; }
+    uint64_t get_noc_addr() const { return noc_addr; }
+    size_t get_len() const { return len; }
+
+    // Size of the pages backing the buffer; for THP, as they were when pinned.
+    size_t get_page_size() const { return alloc.page_size; }
+
+    // Whether the pages came from the HugePagePool's reservation.
+    bool is_pooled() const { return alloc.pooled; }
+
+    // Pinned or Coherent: what a DmaPolicy::Auto buffer ended up as.
+    DmaPolicy get_policy() const { return coherent ? DmaPolicy::Coherent : DmaPolicy::Pinned; }
+
+    ~DmaBuffer()
+    {
+        if (coherent) {
+            tt_dma_free(device.handle(), dma);
+            return;
+        }
+
+        tt_dma_unmap(device.handle(), dma);
+        tt_dma_cache_invalidate(device.handle(), mem, len);
+        pool.free(alloc);
+    }
+
+private:
+    DmaBuffer(const DmaBuffer&) = delete;
+    DmaBuffer& operator=(const DmaBuffer&) = delete;
+    DmaBuffer(DmaBuffer&&) = delete;
+    DmaBuffer& operator=(DmaBuffer&&) = delete;
+};
+
+// A word in pinned host memory that firmware writes when its work is done
+// (noc_post_completion() in tensix/noc.h), so the host waits on a local cache
+// line rather than polling MMIO.  Waiting spins briefly, then parks in UMWAIT
+// where the CPU has it (or pauses), then sleeps with exponential backoff.
+class Completion
+{
+    Device& device;
+    DmaBuffer buffer;
+
+    static constexpr int SPIN_POLLS = 1000;
+    static constexpr std::chrono::microseconds PARK_TIME{100};   // UMWAIT/pause, then sleep
+    static constexpr std::chrono::milliseconds MAX_NAP{1};
+
+#if defined(__x86_64__)
+    // Doze until *word changes or about `cycles` TSC ticks pass.
+    __attribute__((target("waitpkg"))) static void umwait(const volatile uint32_t* word, uint32_t seen,
+                                                          uint64_t cycles)
+    {
+        _umonitor(const_cast<uint32_t*>(word));
+        if (*word == seen) {
+            _umwait(0, __rdtsc() + cycles);
+        }
+    }
+#endif
+
+    static void relax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        __asm__ volatile("yield");
+#endif
+    }
+
+public:
+    explicit Completion(Device& device)
+        : device(device)
+        , buffer(device, getpagesize())
+    {
+        reset();
+    }
+
+    // Where firmware writes: this NOC address, through the PCIe tile.
+    uint64_t get_noc_addr() const { return buffer.get_noc_addr(); }
+    std::pair<uint16_t, uint16_t> get_noc_xy() const { return device.get_pcie_coordinates(); }
+
+    volatile uint32_t* get_word() { return static_cast<volatile uint32_t*>(buffer.get_mem()); }
+
+    uint32_t get() { return __atomic_load_n(get_word(), __ATOMIC_ACQUIRE); }
+
+    void reset(uint32_t value = 0) { __atomic_store_n(get_word(), value, __ATOMIC_RELEASE); }
+
+    // Until the word equals value; false on timeout.
+    bool wait(uint32_t value, std::chrono::nanoseconds timeout = std::chrono::seconds(10))
+    {
+        return wait_until(get_word(), [value](uint32_t v) { return v == value; }, timeout);
+    }
+
+    // Until a sequence number in the word reaches seq, allowing for wrap.
+    bool wait_seq(uint32_t seq, std::chrono::nanoseconds timeout = std::chrono::seconds(10))
+    {
+        return wait_until(get_word(), [seq](uint32_t v) { return (int32_t)(v - seq) >= 0; }, timeout);
+    }
+
+    static bool has_umwait()
+    {
+#if defined(__x86_64__)
+        static const bool supported = [] {
+            unsigned a, b, c, d;
+            return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (c & (1 << 5));
+        }();
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    // The adaptive wait, for any word the device writes; done(value) says when.
+    template <typename Done>
+    static bool wait_until(const volatile uint32_t* word, Done done, std::chrono::nanoseconds timeout)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::chrono::microseconds nap{1};
+
+        for (int i = 0; i < SPIN_POLLS; i++) {
+            if (done(__atomic_load_n(word, __ATOMIC_ACQUIRE))) {
+                return true;
+            }
+            relax();
+        }
+
+        for (;;) {
+            uint32_t value = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+            if (done(value)) {
+                return true;
+            }
+
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed >= timeout) {
+                return false;
+            }
+
+            if (elapsed < PARK_TIME) {
+#if defined(__x86_64__)
+                if (has_umwait()) {
+                    umwait(word, value, 10000);
+                    continue;
+                }
+#endif
+                relax();
+                continue;
+            }
+
+            std::this_thread::sleep_for(nap);
+            nap = std::min<std::chrono::microseconds>(nap * 2, MAX_NAP);
+        }
+    }
+
+private:
+    Completion(const Completion&) = delete;
+    Completion& operator=(const Completion&) = delete;
+    Completion(Completion&&) = delete;
+    Completion& operator=(Completion&&) = delete;
+};
+
+// Pins memory the caller owns, e.g. a staging buffer handed to the device
+// repeatedly.  Cheap to recreate with the device's DMA cache enabled.
+class DmaMapping
+{
+    Device& device;
+    tt_dma_t* dma;
+    void* mem;
+    size_t len;
+    uint64_t iova{~0ULL};
+    uint64_t noc_addr{~0ULL};
+
+public:
+    DmaMapping(Device& device, void* mem, size_t len, int flags = TT_DMA_FLAG_NOC)
+        : device(device)
+        , mem(mem)
+        , len(len)
+    {
+        int r = tt_dma_map(device.handle(), mem, len, flags, &dma);
+        if (r) {
+            throw std::system_error(-r, std::generic_category(), "Failed to map DMA buffer");
+        }
+
+        tt_dma_get_dma_addr(dma, &iova);
+        tt_dma_get_noc_addr(dma, &noc_addr);
+    }
+
+    void* get_mem() { return mem; }
+    uint64_t get_iova() const { return iova; }
+    uint64_t get_noc_addr() const { return noc_addr; }
+    size_t get_len() const { return len; }
+
+    ~DmaMapping()
+    {
+        tt_dma_unmap(device.handle(), dma);
+    }
+
+private:
+    DmaMapping(const DmaMapping&) = delete;
+    DmaMapping& operator=(const DmaMapping&) = delete;
+    DmaMapping(DmaMapping&&) = delete;
+    DmaMapping& operator=(DmaMapping&&) = delete;
+};
+
+// Cycles a working set of host buffers through the PCIe tile's NOC-to-host
+// aperture, which is small on Wormhole (0xFFFE0000 bytes, 16 mappings).
+// Buffers are registered once and kept pinned for host DMA (IOVA only); a
+// buffer gets a NOC address when acquired, evicting the least recently used
+// buffers nobody holds if the budget is spent.  A buffer's NOC address, and
+// IOVA, may change each time it comes back into the aperture.
+class NocAperture
+{
+public:
+    using Handle = uint64_t;
+
+    struct Region
+    {
+        uint64_t offset;    // From the start of the aperture
+        size_t len;
+        Handle handle;
+    };
+
+private:
+    struct Entry
+    {
+        void* mem;
+        size_t len;
+        int flags;
+        tt_dma_t* dma{nullptr};
+        bool resident{false};
+        uint64_t iova{~0ULL};
+        uint64_t noc_addr{~0ULL};
+        uint64_t holds{0};
+        uint64_t last_use{0};
+    };
+
+    Device& device;
+    mutable std::mutex mutex;
+    std::unordered_map<Handle, Entry> entries;
+    Handle next_handle{1};
+    uint64_t clock{0};
+    uint64_t aperture_base;
+    uint64_t aperture_size;
+    size_t max_bytes;
+    size_t max_mappings;
+    size_t resident_bytes{0};
+    size_t resident_count{0};
+    uint64_t evictions{0};
+    uint64_t remaps{0};
+
+    void unpin(Entry& e)
+    {
+        if (e.dma) {
+            tt_dma_unmap(device.handle(), e.dma);
+            tt_dma_cache_invalidate(device.handle(), e.mem, e.len);
+            e.dma = nullptr;
+        }
+        if (e.resident) {
+            resident_bytes -= e.len;
+            resident_count--;
+            e.resident = false;
+        }
+        e.iova = ~0ULL;
+        e.noc_addr = ~0ULL;
+    }
+
+    // Replace e's pin with one made with `flags`; returns the tt_dma_map result.
+    int pin(Entry& e, int flags)
+    {
+        unpin(e);
+
+        int r = tt_dma_map(device.handle(), e.mem, e.len, flags, &e.dma);
+        if (r) {
+            e.dma = nullptr;
+            return r;
+        }
+
+        tt_dma_get_dma_addr(e.dma, &e.iova);
+        if (flags != TT_DMA_FLAG_NONE) {
+            tt_dma_get_noc_addr(e.dma, &e.noc_addr);
+            e.resident = true;
+            resident_bytes += e.len;
+            resident_count++;
+        }
+        return 0;
+    }
+
+    // Move the coldest idle resident buffer other than `keep` out of the aperture.
+    bool evict_one(const Entry* keep)
+    {
+        Entry* victim = nullptr;
+        for (auto& [handle, e] : entries) {
+            if (&e != keep && e.resident && e.holds == 0 && (!victim || e.last_use < victim->last_use)) {
+                victim = &e;
+            }
+        }
+
+        if (!victim) {
+            return false;
+        }
+
+        pin(*victim, TT_DMA_FLAG_NONE);     // If this fails it's simply unpinned until next acquire
+        evictions++;
+        return true;
+    }
+
+    Entry& lookup(Handle handle)
+    {
+        auto it = entries.find(handle);
+        if (it == entries.end()) {
+            throw std::invalid_argument("Unknown aperture handle");
+        }
+        return it->second;
+    }
+
+public:
+    // Defaults are the whole aperture; pass less to leave room for other users.
+    NocAperture(Device& device, size_t max_bytes = 0, size_t max_mappings = 16)
+        : device(device)
+        , aperture_base(device.is_wormhole() ? 0x8'0000'0000ULL : 1ULL << 60)
+        , aperture_size(device.is_wormhole() ? 0xFFFE'0000ULL : UINT64_MAX)
+        , max_bytes(max_bytes ? max_bytes : aperture_size)
+        , max_mappings(max_mappings)
+    {
+    }
+
+    // Register page-aligned memory the caller owns; it starts out of the aperture.
+    Handle add(void* mem, size_t len, int flags = TT_DMA_FLAG_NOC)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        Handle handle = next_handle++;
+        Entry& e = entries[handle];
+        e.mem = mem;
+        e.len = len;
+        e.flags = flags;
+
+        int r = pin(e, TT_DMA_FLAG_NONE);
+        if (r) {
+            entries.erase(handle);
+            throw std::system_error(-r, std::generic_category(), "Failed to map DMA buffer");
+        }
+        return handle;
+    }
+
+    void remove(Handle handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        unpin(lookup(handle));
+        entries.erase(handle);
+    }
+
+    // Bring the buffer into the aperture if needed and keep it there until
+    // release().  Returns its NOC address.
+    uint64_t acquire(Handle handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& e = lookup(handle);
+
+        e.last_use = ++clock;
+
+        if (!e.resident) {
+            if (e.len > max_bytes) {
+                throw std::length_error("Buffer is larger than the aperture budget");
+            }
+
+            while (resident_bytes + e.len > max_bytes || resident_count + 1 > max_mappings) {
+                if (!evict_one(&e)) {
+                    throw std::system_error(ENOSPC, std::generic_category(), "NOC aperture budget is held");
+                }
+            }
+
+            // The budget can fit it but the driver's placement may not (e.g.
+            // fragmentation, or other users of the aperture); make more room.
+            int r;
+            while ((r = pin(e, e.flags)) != 0) {
+                if (!evict_one(&e)) {
+                    pin(e, TT_DMA_FLAG_NONE);
+                    throw std::system_error(-r, std::generic_category(), "Failed to map buffer into NOC aperture");
+                }
+            }
+            remaps++;
+        }
+
+        e.holds++;
+        return e.noc_addr;
+    }
+
+    void release(Handle handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& e = lookup(handle);
+        if (e.holds > 0) {
+            e.holds--;
+        }
+    }
+
+    bool is_resident(Handle handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lookup(handle).resident;
+    }
+
+    uint64_t get_iova(Handle handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lookup(handle).iova;
+    }
+
+    size_t get_resident_bytes() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return resident_bytes;
+    }
+
+    size_t get_resident_count() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return resident_count;
+    }
+
+    size_t get_budget_bytes() const { return max_bytes; }
+    size_t get_budget_mappings() const { return max_mappings; }
+
+    uint64_t get_evictions() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return evictions;
+    }
+
+    uint64_t get_remaps() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return remaps;
+    }
+
+    // Resident buffers by aperture offset.
+    std::vector<Region> get_layout() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::vector<Region> layout;
+        for (auto& [handle, e] : entries) {
+            if (e.resident) {
+                layout.push_back({e.noc_addr - aperture_base, e.len, handle});
+            }
+        }
+        std::sort(layout.begin(), layout.end(), [](const Region& a, const Region& b) { return a.offset < b.offset; });
+        return layout;
+    }
+
+    // Largest gap between this manager's buffers.  Other users of the aperture
+    // aren't visible, so this is an upper bound.
+    uint64_t get_largest_free() const { return largest_free(get_layout()); }
+
+    // 0 when the free space is one extent, approaching 1 as it splinters.
+    double get_fragmentation() const
+    {
+        std::vector<Region> layout = get_layout();
+        uint64_t free = aperture_size;
+        for (const Region& r : layout) {
+            free -= r.len;
+        }
+        return free ? 1.0 - (double)largest_free(layout) / (double)free : 0.0;
+    }
+
+    ~NocAperture()
+    {
+        for (auto& [handle, e] : entries) {
+            unpin(e);
+        }
+    }
+
+private:
+    // One snapshot of the layout, so a concurrent acquire() can't skew it.
+    uint64_t largest_free(const std::vector<Region>& layout) const
+    {
+        uint64_t limit = aperture_size;
+        uint64_t cursor = 0;
+        uint64_t largest = 0;
+
+        for (const Region& r : layout) {
+            if (r.offset > cursor) {
+                largest = std::max(largest, r.offset - cursor);
+            }
+            cursor = std::max<uint64_t>(cursor, r.offset + r.len);
+        }
+        if (limit > cursor) {
+            largest = std::max(largest, limit - cursor);
+        }
+        return largest;
+    }
+
+    NocAperture(const NocAperture&) = delete;
+    NocAperture& operator=(const NocAperture&) = delete;
+    NocAperture(NocAperture&&) = delete;
+    NocAperture& operator=(NocAperture&&) = delete;
+};
+
+class DmaArena;
+
+// Part of a DmaArena; returned to the arena when destroyed.
+class DmaSlice
+{
+    DmaArena& arena;
+    size_t offset;
+    size_t len;
+    void* mem;
+    uint64_t iova;
+    uint64_t noc_addr;
+
+    friend class DmaArena;
+
+    DmaSlice(DmaArena& arena, size_t offset, size_t len, void* mem, uint64_t iova, uint64_t noc_addr)
+        : arena(arena)
+        , offset(offset)
+        , len(len)
+        , mem(mem)
+        , iova(iova)
+        , noc_addr(noc_addr)
+    {
+    }
+
+public:
+    void* get_mem() { return mem; }
+    uint64_t get_iova() const { return iova; }
+    uint64_t get_noc_addr() const { return noc_addr; }
+    size_t get_len() const { return len; }
+    size_t get_offset() const { return offset; }
+
+    inline ~DmaSlice();
+
+private:
+    DmaSlice(const DmaSlice&) = delete;
+    DmaSlice& operator=(const DmaSlice&) = delete;
+    DmaSlice(DmaSlice&&) = delete;
+    DmaSlice& operator=(DmaSlice&&) = delete;
+};
+
+// One DmaBuffer, pinned once, handed out in pieces.  Allocating and freeing a
+// DmaSlice is a first-fit search of an address-ordered free list (neighbours
+// coalesce on free) and costs no syscalls.  The arena must outlive its slices.
+class DmaArena
+{
+    DmaBuffer buffer;
+    std::mutex mutex;
+    std::map<size_t, size_t> free_list;     // offset -> length
+    size_t free_bytes;
+
+    friend class DmaSlice;
+
+    void release(size_t offset, size_t len)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        free_bytes += len;
+
+        auto next = free_list.lower_bound(offset);
+        if (next != free_list.end() && offset + len == next->first) {
+            len += next->second;
+            next = free_list.erase(next);
+        }
+        if (next != free_list.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += len;
+                return;
+            }
+        }
+        free_list.emplace(offset, len);
+    }
+
+public:
+    DmaArena(Device& device, size_t len, int flags = TT_DMA_FLAG_NOC)
+        : buffer(device, len, flags)
+        , free_bytes(len)
+    {
+        free_list.emplace(0, len);
+    }
+
+    // Throws std::bad_alloc if no free range fits.  alignment: power of two.
+    std::unique_ptr<DmaSlice> allocate(size_t len, size_t alignment = 4096)
+    {
+        if (len == 0 || (alignment & (alignment - 1)) != 0) {
+            throw std::invalid_argument("Bad DMA slice size or alignment");
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (auto it = free_list.begin(); it != free_list.end(); ++it) {
+            size_t start = it->first;
+            size_t end = start + it->second;
+            size_t offset = (start + alignment - 1) & ~(alignment - 1);
+
+            if (offset >= end || end - offset < len) {
+                continue;
+            }
+
+            free_list.erase(it);
+            if (offset > start) {
+                free_list.emplace(start, offset - start);
+            }
+            if (offset + len < end) {
+                free_list.emplace(offset + len, end - (offset + len));
+            }
+            free_bytes -= len;
+
+            uint64_t noc = buffer.get_noc_addr() == ~0ULL ? ~0ULL : buffer.get_noc_addr() + offset;
+            return std::unique_ptr<DmaSlice>(new DmaSlice(*this, offset, len,
+                                                          static_cast<uint8_t*>(buffer.get_mem()) + offset,
+                                                          buffer.get_iova() + offset, noc));
+        }
+
+        throw std::bad_alloc();
+    }
+
+    size_t get_len() const { return buffer.get_len(); }
+
+    size_t get_free_bytes()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return free_bytes;
+    }
+
+    // Number of free ranges; 1 when nothing is allocated.
+    size_t get_free_ranges()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return free_list.size();
+    }
+
+    DmaBuffer& get_buffer() { return buffer; }
+
+private:
+    DmaArena(const DmaArena&) = delete;
+    DmaArena& operator=(const DmaArena&) = delete;
+    DmaArena(DmaArena&&) = delete;
+    DmaArena& operator=(DmaArena&&) = delete;
+};
+
+inline DmaSlice::~DmaSlice()
+{
+    arena.release(offset, len);
+}
+
+// A raw firmware image (objcopy -O binary), to be loaded at L1 address 0.
+inline std::vector<uint8_t> read_firmware(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Error opening " + path);
+    }
+
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    std::vector<uint8_t> data(size);
+    if (!file.read(reinterpret_cast<char*>(data.data()), size)) {
+        throw std::runtime_error("Error reading from " + path);
+    }
+
+    return data;
+}
+
+// A Tensix firmware ELF (tensix/*.elf).  Only PT_LOAD segments are loaded,
+// zero-filled past their file contents (.bss), and the host finds the
+// firmware's variables by symbol name rather than at L1 addresses copied by
+// hand.  get_hash() identifies the image, so code a core already has needn't
+// be uploaded again; see Device::load_firmware().
+class Firmware
+{
+public:
+    struct Segment
+    {
+        uint32_t addr;
+        std::vector<uint8_t> data;  // The segment's whole memory size, padded to words
+        bool writable;
+    };
+
+private:
+    std::string path;
+    std::vector<Segment> segments;
+    std::unordered_map<std::string, uint32_t> symbols;
+    uint64_t hash{14695981039346656037ULL};     // FNV-1a over the segments
+
+    [[noreturn]] void malformed(const std::string& what) const { throw std::runtime_error(path + ": " + what); }
+
+    void hash_bytes(const void* p, size_t n)
+    {
+        for (size_t i = 0; i < n; i++) {
+            hash = (hash ^ static_cast<const uint8_t*>(p)[i]) * 1099511628211ULL;
+        }
+    }
+
+public:
+    explicit Firmware(const std::string& path)
+        : path(path)
+    {
+        std::vector<uint8_t> elf = read_firmware(path);
+        auto in_file = [&](uint64_t off, uint64_t len) { return off <= elf.size() && len <= elf.size() - off; };
+
+        Elf32_Ehdr eh;
+        if (!in_file(0, sizeof(eh)) || memcmp(elf.data(), ELFMAG, SELFMAG) != 0) {
+            malformed("not an ELF file");
+        }
+        memcpy(&eh, elf.data(), sizeof(eh));
+        if (eh.e_ident[EI_CLASS] != ELFCLASS32 || eh.e_ident[EI_DATA] != ELFDATA2LSB || eh.e_machine != EM_RISCV) {
+            malformed("not a 32-bit RISC-V ELF");
+        }
+        if (eh.e_entry != 0) {
+            malformed("entry point must be 0, where the core starts");
+        }
+        if (eh.e_phentsize != sizeof(Elf32_Phdr) || !in_file(eh.e_phoff, (uint64_t)eh.e_phnum * sizeof(Elf32_Phdr))) {
+            malformed("bad program headers");
+        }
+
+        for (size_t i = 0; i < eh.e_phnum; i++) {
+            Elf32_Phdr ph;
+            memcpy(&ph, elf.data() + eh.e_phoff + i * sizeof(ph), sizeof(ph));
+            if (ph.p_type != PT_LOAD || ph.p_memsz == 0) {
+                continue;
+            }
+            if (ph.p_filesz > ph.p_memsz || !in_file(ph.p_offset, ph.p_filesz) || (ph.p_paddr & 3) != 0) {
+                malformed("bad loadable segment");
+            }
+
+            const uint8_t* contents = elf.data() + ph.p_offset;
+            Segment seg{ph.p_paddr, std::vector<uint8_t>(contents, contents + ph.p_filesz), (ph.p_flags & PF_W) != 0};
+            seg.data.resize((ph.p_memsz + 3) & ~3u, 0);
+            hash_bytes(&seg.addr, sizeof(seg.addr));
+            hash_bytes(seg.data.data(), seg.data.size());
+            segments.push_back(std::move(seg));
+        }
+        if (segments.empty()) {
+            malformed("nothing to load");
+        }
+
+        // Symbols from .symtab, if it wasn't stripped.
+        if (eh.e_shentsize != sizeof(Elf32_Shdr) || !in_file(eh.e_shoff, (uint64_t)eh.e_shnum * sizeof(Elf32_Shdr))) {
+            return;
+        }
+        std::vector<Elf32_Shdr> sections(eh.e_shnum);
+        memcpy(sections.data(), elf.data() + eh.e_shoff, eh.e_shnum * sizeof(Elf32_Shdr));
+
+        for (const Elf32_Shdr& symtab : sections) {
+            if (symtab.sh_type != SHT_SYMTAB || symtab.sh_link >= sections.size()) {
+                continue;
+            }
+            const Elf32_Shdr& strtab = sections[symtab.sh_link];
+            if (!in_file(symtab.sh_offset, symtab.sh_size) || !in_file(strtab.sh_offset, strtab.sh_size)) {
+                malformed("bad symbol table");
+            }
+            const char* names = reinterpret_cast<const char*>(elf.data() + strtab.sh_offset);
+
+            for (size_t off = 0; off + sizeof(Elf32_Sym) <= symtab.sh_size; off += sizeof(Elf32_Sym)) {
+                Elf32_Sym sym;
+                memcpy(&sym, elf.data() + symtab.sh_offset + off, sizeof(sym));
+                int type = ELF32_ST_TYPE(sym.st_info);
+                if (sym.st_name == 0 || sym.st_name >= strtab.sh_size || type == STT_SECTION || type == STT_FILE) {
+                    continue;
+                }
+
+                // Globals win over file-local statics of the same name.
+                std::string name(names + sym.st_name, strnlen(names + sym.st_name, strtab.sh_size - sym.st_name));
+                if (ELF32_ST_BIND(sym.st_info) == STB_GLOBAL) {
+                    symbols[name] = sym.st_value;
+                } else {
+                    symbols.emplace(name, sym.st_value);
+                }
+            }
+        }
+    }
+
+    const std::string& get_path() const { return path; }
+    const std::vector<Segment>& get_segments() const { return segments; }
+    uint64_t get_hash() const { return hash; }
+
+    // One past the last byte of L1 the image uses.
+    uint32_t get_end() const
+    {
+        uint32_t end = 0;
+        for (const Segment& seg : segments) {
+            end = std::max<uint32_t>(end, seg.addr + seg.data.size());
+        }
+        return end;
+    }
+
+    bool has_symbol(const std::string& name) const { return symbols.count(name) != 0; }
+
+    uint32_t get_symbol(const std::string& name) const
+    {
+        auto it = symbols.find(name);
+        if (it == symbols.end()) {
+            malformed("no symbol " + name);
+        }
+        return it->second;
+    }
+};
+
+inline bool Device::load_firmware(uint16_t x, uint16_t y, const Firmware& fw)
+{
+    bool cached = get_core_image(x, y) == fw.get_hash();
+
+    forget_core_image(x, y);
+    for (const Firmware::Segment& seg : fw.get_segments()) {
+        if (seg.writable || !cached) {
+            noc_write(x, y, seg.addr, seg.data.data(), seg.data.size());
+        }
+    }
+    set_core_image(x, y, fw.get_hash());
+
+    return !cached;
+}
+
+// Host side of tensix/copy_engine.c: a Tensix core that copies between NOC
+// endpoints.  Copies are queued as descriptors in a ring in pinned host memory
+// and the core works through them on its own, writing the number it has
+// finished to a host completion word.  Submitting costs one posted MMIO write
+// and waiting costs none, so a thread can queue uploads and move on.
+// Blackhole only.
+class CopyEngine
+{
+    static constexpr uint64_t TENSIX_RESET_REG = 0xFFB121B0;
+    static constexpr uint32_t TENSIX_IN_RESET = 0x47800;
+    static constexpr uint32_t TENSIX_OUT_RESET = 0x47000;
+
+    // Mailbox; must match tensix/copy_engine.c.
+    static constexpr uint64_t MAILBOX = 0x10000;
+    static constexpr uint64_t STATUS = MAILBOX + 0x00;
+    static constexpr uint64_t RING_TAIL = MAILBOX + 0x04;
+    static constexpr uint64_t RING_HEAD = MAILBOX + 0x08;
+    static constexpr uint64_t CYCLES = MAILBOX + 0x28;      // Then BYTES at +8
+    static constexpr uint32_t STATUS_READY = 0xC0B1E5ED;
+
+    static constexpr std::chrono::seconds TIMEOUT{10};
+
+    // One copy; must match struct copy_desc in tensix/copy_engine.c.
+    struct Descriptor
+    {
+        uint32_t src_lo;
+        uint32_t src_mid;
+        uint32_t src_xy;
+        uint32_t dst_lo;
+        uint32_t dst_mid;
+        uint32_t dst_xy;
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    Device& device;
+    uint16_t x;
+    uint16_t y;
+    size_t entries;
+    DmaBuffer ring;         // Descriptors, then the completion word
+    uint32_t tail{0};       // Descriptors submitted
+    std::mutex mutex;
+
+    static uint32_t noc_xy(uint16_t x, uint16_t y) { return (y << 6) | x; }
+
+    static size_t ring_bytes(size_t entries)
+    {
+        size_t page = getpagesize();
+        return (entries * sizeof(Descriptor) + sizeof(uint32_t) + page - 1) / page * page;
+    }
+
+    Descriptor* descriptors() { return static_cast<Descriptor*>(ring.get_mem()); }
+
+    volatile uint32_t* completion_word()
+    {
+        return reinterpret_cast<volatile uint32_t*>(descriptors() + entries);
+    }
+
+public:
+    // Largest single descriptor; submit() splits bigger copies.
+    static constexpr size_t MAX_COPY_SIZE = 1ULL << 30;
+
+    CopyEngine(Device& device, uint16_t x, uint16_t y, const std::string& firmware = "tensix/copy_engine.bin",
+               size_t entries = 256)
+        : device(device)
+        , x(x)
+        , y(y)
+        , entries(entries)
+        , ring(device, ring_bytes(entries))
+    {
+        if (!device.is_blackhole()) {
+            throw std::runtime_error("Copy engine firmware is Blackhole only");
+        }
+        if (device.is_simulated()) {
+            throw std::runtime_error("Simulated devices can't run firmware");
+        }
+        if (!device.is_tensix(x, y)) {
+            throw std::invalid_argument("Copy engine must run on a Tensix core");
+        }
+        if (entries < 2 || (entries & (entries - 1)) != 0) {
+            throw std::invalid_argument("Ring size must be a power of two, at least 2");
+        }
+
+        std::vector<uint8_t> program = read_firmware(firmware);
+        uint64_t ring_noc = ring.get_noc_addr();
+        uint64_t completion_noc = ring_noc + entries * sizeof(Descriptor);
+
+        *completion_word() = 0;
+
+        device.reserve_core(x, y);
+        try {
+            start(program, ring_noc, completion_noc);
+        } catch (...) {
+            device.release_core(x, y);
+            throw;
+        }
+    }
+
+    uint16_t get_x() const { return x; }
+    uint16_t get_y() const { return y; }
+    size_t get_ring_entries() const { return entries; }
+
+    // Queue a copy of len bytes from src_addr of (src_x, src_y) to dst_addr of
+    // (dst_x, dst_y) and return a ticket for wait()/is_done().  Host memory is
+    // addressed through the PCIe tile with DmaBuffer::get_noc_addr().  Addresses
+    // and len should be 64-byte aligned.  Blocks only while the ring is full.
+    uint32_t submit(uint16_t src_x, uint16_t src_y, uint64_t src_addr, uint16_t dst_x, uint16_t dst_y,
+                    uint64_t dst_addr, size_t len)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for (size_t done = 0; done < len;) {
+            size_t chunk = std::min(len - done, MAX_COPY_SIZE);
+            uint64_t src = src_addr + done;
+            uint64_t dst = dst_addr + done;
+
+            // Full: wait for the core to retire the oldest descriptor.
+            wait_for(tail - entries + 1);
+
+            descriptors()[tail & (entries - 1)] = {
+                (uint32_t)src, (uint32_t)(src >> 32), noc_xy(src_x, src_y),
+                (uint32_t)dst, (uint32_t)(dst >> 32), noc_xy(dst_x, dst_y),
+                (uint32_t)chunk, 0,
+            };
+            tail++;
+            done += chunk;
+
+            // Publish in batches once the ring is half full; otherwise at the end.
+            if (done < len && (tail & (entries / 2 - 1)) != 0) {
+                continue;
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            device.noc_write32(x, y, RING_TAIL, tail);
+        }
+
+        return tail;
+    }
+
+    // Descriptors the core has finished; a ticket is done once this reaches it.
+    uint32_t get_completed() { return __atomic_load_n(completion_word(), __ATOMIC_ACQUIRE); }
+
+    bool is_done(uint32_t ticket) { return (int32_t)(get_completed() - ticket) >= 0; }
+
+    void wait(uint32_t ticket) { wait_for(ticket); }
+
+    // Core clock cycles spent copying, and bytes copied, since the firmware
+    // started; read over MMIO.
+    std::pair<uint64_t, uint64_t> get_counters()
+    {
+        uint32_t words[4];
+        device.noc_read(x, y, CYCLES, words, sizeof(words));
+        return {((uint64_t)words[1] << 32) | words[0], ((uint64_t)words[3] << 32) | words[2]};
+    }
+
+    double get_cycles_per_byte()
+    {
+        auto [cycles, bytes] = get_counters();
+        return bytes ? (double)cycles / bytes : 0;
+    }
+
+    // Synchronous submit().
+    void copy(uint16_t src_x, uint16_t src_y, uint64_t src_addr, uint16_t dst_x, uint16_t dst_y, uint64_t dst_addr,
+              size_t len)
+    {
+        wait(submit(src_x, src_y, src_addr, dst_x, dst_y, dst_addr, len));
+    }
+
+    ~CopyEngine()
+    {
+        try {
+            device.noc_write32(x, y, TENSIX_RESET_REG, TENSIX_IN_RESET);
+        } catch (const std::exception&) {
+        }
+        device.release_core(x, y);
+    }
+
+private:
+    void start(const std::vector<uint8_t>& program, uint64_t ring_noc, uint64_t completion_noc)
+    {
+        auto [pcie_x, pcie_y] = device.get_pcie_coordinates();
+
+        device.noc_write32(x, y, TENSIX_RESET_REG, TENSIX_IN_RESET);
+        device.forget_core_image(x, y);
+        device.noc_write(x, y, 0x0, program.data(), program.size());
+
+        // STATUS, RING_TAIL, RING_HEAD, ring, entries, completion word
+        uint32_t mailbox[10] = {
+            0, 0, 0,
+            (uint32_t)ring_noc, (uint32_t)(ring_noc >> 32), noc_xy(pcie_x, pcie_y),
+            (uint32_t)entries,
+            (uint32_t)completion_noc, (uint32_t)(completion_noc >> 32), noc_xy(pcie_x, pcie_y),
+        };
+        device.noc_write(x, y, MAILBOX, mailbox, sizeof(mailbox));
+
+        device.noc_write32(x, y, TENSIX_RESET_REG, TENSIX_OUT_RESET);
+
+        auto deadline = std::chrono::steady_clock::now() + TIMEOUT;
+        while (device.noc_read32(x, y, STATUS) != STATUS_READY) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                device.noc_write32(x, y, TENSIX_RESET_REG, TENSIX_IN_RESET);
+                throw std::runtime_error("Copy engine firmware did not start");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void wait_for(uint32_t ticket)
+    {
+        auto done = [ticket](uint32_t completed) { return (int32_t)(completed - ticket) >= 0; };
+        if (!Completion::wait_until(completion_word(), done, TIMEOUT)) {
+            throw std::runtime_error("Copy engine timed out");
+        }
+    }
+
+    CopyEngine(const CopyEngine&) = delete;
+    CopyEngine& operator=(const CopyEngine&) = delete;
+    CopyEngine(CopyEngine&&) = delete;
+    CopyEngine& operator=(CopyEngine&&) = delete;
+};
+
+inline void Device::start_copy_engine(const std::string& firmware)
+{
+    NocRect rect = get_tensix_rect();
+
+    for (int y = rect.y_end; y >= rect.y_start; y--) {
+        for (int x = rect.x_end; x >= rect.x_start; x--) {
+            if (is_tensix(x, y) && !is_reserved_core(x, y)) {
+                start_copy_engine(x, y, firmware);
+                return;
+            }
+        }
+    }
+    throw std::runtime_error("No Tensix core for the copy engine");
+}
+
+inline void Device::start_copy_engine(uint16_t x, uint16_t y, const std::string& firmware)
+{
+    copy_engine.reset();
+    copy_engine = std::make_shared<CopyEngine>(*this, x, y, firmware);
+}
+
+inline void Device::stop_copy_engine()
+{
+    copy_engine.reset();
+}
+
+inline void Device::dma_read(uint16_t x, uint16_t y, uint64_t addr, DmaBuffer& buf, size_t off, size_t len)
+{
+    if (off > buf.get_len() || len > buf.get_len() - off) {
+        throw std::invalid_argument("Read exceeds DMA buffer");
+    }
+
+    bool aligned = ((addr | off | len) & 63) == 0;
+    if (!copy_engine || len < DMA_ENGINE_MIN_SIZE || buf.get_noc_addr() == ~0ULL || !aligned) {
+        noc_read(x, y, addr, static_cast<uint8_t*>(buf.get_mem()) + off, len);
+        return;
+    }
+
+    auto [pcie_x, pcie_y] = get_pcie_coordinates();
+    copy_engine->copy(x, y, addr, pcie_x, pcie_y, buf.get_noc_addr() + off, len);
+}
+
+inline void Device::dma_write(uint16_t x, uint16_t y, uint64_t addr, DmaBuffer& buf, size_t off, size_t len)
+{
+    if (off > buf.get_len() || len > buf.get_len() - off) {
+        throw std::invalid_argument("Write exceeds DMA buffer");
+    }
+
+    bool aligned = ((addr | off | len) & 63) == 0;
+    if (!copy_engine || len < DMA_ENGINE_MIN_SIZE || buf.get_noc_addr() == ~0ULL || !aligned) {
+        noc_write(x, y, addr, static_cast<uint8_t*>(buf.get_mem()) + off, len);
+        return;
+    }
+
+    auto [pcie_x, pcie_y] = get_pcie_coordinates();
+    copy_engine->copy(pcie_x, pcie_y, buf.get_noc_addr() + off, x, y, addr, len);
+}
+
+
+
+// Copy engines on several cores working on one transfer, for bandwidth one
+// core can't reach.  GDDR data is interleaved across channels a stripe at a
+// time: stripe k of a transfer lives on channel k % M at addr + (k / M) *
+// stripe, and engine k % N moves it.  With N a multiple of M each engine only
+// talks to one channel, and engines start on the free Tensix cores nearest
+// their channel.  Blackhole only.
+class CopyEngineGroup
+{
+public:
+    // One stripe in flight: which engine has it, and that engine's ticket.
+    struct Shard
+    {
+        size_t engine;
+        uint32_t ticket;
+    };
+
+    struct Transfer
+    {
+        std::vector<Shard> shards;
+    };
+
+private:
+    Device& device;
+    std::vector<std::pair<uint16_t, uint16_t>> channels;
+    std::vector<std::unique_ptr<CopyEngine>> engines;
+    size_t stripe;
+
+    // Free Tensix core closest (in NOC hops) to (x, y).
+    std::pair<uint16_t, uint16_t> nearest_core(uint16_t x, uint16_t y) const
+    {
+        NocRect rect = device.get_tensix_rect();
+        std::pair<uint16_t, uint16_t> best{0, 0};
+        int best_distance = std::numeric_limits<int>::max();
+
+        for (uint16_t cy = rect.y_start; cy <= rect.y_end; cy++) {
+            for (uint16_t cx = rect.x_start; cx <= rect.x_end; cx++) {
+                if (!device.is_tensix(cx, cy) || device.is_reserved_core(cx, cy)) {
+                    continue;
+                }
+                int distance = std::abs(cx - x) + std::abs(cy - y);
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best = {cx, cy};
+                }
+            }
+        }
+
+        if (best_distance == std::numeric_limits<int>::max()) {
+            throw std::runtime_error("No free Tensix core for a copy engine");
+        }
+        return best;
+    }
+
+    Transfer submit(uint64_t addr, DmaBuffer& buf, size_t off, size_t len, bool read)
+    {
+        if (off > buf.get_len() || len > buf.get_len() - off) {
+            throw std::invalid_argument("Transfer exceeds DMA buffer");
+        }
+        if (((addr | off | len) & 63) != 0 || buf.get_noc_addr() == ~0ULL) {
+            throw std::invalid_argument("Transfer must be 64-byte aligned and NOC-mapped");
+        }
+
+        auto [pcie_x, pcie_y] = device.get_pcie_coordinates();
+        Transfer transfer;
+
+        for (size_t k = 0; k * stripe < len; k++) {
+            size_t n = std::min(stripe, len - k * stripe);
+            auto [gddr_x, gddr_y] = channels[k % channels.size()];
+            uint64_t gddr_addr = addr + (k / channels.size()) * stripe;
+            uint64_t host_addr = buf.get_noc_addr() + off + k * stripe;
+            size_t e = k % engines.size();
+
+            uint32_t ticket = read ? engines[e]->submit(gddr_x, gddr_y, gddr_addr, pcie_x, pcie_y, host_addr, n)
+                                   : engines[e]->submit(pcie_x, pcie_y, host_addr, gddr_x, gddr_y, gddr_addr, n);
+            transfer.shards.push_back({e, ticket});
+        }
+
+        return transfer;
+    }
+
+public:
+    CopyEngineGroup(Device& device, size_t cores, size_t num_channels, size_t stripe = 1 << 20,
+                    const std::string& firmware = "tensix/copy_engine.bin")
+        : device(device)
+        , stripe(stripe)
+    {
+        std::vector<std::pair<uint16_t, uint16_t>> gddr = device.get_gddr_coordinates();
+
+        if (cores == 0 || num_channels == 0 || num_channels > gddr.size()) {
+            throw std::invalid_argument("Bad copy engine core or channel count");
+        }
+        if (stripe == 0 || stripe % 64 != 0) {
+            throw std::invalid_argument("Stripe must be a non-zero multiple of 64 bytes");
+        }
+
+        channels.assign(gddr.begin(), gddr.begin() + num_channels);
+        for (size_t i = 0; i < cores; i++) {
+            auto [x, y] = nearest_core(channels[i % channels.size()].first, channels[i % channels.size()].second);
+            engines.push_back(std::make_unique<CopyEngine>(device, x, y, firmware));
+        }
+    }
+
+    size_t get_core_count() const { return engines.size(); }
+    size_t get_channel_count() const { return channels.size(); }
+    size_t get_stripe() const { return stripe; }
+    CopyEngine& get_engine(size_t i) { return *engines[i]; }
+
+    // Interleaved GDDR at addr <-> buf[off, off + len).  Returns once all the
+    // stripes are queued; see wait() and get_shards_done().
+    Transfer submit_write(uint64_t addr, DmaBuffer& buf, size_t off, size_t len)
+    {
+        return submit(addr, buf, off, len, false);
+    }
+
+    Transfer submit_read(uint64_t addr, DmaBuffer& buf, size_t off, size_t len)
+    {
+        return submit(addr, buf, off, len, true);
+    }
+
+    size_t get_shards_done(const Transfer& transfer)
+    {
+        size_t done = 0;
+        for (const Shard& shard : transfer.shards) {
+            done += engines[shard.engine]->is_done(shard.ticket);
+        }
+        return done;
+    }
+
+    bool is_done(const Transfer& transfer) { return get_shards_done(transfer) == transfer.shards.size(); }
+
+    void wait(const Transfer& transfer)
+    {
+        for (const Shard& shard : transfer.shards) {
+            engines[shard.engine]->wait(shard.ticket);
+        }
+    }
+
+    // Across all the engines; each core's clock counts separately.
+    double get_cycles_per_byte()
+    {
+        uint64_t cycles = 0;
+        uint64_t bytes = 0;
+        for (auto& engine : engines) {
+            auto [c, b] = engine->get_counters();
+            cycles += c;
+            bytes += b;
+        }
+        return bytes ? (double)cycles / bytes : 0;
+    }
+
+    void write(uint64_t addr, DmaBuffer& buf, size_t off, size_t len) { wait(submit_write(addr, buf, off, len)); }
+    void read(uint64_t addr, DmaBuffer& buf, size_t off, size_t len) { wait(submit_read(addr, buf, off, len)); }
+
+private:
+    CopyEngineGroup(const CopyEngineGroup&) = delete;
+    CopyEngineGroup& operator=(const CopyEngineGroup&) = delete;
+    CopyEngineGroup(CopyEngineGroup&&) = delete;
+    CopyEngineGroup& operator=(CopyEngineGroup&&) = delete;
+};
+
+// Host side of tensix/cmd_ring.h: a single-producer, single-consumer queue of
+// commands for a persistent kernel on (x, y).  Commands are cache-line slots
+// in pinned host memory after a cache line of their own for the head word,
+// which the core writes as it retires commands.  The core fetches new slots
+// over the NOC when its doorbell, the tail in an L1 mailbox, moves on.
+// Pushing costs no MMIO until the doorbell is rung, which happens every
+// quarter ring, on flush() and before waiting; waiting costs none.  One
+// thread pushes at a time.
+class CommandRing
+{
+public:
+    static constexpr size_t MAX_ARGS = 14;
+
+    // One slot; must match struct cmd_ring_cmd in tensix/cmd_ring.h.
+    struct Command
+    {
+        uint32_t opcode;
+        uint32_t seq;
+        uint32_t args[MAX_ARGS];
+    };
+    static_assert(sizeof(Command) == 64, "Command must fill one cache line");
+
+    // Mailbox, relative to its L1 address; must match tensix/cmd_ring.h.
+    static constexpr uint64_t STATUS = 0x00;
+    static constexpr uint64_t DOORBELL = 0x04;
+    static constexpr uint32_t STATUS_READY = 0x5E1FC0DE;
+
+private:
+    static constexpr size_t HEADER_SIZE = 64;   // The head word, alone in its cache line
+    static constexpr std::chrono::seconds TIMEOUT{10};
+
+    Device& device;
+    uint16_t x;
+    uint16_t y;
+    uint64_t mailbox;
+    size_t entries;
+    DmaBuffer ring;
+    uint32_t tail{0};       // Commands pushed
+    uint32_t doorbell{0};   // Last tail the core was told about
+
+    static size_t ring_bytes(size_t entries)
+    {
+        size_t page = getpagesize();
+        return (HEADER_SIZE + entries * sizeof(Command) + page - 1) / page * page;
+    }
+
+    Command* slots() { return reinterpret_cast<Command*>(static_cast<uint8_t*>(ring.get_mem()) + HEADER_SIZE); }
+
+public:
+    // Set up the ring and the kernel's mailbox at L1 address mailbox.  Do this
+    // before the kernel starts; it reads the mailbox once.
+    CommandRing(Device& device, uint16_t x, uint16_t y, uint64_t mailbox, size_t entries = 1024)
+        : device(device)
+        , x(x)
+        , y(y)
+        , mailbox(mailbox)
+        , entries(entries)
+        , ring(device, ring_bytes(entries))
+    {
+        if (!device.is_tensix(x, y)) {
+            throw std::invalid_argument("Command ring consumer must be a Tensix core");
+        }
+        if (entries < 4 || (entries & (entries - 1)) != 0) {
+            throw std::invalid_argument("Ring size must be a power of two, at least 4");
+        }
+        if (ring.get_noc_addr() == ~0ULL) {
+            throw std::runtime_error("Command ring has no NOC address");
+        }
+
+        memset(ring.get_mem(), 0, ring.get_len());
+        for (size_t i = 0; i < entries; i++) {
+            slots()[i].seq = (uint32_t)(i - entries);   // Never mistaken for a new command
+        }
+
+        // STATUS, DOORBELL, HEAD, ring, entries
+        auto [pcie_x, pcie_y] = device.get_pcie_coordinates();
+        uint64_t ring_noc = ring.get_noc_addr();
+        uint32_t words[7] = {
+            0, 0, 0,
+            (uint32_t)ring_noc, (uint32_t)(ring_noc >> 32), (uint32_t)((pcie_y << 6) | pcie_x),
+            (uint32_t)entries,
+        };
+        device.noc_write(x, y, mailbox, words, sizeof(words));
+    }
+
+    uint16_t get_x() const { return x; }
+    uint16_t get_y() const { return y; }
+    uint64_t get_mailbox() const { return mailbox; }
+    size_t get_entries() const { return entries; }
+
+    // Queue a command and return its ticket for wait()/is_done().  Blocks only
+    // while the ring is full.
+    uint32_t push(uint32_t opcode, std::initializer_list<uint32_t> args = {})
+    {
+        if (args.size() > MAX_ARGS) {
+            throw std::invalid_argument("Too many command arguments");
+        }
+
+        // Full: let the core see everything, then wait for it to retire the oldest.
+        if (tail - get_completed() >= entries) {
+            flush();
+            wait_for(tail - entries + 1);
+        }
+
+        Command& slot = slots()[tail & (entries - 1)];
+        slot.opcode = opcode;
+        std::copy(args.begin(), args.end(), slot.args);
+        std::fill(slot.args + args.size(), slot.args + MAX_ARGS, 0);
+        std::atomic_thread_fence(std::memory_order_release);
+        __atomic_store_n(&slot.seq, tail, __ATOMIC_RELEASE);
+        tail++;
+
+        if (tail - doorbell >= entries / 4) {
+            flush();
+        }
+        return tail;
+    }
+
+    // Ring the doorbell for anything pushed since last time.
+    void flush()
+    {
+        if (doorbell == tail) {
+            return;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        device.noc_write32(x, y, mailbox + DOORBELL, tail);
+        doorbell = tail;
+    }
+
+    // Commands the core has retired; a ticket is done once this reaches it.
+    uint32_t get_completed() { return __atomic_load_n(get_completion_word(), __ATOMIC_ACQUIRE); }
+
+    bool is_done(uint32_t ticket) { return (int32_t)(get_completed() - ticket) >= 0; }
+
+    // Pushed but not yet retired.
+    size_t get_pending() { return tail - get_completed(); }
+
+    void wait(uint32_t ticket)
+    {
+        flush();
+        wait_for(ticket);
+    }
+
+    // The slot holding command seq (seq is ticket - 1), and the head word the
+    // core writes; for tests and for emulating the consumer.
+    const Command& get_command(uint32_t seq) { return slots()[seq & (entries - 1)]; }
+    volatile uint32_t* get_completion_word() { return static_cast<volatile uint32_t*>(ring.get_mem()); }
+
+private:
+    void wait_for(uint32_t ticket)
+    {
+        auto done = [ticket](uint32_t completed) { return (int32_t)(completed - ticket) >= 0; };
+        if (!Completion::wait_until(get_completion_word(), done, TIMEOUT)) {
+            throw std::runtime_error("Command ring timed out");
+        }
+    }
+
+    CommandRing(const CommandRing&) = delete;
+    CommandRing& operator=(const CommandRing&) = delete;
+    CommandRing(CommandRing&&) = delete;
+    CommandRing& operator=(CommandRing&&) = delete;
+};
+
+// Host side of tensix/command_server.c: a persistent kernel that runs commands
+// from a CommandRing.  It is loaded once; after that each job is a queued
+// command rather than a core reset and a fresh set of L1 parameters, so the
+// launch cost is paid once and spread over every command.  Blackhole only.
+class CommandServer
+{
+    static constexpr uint64_t TENSIX_RESET_REG = 0xFFB121B0;
+    static constexpr uint32_t TENSIX_IN_RESET = 0x47800;
+    static constexpr uint32_t TENSIX_OUT_RESET = 0x47000;
+
+    // Must match tensix/command_server.c.
+    static constexpr uint64_t MAILBOX = 0x10000;
+    static constexpr size_t MAX_COPY_SIZE = 1ULL << 30;
+
+    Device& device;
+    uint16_t x;
+    uint16_t y;
+    std::unique_ptr<CommandRing> ring;
+
+public:
+    enum Opcode : uint32_t
+    {
+        NOP = 0,
+        STORE32 = 1,
+        COPY = 2,
+    };
+
+    CommandServer(Device& device, uint16_t x, uint16_t y, const std::string& firmware = "tensix/command_server.bin",
+                  size_t entries = 1024)
+        : device(device)
+        , x(x)
+        , y(y)
+    {
+        if (!device.is_blackhole()) {
+            throw std::runtime_error("Command server firmware is Blackhole only");
+        }
+        if (device.is_simulated()) {
+            throw std::runtime_error("Simulated devices can't run firmware");
+        }
+        if (!device.is_tensix(x, y)) {
+            throw std::invalid_argument("Command server must run on a Tensix core");
+        }
+
+        std::vector<uint8_t> program = read_firmware(firmware);
+
+        device.reserve_core(x, y);
+        try {
+            device.noc_write32(x, y, TENSIX_RESET_REG, TENSIX_IN_RESET);
+            device.forget_core_image(x, y);
+            device.noc_write(x, y, 0x0, program.data(), program.size());
+            ring = std::make_unique<CommandRing>(device, x, y, MAILBOX, entries);
+            start();
+        } catch (...) {
+            device.noc_write32(x, y, TENSIX_RESET_REG, TENSIX_IN_RESET);
+            device.release_core(x, y);
+            throw;
+        }
+    }
+
+    uint16_t get_x() const { return x; }
+    uint16_t get_y() const { return y; }
+    CommandRing& get_ring() { return *ring; }
+
+    uint32_t nop() { return ring->push(NOP); }
+
+    // Store value at addr in the core's L1.
+    uint32_t store32(uint32_t addr, uint32_t value) { return ring->push(STORE32, {addr, value}); }
+
+    // Copy len bytes between NOC endpoints, as CopyEngine::submit() does but
+    // without pipelining; returns the ticket of the last piece.
+    uint32_t copy(uint16_t src_x, uint16_t src_y, uint64_t src_addr, uint16_t dst_x, uint16_t dst_y,
+                  uint64_t dst_addr, size_t len)
+    {
+        uint32_t ticket = 0;
+        for (size_t done = 0; done < len;) {
+            size_t chunk = std::min(len - done, MAX_COPY_SIZE);
+            uint64_t src = src_addr + done;
+            uint64_t dst = dst_addr + done;
+
+            ticket = ring->push(COPY, {
+                (uint32_t)src, (uint32_t)(src >> 32), (uint32_t)((src_y << 6) | src_x),
+                (uint32_t)dst, (uint32_t)(dst >> 32), (uint32_t)((dst_y << 6) | dst_x),
+                (uint32_t)chunk,
+            });
+            done += chunk;
+        }
+        return ticket;
+    }
+
+    void flush() { ring->flush(); }
+    bool is_done(uint32_t ticket) { return ring->is_done(ticket); }
+    void wait(uint32_t ticket) { ring->wait(ticket); }
+
+    ~CommandServer()
+    {
+        try {
+            device.noc_write32(x, y, TENSIX_RESET_REG, TENSIX_IN_RESET);
+        } catch (const std::exception&) {
+        }
+        device.release_core(x, y);
+    }
+
+private:
+    void start()
+    {
+        device.noc_write32(x, y, TENSIX_RESET_REG, TENSIX_OUT_RESET);
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (device.noc_read32(x, y, MAILBOX + CommandRing::STATUS) != CommandRing::STATUS_READY) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                throw std::runtime_error("Command server firmware did not start");
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    CommandServer(const CommandServer&) = delete;
+    CommandServer& operator=(const CommandServer&) = delete;
+    CommandServer(CommandServer&&) = delete;
+    CommandServer& operator=(CommandServer&&) = delete;
+};
+
+// Tensix cores running one program, started by Device::launch().  Launching
+// costs a few multicasts whatever the size of the grid: reset, program and
+// release each go to every core at once, in rectangles that skip non-Tensix
+// rows and columns and cores reserved by someone else.  Argument blocks are
+// multicast too when every core gets the same ones; otherwise they go out in
+// one vectored write.  Relaunching an unchanged ELF skips sending its code.
+// Each core reports to a word of host memory when it finishes (kernel_done()
+// in tensix/kernel.h), so waiting costs no MMIO.  Destroying the Kernel puts
+// the cores back in reset and releases them.
+class Kernel
+{
+public:
+    // Must match tensix/kernel.h.
+    static constexpr uint64_t ARGS_ADDR = 0xF000;
+    static constexpr size_t HEADER_WORDS = 4;
+    static constexpr size_t MAX_ARGS = 1020;
+
+private:
+    static constexpr uint64_t TENSIX_RESET_REG = 0xFFB121B0;
+    static constexpr uint32_t TENSIX_IN_RESET = 0x47800;
+    static constexpr uint32_t TENSIX_OUT_RESET = 0x47000;
+
+    Device& device;
+    std::vector<NocRect> rects;                         // Exactly the cores
+    std::vector<std::pair<uint16_t, uint16_t>> cores;
+    DmaBuffer done;                                     // Result word at (y << 6) | x
+    std::vector<std::vector<uint32_t>> blocks;          // Per core, or all the same
+    bool shared_args{false};
+    bool cached{false};
+    bool running{false};
+    size_t multicasts{0};
+
+    // Split rect, which holds only Tensix cores, into rectangles that miss
+    // (x, y): the rows above and below it, and the rest of its row either side.
+    static std::vector<NocRect> carve(const NocRect& rect, uint16_t x, uint16_t y)
+    {
+        if (x < rect.x_start || x > rect.x_end || y < rect.y_start || y > rect.y_end) {
+            return {rect};
+        }
+
+        std::vector<NocRect> out;
+        if (y > rect.y_start) {
+            out.push_back({rect.x_start, rect.y_start, rect.x_end, (uint16_t)(y - 1)});
+        }
+        if (y < rect.y_end) {
+            out.push_back({rect.x_start, (uint16_t)(y + 1), rect.x_end, rect.y_end});
+        }
+        if (x > rect.x_start) {
+            out.push_back({rect.x_start, y, (uint16_t)(x - 1), y});
+        }
+        if (x < rect.x_end) {
+            out.push_back({(uint16_t)(x + 1), y, rect.x_end, y});
+        }
+        return out;
+    }
+
+    volatile uint32_t* result_word(uint16_t x, uint16_t y)
+    {
+        return static_cast<volatile uint32_t*>(done.get_mem()) + ((y << 6) | x);
+    }
+
+    void multicast(uint64_t addr, const void* data, size_t size)
+    {
+        for (const NocRect& r : rects) {
+            device.noc_multicast_write(r, addr, data, size);
+            multicasts++;
+        }
+    }
+
+    // Find the cores and build their argument blocks; start() does the rest.
+    Kernel(Device& device, NocRect grid, const KernelArgs& args)
+        : device(device)
+        , done(device, 64 * 64 * sizeof(uint32_t))
+    {
+        if (!device.is_blackhole()) {
+            throw std::runtime_error("Kernel launch is Blackhole only");
+        }
+        if (done.get_noc_addr() == ~0ULL) {
+            throw std::runtime_error("Kernel result buffer has no NOC address");
+        }
+
+        rects = device.split_tensix_rect(grid);
+        for (auto [x, y] : device.get_reserved_cores()) {
+            std::vector<NocRect> next;
+            for (const NocRect& r : rects) {
+                for (const NocRect& piece : carve(r, x, y)) {
+                    next.push_back(piece);
+                }
+            }
+            rects = std::move(next);
+        }
+        for (const NocRect& r : rects) {
+            for (uint16_t y = r.y_start; y <= r.y_end; y++) {
+                for (uint16_t x = r.x_start; x <= r.x_end; x++) {
+                    cores.push_back({x, y});
+                }
+            }
+        }
+        if (cores.empty()) {
+            throw std::runtime_error("No free Tensix cores in the grid");
+        }
+
+        // The same header everywhere, so shared arguments mean shared blocks.
+        auto [pcie_x, pcie_y] = device.get_pcie_coordinates();
+        uint64_t done_noc = done.get_noc_addr();
+        std::vector<uint32_t> header = {
+            (uint32_t)done_noc, (uint32_t)(done_noc >> 32), (uint32_t)((pcie_y << 6) | pcie_x), 0,
+        };
+
+        for (auto [x, y] : cores) {
+            std::vector<uint32_t> block(header);
+            if (args) {
+                std::vector<uint32_t> a = args(x, y);
+                if (a.size() > MAX_ARGS) {
+                    throw std::invalid_argument("Too many kernel arguments");
+                }
+                block.insert(block.end(), a.begin(), a.end());
+            }
+            blocks.push_back(std::move(block));
+        }
+        shared_args = std::all_of(blocks.begin(), blocks.end(), [&](const auto& b) { return b == blocks[0]; });
+    }
+
+    // Reserve the cores, reset them, load() the program, write the arguments
+    // and release them.
+    void start(const std::function<void()>& load)
+    {
+        memset(done.get_mem(), 0, done.get_len());
+
+        for (auto [x, y] : cores) {
+            device.reserve_core(x, y);
+        }
+        running = true;
+
+        try {
+            uint32_t in_reset = TENSIX_IN_RESET;
+            uint32_t out_of_reset = TENSIX_OUT_RESET;
+
+            multicast(TENSIX_RESET_REG, &in_reset, sizeof(in_reset));
+            load();
+
+            if (shared_args) {
+                multicast(ARGS_ADDR, blocks[0].data(), blocks[0].size() * sizeof(uint32_t));
+            } else {
+                std::vector<tt_noc_iov_t> iov;
+                for (size_t i = 0; i < cores.size(); i++) {
+                    iov.push_back({(uint8_t)cores[i].first, (uint8_t)cores[i].second, ARGS_ADDR, blocks[i].data(),
+                                   blocks[i].size() * sizeof(uint32_t)});
+                }
+                device.noc_writev(iov);
+            }
+
+            multicast(TENSIX_RESET_REG, &out_of_reset, sizeof(out_of_reset));
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+public:
+    Kernel(Device& device, NocRect grid, const std::vector<uint8_t>& program, const KernelArgs& args = {})
+        : Kernel(device, grid, args)
+    {
+        if (program.empty() || program.size() > ARGS_ADDR) {
+            throw std::invalid_argument("Program must fit below the kernel arguments");
+        }
+
+        // Word-sized writes
+        std::vector<uint8_t> image(program);
+        image.resize((image.size() + 3) & ~size_t(3));
+
+        start([&] {
+            for (auto [x, y] : cores) {
+                device.forget_core_image(x, y);
+            }
+            multicast(0x0, image.data(), image.size());
+        });
+    }
+
+    // From an ELF.  If every core already has its code (see
+    // Device::load_firmware()) only the variables are sent.
+    Kernel(Device& device, NocRect grid, const Firmware& fw, const KernelArgs& args = {})
+        : Kernel(device, grid, args)
+    {
+        if (fw.get_end() > ARGS_ADDR) {
+            throw std::invalid_argument("Program must fit below the kernel arguments");
+        }
+
+        cached = std::all_of(cores.begin(), cores.end(),
+                             [&](const auto& core) { return device.get_core_image(core.first, core.second) == fw.get_hash(); });
+
+        start([&] {
+            for (auto [x, y] : cores) {
+                device.forget_core_image(x, y);
+            }
+            for (const Firmware::Segment& seg : fw.get_segments()) {
+                if (seg.writable || !cached) {
+                    multicast(seg.addr, seg.data.data(), seg.data.size());
+                }
+            }
+            for (auto [x, y] : cores) {
+                device.set_core_image(x, y, fw.get_hash());
+            }
+        });
+    }
+
+    const std::vector<std::pair<uint16_t, uint16_t>>& get_cores() const { return cores; }
+    const std::vector<NocRect>& get_rects() const { return rects; }
+
+    // NOC multicast writes the launch took.
+    size_t get_multicast_count() const { return multicasts; }
+
+    // The cores already had the program's code, so it wasn't sent.
+    bool was_cached() const { return cached; }
+
+    // What (x, y) passed to kernel_done(); 0 until then.
+    uint32_t get_result(uint16_t x, uint16_t y) { return __atomic_load_n(result_word(x, y), __ATOMIC_ACQUIRE); }
+
+    bool is_done()
+    {
+        for (auto [x, y] : cores) {
+            if (get_result(x, y) == 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Until every core has called kernel_done().
+    void wait(std::chrono::nanoseconds timeout = std::chrono::seconds(10))
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        auto nonzero = [](uint32_t v) { return v != 0; };
+
+        for (auto [x, y] : cores) {
+            auto left = std::max<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now(),
+                                                           std::chrono::nanoseconds(0));
+            if (!Completion::wait_until(result_word(x, y), nonzero, left)) {
+                throw std::runtime_error("Kernel timed out on core (" + std::to_string(x) + ", " + std::to_string(y) +
+                                         ")");
+            }
+        }
+    }
+
+    ~Kernel() { stop(); }
+
+private:
+    void stop()
+    {
+        if (!running) {
+            return;
+        }
+        running = false;
+
+        try {
+            uint32_t in_reset = TENSIX_IN_RESET;
+            multicast(TENSIX_RESET_REG, &in_reset, sizeof(in_reset));
+        } catch (const std::exception&) {
+        }
+        for (auto [x, y] : cores) {
+            device.release_core(x, y);
+        }
+    }
+
+    Kernel(const Kernel&) = delete;
+    Kernel& operator=(const Kernel&) = delete;
+    Kernel(Kernel&&) = delete;
+    Kernel& operator=(Kernel&&) = delete;
+};
+
+inline std::unique_ptr<Kernel> Device::launch(NocRect grid, const std::vector<uint8_t>& program,
+                                              const KernelArgs& args)
+{
+    return std::make_unique<Kernel>(*this, grid, program, args);
+}
+
+inline std::unique_ptr<Kernel> Device::launch(NocRect grid, const Firmware& fw, const KernelArgs& args)
+{
+    return std::make_unique<Kernel>(*this, grid, fw, args);
+}
+
+inline std::unique_ptr<Kernel> Device::launch(NocRect grid, const std::string& path, const KernelArgs& args)
+{
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".elf") == 0) {
+        return launch(grid, Firmware(path), args);
+    }
+    return launch(grid, read_firmware(path), args);
+}
 
 } // namespace tt
@@ -0,0 +1,193 @@
+// SPDX-FileCopyrightText: © 2025 Tenstorrent Inc.
+// SPDX-License-Identifier: GPL-2.0-only
+//
+// Copy Benchmark - throughput of each tt_memcpy_{to,from}_device kernel
+//
+// Without a device, copies to and from ordinary host memory; this measures the
+// kernels themselves.  With a device, copies through a 2 MiB WC TLB window
+// aimed at the given tile, which is what tt_noc_write/tt_noc_read see.
+
+#include "holething.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace tt;
+
+struct Config {
+    const char* device_path = nullptr;
+    size_t total_size_mib = 256;
+    int iterations = 3;
+    uint16_t noc_x = 0;
+    uint16_t noc_y = 0;
+    bool coords_specified = false;
+};
+
+static const enum tt_copy_kernel KERNELS[] = {
+    TT_COPY_KERNEL_SCALAR,
+    TT_COPY_KERNEL_SSE2,
+    TT_COPY_KERNEL_AVX2,
+    TT_COPY_KERNEL_AVX512,
+};
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, R"(Copy Benchmark - tt_memcpy_{to,from}_device kernel throughput
+
+Usage: %s [OPTIONS] [<device>]
+
+Arguments:
+  <device>              Device path (e.g., /dev/tenstorrent/0); if omitted,
+                        kernels copy into host memory
+
+Options:
+  -s, --size <MiB>      Total bytes copied per iteration in MiB [default: 256]
+  -n, --iterations <N>  Repeat each kernel N times [default: 3]
+  -x <X>                NOC X coordinate (required with a device)
+  -y <Y>                NOC Y coordinate (required with a device)
+  -h, --help            Print this help
+
+Examples:
+  %s
+  %s -x 17 -y 12 /dev/tenstorrent/0
+)", prog, prog, prog);
+}
+
+static bool parse_args(int argc, char** argv, Config& cfg) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            exit(0);
+        } else if (strcmp(argv[i], "-s") == 0 || strcmp(argv[i], "--size") == 0) {
+            if (++i >= argc) { fprintf(stderr, "Missing argument for -s\n"); return false; }
+            cfg.total_size_mib = atoi(argv[i]);
+        } else if (strcmp(argv[i], "-n") == 0 || strcmp(argv[i], "--iterations") == 0) {
+            if (++i >= argc) { fprintf(stderr, "Missing argument for -n\n"); return false; }
+            cfg.iterations = atoi(argv[i]);
+        } else if (strcmp(argv[i], "-x") == 0) {
+            if (++i >= argc) { fprintf(stderr, "Missing argument for -x\n"); return false; }
+            cfg.noc_x = atoi(argv[i]);
+            cfg.coords_specified = true;
+        } else if (strcmp(argv[i], "-y") == 0) {
+            if (++i >= argc) { fprintf(stderr, "Missing argument for -y\n"); return false; }
+            cfg.noc_y = atoi(argv[i]);
+            cfg.coords_specified = true;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return false;
+        } else {
+            cfg.device_path = argv[i];
+        }
+    }
+
+    if (cfg.device_path && !cfg.coords_specified) {
+        fprintf(stderr, "Error: Must specify -x and -y coordinates with a device\n");
+        return false;
+    }
+    if (cfg.total_size_mib < 2 || cfg.total_size_mib % 2 != 0) {
+        fprintf(stderr, "Error: Size must be a non-zero multiple of 2 MiB\n");
+        return false;
+    }
+    if (cfg.iterations < 1) {
+        fprintf(stderr, "Error: Iteration count must be >= 1\n");
+        return false;
+    }
+
+    return true;
+}
+
+// Copy total_size bytes to or from the window in window-sized pieces; returns MiB/s.
+static double run_kernel(uint8_t* window, size_t window_size, std::vector<uint8_t>& host, size_t total_size,
+                         bool read, TlbWindow* tlb, const Config& cfg)
+{
+    auto t_start = std::chrono::steady_clock::now();
+
+    for (size_t done = 0; done < total_size; done += window_size) {
+        if (tlb) {
+            tlb->map(cfg.noc_x, cfg.noc_y, done);
+        }
+        if (read) {
+            tt_memcpy_from_device(host.data(), window, window_size);
+        } else {
+            tt_memcpy_to_device(window, host.data(), window_size);
+        }
+    }
+
+    auto t_end = std::chrono::steady_clock::now();
+    double elapsed_s = std::chrono::duration<double>(t_end - t_start).count();
+
+    return (double)total_size / (1024.0 * 1024.0) / elapsed_s;
+}
+
+int main(int argc, char** argv) {
+    Config cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        fprintf(stderr, "\nRun with --help for usage.\n");
+        return 1;
+    }
+
+    static constexpr size_t WINDOW_SIZE = TT_TLB_SIZE_2M;
+    size_t total_size = cfg.total_size_mib * 1024 * 1024;
+    enum tt_copy_kernel original = tt_copy_get_kernel();
+
+    try {
+        std::unique_ptr<Device> device;
+        std::unique_ptr<TlbWindow> tlb;
+        std::vector<uint8_t> fake_window;
+        uint8_t* window;
+
+        if (cfg.device_path) {
+            device = std::make_unique<Device>(cfg.device_path);
+            tlb = std::make_unique<TlbWindow>(*device, WINDOW_SIZE, TT_MMIO_CACHE_MODE_WC);
+            window = static_cast<uint8_t*>(tlb->get_mmio());
+        } else {
+            fake_window.resize(WINDOW_SIZE + 64);
+            window = fake_window.data() + (64 - ((uintptr_t)fake_window.data() & 63)) % 64;
+        }
+
+        std::vector<uint8_t> host(WINDOW_SIZE);
+        for (size_t i = 0; i < host.size(); i++) {
+            host[i] = (uint8_t)(i * 7 + 1);
+        }
+
+        printf("Copy Benchmark\n");
+        printf("==============\n");
+        if (cfg.device_path) {
+            printf("Target: %s, NOC (%u, %u) via 2 MiB WC window\n", cfg.device_path, cfg.noc_x, cfg.noc_y);
+        } else {
+            printf("Target: host memory\n");
+        }
+        printf("Size: %zu MiB per iteration, %d iteration%s\n", cfg.total_size_mib, cfg.iterations,
+               cfg.iterations == 1 ? "" : "s");
+        printf("Default kernel: %s\n\n", tt_copy_kernel_name(original));
+        printf("  %-8s  %16s  %16s\n", "kernel", "write", "read");
+
+        for (enum tt_copy_kernel kernel : KERNELS) {
+            if (tt_copy_select(kernel) != 0) {
+                printf("  %-8s  unsupported on this CPU\n", tt_copy_kernel_name(kernel));
+                continue;
+            }
+
+            double write_sum = 0;
+            double read_sum = 0;
+            for (int iter = 0; iter < cfg.iterations; iter++) {
+                write_sum += run_kernel(window, WINDOW_SIZE, host, total_size, false, tlb.get(), cfg);
+                read_sum += run_kernel(window, WINDOW_SIZE, host, total_size, true, tlb.get(), cfg);
+            }
+
+            printf("  %-8s  %10.2f MiB/s  %10.2f MiB/s\n", tt_copy_kernel_name(kernel),
+                   write_sum / cfg.iterations, read_sum / cfg.iterations);
+        }
+
+        tt_copy_select(original);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -4,7 +4,12 @@
 // DRAM Benchmark - TLB-mapped throughput test
 //
 // Measures DRAM read/write throughput scaling with thread count.
-// Compares shared TLB window vs private TLB windows per thread.
+// Compares shared TLB window vs private TLB windows per thread, threads
+// calling Device::noc_write/noc_read directly, and the library's NocEngine
+// worker pool.  Worker threads run on the device's NUMA node; --numa repeats
+// the run from another node to show the cost of crossing sockets.
+// --copy-engine instead has Tensix cores move the data (CopyEngineGroup) and
+// shows how throughput scales with the number of cores.
 
 #include "holething.hpp"
 
@@ -46,6 +51,11 @@ struct Config {
     bool shared_mode = false;  // false = private
     bool use_4g_tlb = false;   // use 4 GiB TLB windows (BH only)
     bool multi_channel = false; // spread threads across GDDR channels (BH only)
+    bool engine_mode = false;  // use NocEngine instead of hand-rolled workers
+    bool library_mode = false; // threads call Device::noc_write/noc_read
+    bool numa_mode = false;    // compare device-local and remote thread placement
+    bool copy_engine_mode = false; // Tensix cores copy, 1 up to <N> of them (BH only)
+    int num_channels = 8;      // GDDR channels the copy engines interleave across
     uint16_t noc_x = 0;
     uint16_t noc_y = 0;
     bool coords_specified = false;
@@ -73,10 +83,13 @@ static void worker_private(
     bool read_mode,
     size_t tlb_size,
     bool multi_channel,
+    int numa_node,
     Barrier* start_barrier,
     Barrier* end_barrier,
     ThreadResult* result)
 {
+    NumaUtils::pin_thread_to_node(numa_node);
+
     size_t per_thread = total_size / num_threads;
     
     // In multi-channel mode: each thread writes to address 0 on its own channel
@@ -125,9 +138,9 @@ static void worker_private(
         uint8_t* target = static_cast<uint8_t*>(mmio) + offset_in_window;
         
         if (read_mode) {
-            memcpy(buffer.data(), target, chunk);
+            tt_memcpy_from_device(buffer.data(), target, chunk);
         } else {
-            memcpy(target, buffer.data(), chunk);
+            tt_memcpy_to_device(target, buffer.data(), chunk);
         }
 
         addr += chunk;
@@ -151,11 +164,14 @@ static void worker_shared(
     size_t total_size,
     bool read_mode,
     size_t tlb_size,
+    int numa_node,
     Barrier* start_barrier,
     Barrier* chunk_barrier,
     Barrier* end_barrier,
     ThreadResult* result)
 {
+    NumaUtils::pin_thread_to_node(numa_node);
+
     void* mmio = tlb->get_mmio();
     bool needs_remap = (tlb_size == TLB_SIZE_2M);
     
@@ -206,9 +222,9 @@ static void worker_shared(
             // Each thread accesses its slice
             uint8_t* my_ptr = static_cast<uint8_t*>(mmio) + my_offset_base;
             if (read_mode) {
-                memcpy(buffer.data(), my_ptr, slice_per_window);
+                tt_memcpy_from_device(buffer.data(), my_ptr, slice_per_window);
             } else {
-                memcpy(my_ptr, buffer.data(), slice_per_window);
+                tt_memcpy_to_device(my_ptr, buffer.data(), slice_per_window);
             }
 
             chunk_barrier->wait();  // Ensure all done before next remap
@@ -223,9 +239,9 @@ static void worker_shared(
             uint8_t* ptr = static_cast<uint8_t*>(mmio) + offset;
             
             if (read_mode) {
-                memcpy(buffer.data(), ptr, chunk);
+                tt_memcpy_from_device(buffer.data(), ptr, chunk);
             } else {
-                memcpy(ptr, buffer.data(), chunk);
+                tt_memcpy_to_device(ptr, buffer.data(), chunk);
             }
             
             offset += chunk;
@@ -239,6 +255,58 @@ static void worker_shared(
     end_barrier->wait();
 }
 
+// Worker for library mode: like private mode, but the library picks the window
+static void worker_library(
+    Device* device,
+    int thread_id,
+    int num_threads,
+    uint16_t noc_x,
+    uint16_t noc_y,
+    size_t total_size,
+    bool read_mode,
+    bool multi_channel,
+    int numa_node,
+    Barrier* start_barrier,
+    Barrier* end_barrier,
+    ThreadResult* result)
+{
+    NumaUtils::pin_thread_to_node(numa_node);
+
+    size_t per_thread = total_size / num_threads;
+    uint64_t addr = multi_channel ? 0 : (uint64_t)thread_id * per_thread;
+    size_t remaining = per_thread;
+
+    static constexpr size_t CHUNK_SIZE = 2 * 1024 * 1024;  // 2 MiB
+    std::vector<uint8_t> buffer(CHUNK_SIZE);
+    memset(buffer.data(), 0xAA + thread_id, buffer.size());
+
+    // Untimed warm-up so the thread's window allocation isn't measured
+    device->noc_read32(noc_x, noc_y, addr);
+    device->noc_read(noc_x, noc_y, addr, buffer.data(), sizeof(uint32_t));
+
+    start_barrier->wait();
+
+    auto t_start = std::chrono::steady_clock::now();
+
+    while (remaining > 0) {
+        size_t chunk = std::min(remaining, CHUNK_SIZE);
+
+        if (read_mode) {
+            device->noc_read(noc_x, noc_y, addr, buffer.data(), chunk);
+        } else {
+            device->noc_write(noc_x, noc_y, addr, buffer.data(), chunk);
+        }
+
+        addr += chunk;
+        remaining -= chunk;
+    }
+
+    auto t_end = std::chrono::steady_clock::now();
+    result->elapsed_ms = std::chrono::duration<double, std::milli>(t_end - t_start).count();
+
+    end_barrier->wait();
+}
+
 static void print_usage(const char* prog) {
     fprintf(stderr, R"(DRAM Benchmark - TLB-mapped throughput test
 
@@ -254,8 +322,15 @@ Options:
   -r, --read            Read from DRAM (default is write)
   --shared              All threads share one TLB window
   --private             Each thread gets its own TLB window [default]
+  --library             Each thread calls Device::noc_write/noc_read (per-thread
+                        library windows; with --tlb-4g, reserved 4 GiB windows)
+  --engine              Submit the whole transfer to a NocEngine with <N> workers
   --tlb-4g              Use 4 GiB TLB windows (Blackhole only)
   --multi-channel       Spread threads across GDDR channels (Blackhole only, implies --tlb-4g)
+  --numa                Run once with threads on the device's NUMA node and once
+                        on another node, and compare
+  --copy-engine         Have 1, 2, 4 ... <N> Tensix cores do the copy (Blackhole only)
+  --channels <M>        GDDR channels to interleave across with --copy-engine [default: 8]
   -x <X>                NOC X coordinate (not needed with --multi-channel)
   -y <Y>                NOC Y coordinate (not needed with --multi-channel)
   -h, --help            Print this help
@@ -263,6 +338,7 @@ Options:
 TLB Size:
   Default uses 2 MiB TLB windows, requiring remapping every 2 MiB.
   --tlb-4g uses 4 GiB windows (Blackhole only), mapping once at start.
+  --library --tlb-4g reserves them with Device::reserve_window() instead.
 
 Multi-Channel Mode (Blackhole):
   --multi-channel assigns each thread to a different GDDR channel:
@@ -270,6 +346,17 @@ Multi-Channel Mode (Blackhole):
   This tests aggregate DRAM bandwidth across channels.
   Implies --tlb-4g. Max 8 threads (one per channel).
 
+Copy Engine Mode (Blackhole):
+  --copy-engine loads tensix/copy_engine.bin onto <N> cores near the GDDR
+  channels and moves data between host memory and GDDR without host threads.
+  Data is interleaved across <M> channels in 1 MiB stripes.  No -x/-y needed.
+  cycles/B is Tensix clock cycles (mcycle) per byte, summed over the cores.
+
+NUMA:
+  Worker threads are pinned to the CPUs of the node the device is attached to
+  (from sysfs), so their host buffers are allocated there too.  --numa needs a
+  multi-node host that reports the device's node.
+
 Examples:
   # Single channel baseline
   %s -t 1 -s 512 -x 17 -y 12 --tlb-4g /dev/tenstorrent/0
@@ -302,8 +389,19 @@ static bool parse_args(int argc, char** argv, Config& cfg) {
             cfg.shared_mode = true;
         } else if (strcmp(argv[i], "--private") == 0) {
             cfg.shared_mode = false;
+        } else if (strcmp(argv[i], "--library") == 0) {
+            cfg.library_mode = true;
+        } else if (strcmp(argv[i], "--engine") == 0) {
+            cfg.engine_mode = true;
         } else if (strcmp(argv[i], "--tlb-4g") == 0) {
             cfg.use_4g_tlb = true;
+        } else if (strcmp(argv[i], "--numa") == 0) {
+            cfg.numa_mode = true;
+        } else if (strcmp(argv[i], "--copy-engine") == 0) {
+            cfg.copy_engine_mode = true;
+        } else if (strcmp(argv[i], "--channels") == 0) {
+            if (++i >= argc) { fprintf(stderr, "Missing argument for --channels\n"); return false; }
+            cfg.num_channels = atoi(argv[i]);
         } else if (strcmp(argv[i], "--multi-channel") == 0) {
             cfg.multi_channel = true;
             cfg.use_4g_tlb = true;  // multi-channel implies 4G TLB
@@ -327,7 +425,16 @@ static bool parse_args(int argc, char** argv, Config& cfg) {
         fprintf(stderr, "Error: Missing device path\n");
         return false;
     }
-    if (!cfg.multi_channel && !cfg.coords_specified) {
+    if (cfg.copy_engine_mode && (cfg.shared_mode || cfg.engine_mode || cfg.library_mode || cfg.use_4g_tlb ||
+                                 cfg.numa_mode)) {
+        fprintf(stderr, "Error: --copy-engine is not compatible with other modes\n");
+        return false;
+    }
+    if (cfg.copy_engine_mode && (cfg.num_channels < 1 || cfg.num_channels > NUM_BH_GDDR_CHANNELS)) {
+        fprintf(stderr, "Error: --channels must be 1 to %d\n", NUM_BH_GDDR_CHANNELS);
+        return false;
+    }
+    if (!cfg.multi_channel && !cfg.copy_engine_mode && !cfg.coords_specified) {
         fprintf(stderr, "Error: Must specify -x and -y coordinates (or use --multi-channel)\n");
         return false;
     }
@@ -340,6 +447,18 @@ static bool parse_args(int argc, char** argv, Config& cfg) {
         fprintf(stderr, "Error: --multi-channel is not compatible with --shared mode\n");
         return false;
     }
+    if (cfg.engine_mode && (cfg.shared_mode || cfg.use_4g_tlb)) {
+        fprintf(stderr, "Error: --engine is not compatible with --shared, --tlb-4g or --multi-channel\n");
+        return false;
+    }
+    if (cfg.numa_mode && cfg.engine_mode) {
+        fprintf(stderr, "Error: --numa is not compatible with --engine\n");
+        return false;
+    }
+    if (cfg.library_mode && (cfg.shared_mode || cfg.engine_mode)) {
+        fprintf(stderr, "Error: --library is not compatible with --shared or --engine\n");
+        return false;
+    }
     if (cfg.num_threads < 1) {
         fprintf(stderr, "Error: Thread count must be >= 1\n");
         return false;
@@ -352,6 +471,62 @@ static bool parse_args(int argc, char** argv, Config& cfg) {
     return true;
 }
 
+// Copy engine mode: the same transfer with 1, 2, 4 ... cfg.num_threads cores.
+static int run_copy_engine(Device& device, const Config& cfg)
+{
+    size_t total_size = cfg.total_size_mib * 1024 * 1024;
+
+    if (!device.is_blackhole()) {
+        fprintf(stderr, "Error: --copy-engine is only supported on Blackhole devices\n");
+        return 1;
+    }
+
+    std::vector<int> core_counts;
+    for (int n = 1; n < cfg.num_threads; n *= 2) {
+        core_counts.push_back(n);
+    }
+    core_counts.push_back(cfg.num_threads);
+
+    DmaBuffer buffer(device, total_size);
+    memset(buffer.get_mem(), 0xCC, total_size);
+
+    printf("DRAM Benchmark\n");
+    printf("==============\n");
+    printf("Device: %s (Blackhole)\n", cfg.device_path);
+    printf("Mode: copy engine, %zu MiB %s, %d GDDR channel%s, %d iteration%s\n", cfg.total_size_mib,
+           cfg.read_mode ? "read" : "write", cfg.num_channels, cfg.num_channels == 1 ? "" : "s", cfg.iterations,
+           cfg.iterations == 1 ? "" : "s");
+    printf("\n");
+    printf("  %5s  %12s  %8s  %10s\n", "cores", "MiB/s", "scaling", "cycles/B");
+
+    double base = 0;
+    for (int cores : core_counts) {
+        CopyEngineGroup group(device, cores, cfg.num_channels);
+        double sum = 0;
+
+        for (int iter = 0; iter < cfg.iterations; iter++) {
+            auto t_start = std::chrono::steady_clock::now();
+            if (cfg.read_mode) {
+                group.read(0, buffer, 0, total_size);
+            } else {
+                group.write(0, buffer, 0, total_size);
+            }
+            auto t_end = std::chrono::steady_clock::now();
+
+            double elapsed_s = std::chrono::duration<double>(t_end - t_start).count();
+            sum += static_cast<double>(cfg.total_size_mib) / elapsed_s;
+        }
+
+        double mean = sum / cfg.iterations;
+        if (base == 0) {
+            base = mean;
+        }
+        printf("  %5d  %12.2f  %7.2fx  %10.3f\n", cores, mean, mean / base, group.get_cycles_per_byte());
+    }
+
+    return 0;
+}
+
 int main(int argc, char** argv) {
     Config cfg;
     if (!parse_args(argc, argv, cfg)) {
@@ -363,6 +538,10 @@ int main(int argc, char** argv) {
 
     try {
         Device device(cfg.device_path);
+
+        if (cfg.copy_engine_mode) {
+            return run_copy_engine(device, cfg);
+        }
         
         // Validate 4G TLB is only used on Blackhole
         if (cfg.use_4g_tlb && !device.is_blackhole()) {
@@ -433,11 +612,17 @@ int main(int argc, char** argv) {
                cfg.use_4g_tlb ? "GiB" : "MiB",
                cfg.use_4g_tlb ? " (map once, no ioctl in hot path)" : "");
         printf("Mode: %s, %d thread%s, %zu MiB %s, %d iteration%s\n",
-               cfg.shared_mode ? "shared" : "private",
+               cfg.engine_mode ? "engine" : cfg.library_mode ? "library" : cfg.shared_mode ? "shared" : "private",
                cfg.num_threads, cfg.num_threads == 1 ? "" : "s",
                cfg.total_size_mib,
                cfg.read_mode ? "read" : "write",
                cfg.iterations, cfg.iterations == 1 ? "" : "s");
+        printf("Copy kernel: %s\n", tt_copy_kernel_name(tt_copy_get_kernel()));
+        if (device.get_numa_node() >= 0) {
+            printf("NUMA: device on node %d\n", device.get_numa_node());
+        } else {
+            printf("NUMA: device node unknown, threads unpinned\n");
+        }
 
         size_t per_thread = total_size / cfg.num_threads;
         if (cfg.use_4g_tlb) {
@@ -455,95 +640,192 @@ int main(int argc, char** argv) {
         }
         printf("\n");
 
-        std::vector<double> throughputs;
+        // Threads run (and allocate their buffers) on the device's node; with
+        // --numa, again on another node for comparison.
+        int local_node = device.get_numa_node();
+        std::vector<int> placements = {local_node};
+        if (cfg.numa_mode) {
+            for (int node : NumaUtils::get_nodes()) {
+                if (node != local_node) {
+                    placements.push_back(node);
+                    break;
+                }
+            }
+            if (local_node < 0 || placements.size() < 2) {
+                fprintf(stderr, "Error: --numa needs a multi-node host that reports the device's node\n");
+                return 1;
+            }
+        }
 
-        for (int iter = 0; iter < cfg.iterations; iter++) {
-            std::vector<std::thread> threads;
-            std::vector<ThreadResult> results(cfg.num_threads);
+        std::vector<uint8_t> engine_buffer(cfg.engine_mode ? total_size : 0, 0xCC);
+        std::vector<double> means;
 
-            double elapsed_ms;
+        for (int node : placements) {
+            std::vector<double> throughputs;
 
-            if (cfg.shared_mode) {
-                // Shared mode: one TLB window, all threads share it
-                TlbWindow shared_tlb(device, tlb_size, TT_MMIO_CACHE_MODE_WC);
+            if (cfg.numa_mode) {
+                printf("%s%s node %d:\n", node == local_node ? "" : "\n", node == local_node ? "Local" : "Remote", node);
+            }
+
+            for (int iter = 0; iter < cfg.iterations; iter++) {
+                std::vector<std::thread> threads;
+                std::vector<ThreadResult> results(cfg.num_threads);
+
+                double elapsed_ms;
+
+                if (cfg.engine_mode) {
+                    // Engine mode: the library splits the transfer across its workers
+                    NocEngine engine(device, cfg.num_threads, tlb_size);
+
+                    auto t_start = std::chrono::steady_clock::now();
+                    NocEngine::Token token = cfg.read_mode
+                        ? engine.submit_read(cfg.noc_x, cfg.noc_y, 0, engine_buffer.data(), total_size)
+                        : engine.submit_write(cfg.noc_x, cfg.noc_y, 0, engine_buffer.data(), total_size);
+                    engine.wait(token);
+                    auto t_end = std::chrono::steady_clock::now();
+
+                    elapsed_ms = std::chrono::duration<double, std::milli>(t_end - t_start).count();
+
+                } else if (cfg.library_mode) {
+                    // Library mode: the library gives each thread its own window,
+                    // or with --tlb-4g uses windows reserved for the targets
+                    Barrier start_barrier(cfg.num_threads);
+                    Barrier end_barrier(cfg.num_threads);
+
+                    // The warm-up takes an uncached and a write-combined window per thread
+                    device.set_thread_window_budget(2 * cfg.num_threads);
+
+                    if (cfg.use_4g_tlb && device.get_reserved_windows().empty()) {
+                        if (cfg.multi_channel) {
+                            for (int t = 0; t < cfg.num_threads; t++) {
+                                device.reserve_window(BH_GDDR_COORDS[t].first, BH_GDDR_COORDS[t].second);
+                            }
+                        } else {
+                            device.reserve_window(cfg.noc_x, cfg.noc_y);
+                        }
+                    }
+
+                    for (int t = 0; t < cfg.num_threads; t++) {
+                        uint16_t thread_noc_x = cfg.multi_channel ? BH_GDDR_COORDS[t].first : cfg.noc_x;
+                        uint16_t thread_noc_y = cfg.multi_channel ? BH_GDDR_COORDS[t].second : cfg.noc_y;
+
+                        threads.emplace_back(worker_library,
+                            &device,
+                            t, cfg.num_threads,
+                            thread_noc_x, thread_noc_y,
+                            total_size,
+                            cfg.read_mode,
+                            cfg.multi_channel,
+                            node,
+                            &start_barrier,
+                            &end_barrier,
+                            &results[t]);
+                    }
+
+                    for (auto& th : threads) {
+                        th.join();
+                    }
+
+                    elapsed_ms = 0;
+                    for (const auto& r : results) {
+                        elapsed_ms = std::max(elapsed_ms, r.elapsed_ms);
+                    }
+
+                } else if (cfg.shared_mode) {
+                    // Shared mode: one TLB window, all threads share it
+                    TlbWindow shared_tlb(device, tlb_size, TT_MMIO_CACHE_MODE_WC);
                 
-                // For 4G TLB in shared mode, map once before starting
-                if (cfg.use_4g_tlb) {
-                    shared_tlb.map(cfg.noc_x, cfg.noc_y, 0);
-                }
+                    // For 4G TLB in shared mode, map once before starting
+                    if (cfg.use_4g_tlb) {
+                        shared_tlb.map(cfg.noc_x, cfg.noc_y, 0);
+                    }
                 
-                Barrier start_barrier(cfg.num_threads);
-                Barrier chunk_barrier(cfg.num_threads);
-                Barrier end_barrier(cfg.num_threads);
-
-                for (int t = 0; t < cfg.num_threads; t++) {
-                    threads.emplace_back(worker_shared,
-                        &shared_tlb,
-                        t, cfg.num_threads,
-                        cfg.noc_x, cfg.noc_y,
-                        total_size,
-                        cfg.read_mode,
-                        tlb_size,
-                        &start_barrier,
-                        &chunk_barrier,
-                        &end_barrier,
-                        &results[t]);
-                }
-
-                for (auto& th : threads) {
-                    th.join();
-                }
-
-                // In shared mode, all threads should have ~same elapsed time
-                elapsed_ms = results[0].elapsed_ms;
-
-            } else {
-                // Private mode: each thread gets its own TLB
-                Barrier start_barrier(cfg.num_threads);
-                Barrier end_barrier(cfg.num_threads);
-
-                for (int t = 0; t < cfg.num_threads; t++) {
-                    // In multi-channel mode, each thread targets a different GDDR channel
-                    uint16_t thread_noc_x = cfg.multi_channel ? BH_GDDR_COORDS[t].first : cfg.noc_x;
-                    uint16_t thread_noc_y = cfg.multi_channel ? BH_GDDR_COORDS[t].second : cfg.noc_y;
+                    Barrier start_barrier(cfg.num_threads);
+                    Barrier chunk_barrier(cfg.num_threads);
+                    Barrier end_barrier(cfg.num_threads);
+
+                    for (int t = 0; t < cfg.num_threads; t++) {
+                        threads.emplace_back(worker_shared,
+                            &shared_tlb,
+                            t, cfg.num_threads,
+                            cfg.noc_x, cfg.noc_y,
+                            total_size,
+                            cfg.read_mode,
+                            tlb_size,
+                            node,
+                            &start_barrier,
+                            &chunk_barrier,
+                            &end_barrier,
+                            &results[t]);
+                    }
+
+                    for (auto& th : threads) {
+                        th.join();
+                    }
+
+                    // In shared mode, all threads should have ~same elapsed time
+                    elapsed_ms = results[0].elapsed_ms;
+
+                } else {
+                    // Private mode: each thread gets its own TLB
+                    Barrier start_barrier(cfg.num_threads);
+                    Barrier end_barrier(cfg.num_threads);
+
+                    for (int t = 0; t < cfg.num_threads; t++) {
+                        // In multi-channel mode, each thread targets a different GDDR channel
+                        uint16_t thread_noc_x = cfg.multi_channel ? BH_GDDR_COORDS[t].first : cfg.noc_x;
+                        uint16_t thread_noc_y = cfg.multi_channel ? BH_GDDR_COORDS[t].second : cfg.noc_y;
                     
-                    threads.emplace_back(worker_private,
-                        &device,
-                        t, cfg.num_threads,
-                        thread_noc_x, thread_noc_y,
-                        total_size,
-                        cfg.read_mode,
-                        tlb_size,
-                        cfg.multi_channel,
-                        &start_barrier,
-                        &end_barrier,
-                        &results[t]);
+                        threads.emplace_back(worker_private,
+                            &device,
+                            t, cfg.num_threads,
+                            thread_noc_x, thread_noc_y,
+                            total_size,
+                            cfg.read_mode,
+                            tlb_size,
+                            cfg.multi_channel,
+                            node,
+                            &start_barrier,
+                            &end_barrier,
+                            &results[t]);
+                    }
+
+                    for (auto& th : threads) {
+                        th.join();
+                    }
+
+                    // In private mode, use the max time (wait for slowest thread)
+                    elapsed_ms = 0;
+                    for (const auto& r : results) {
+                        elapsed_ms = std::max(elapsed_ms, r.elapsed_ms);
+                    }
                 }
 
-                for (auto& th : threads) {
-                    th.join();
-                }
+                double throughput_mibs = static_cast<double>(cfg.total_size_mib) / (elapsed_ms / 1000.0);
+                throughputs.push_back(throughput_mibs);
 
-                // In private mode, use the max time (wait for slowest thread)
-                elapsed_ms = 0;
-                for (const auto& r : results) {
-                    elapsed_ms = std::max(elapsed_ms, r.elapsed_ms);
-                }
+                printf("  Iter %d: %8.2f ms  %10.2f MiB/s\n", iter + 1, elapsed_ms, throughput_mibs);
             }
 
-            double throughput_mibs = static_cast<double>(cfg.total_size_mib) / (elapsed_ms / 1000.0);
-            throughputs.push_back(throughput_mibs);
+            // Calculate mean
+            double sum = 0;
+            for (double t : throughputs) sum += t;
+            double mean = sum / throughputs.size();
 
-            printf("  Iter %d: %8.2f ms  %10.2f MiB/s\n", iter + 1, elapsed_ms, throughput_mibs);
+            printf("----------------------------------------\n");
+            printf("  Mean:             %10.2f MiB/s\n", mean);
+            means.push_back(mean);
         }
 
-        // Calculate mean
-        double sum = 0;
-        for (double t : throughputs) sum += t;
-        double mean = sum / throughputs.size();
+        if (cfg.numa_mode) {
+            printf("  Remote/local:     %10.2fx\n", means[1] / means[0]);
+        }
 
-        printf("----------------------------------------\n");
-        printf("  Mean:             %10.2f MiB/s\n", mean);
+        tt_device_stats_t stats = device.get_stats();
+        printf("  TLB remaps:       %10lu issued, %lu elided\n",
+               stats.tlb_remaps_issued, stats.tlb_remaps_elided);
+        printf("  Thread windows:   %10lu held by the library, %lu reserved\n",
+               stats.thread_windows, stats.reserved_windows);
 
     } catch (const std::exception& e) {
         fprintf(stderr, "Error: %s\n", e.what());
@@ -2,7 +2,6 @@
 
 #include <iostream>
 #include <iomanip>
-#include <fstream>
 #include <vector>
 #include <unistd.h>
 #include <cstring>
@@ -15,22 +14,6 @@ static constexpr uint64_t TENSIX_RESET_REG  = TENSIX_REG_BASE + 0x121B0;
 static constexpr uint32_t TENSIX_IN_RESET   = 0x47800;
 static constexpr uint32_t TENSIX_OUT_RESET  = 0x47000;
 
-// Memory layout (must match tensix/iter05.c)
-static constexpr uint64_t SRC_BUF_ADDR_LO  = 0x1000;
-static constexpr uint64_t SRC_BUF_ADDR_MID = 0x1004;
-static constexpr uint64_t SRC_BUF_ADDR_HI  = 0x1008;
-static constexpr uint64_t DST_BUF_ADDR_LO  = 0x100C;
-static constexpr uint64_t DST_BUF_ADDR_MID = 0x1010;
-static constexpr uint64_t DST_BUF_ADDR_HI  = 0x1014;
-static constexpr uint64_t TRANSFER_SIZE    = 0x1018;
-static constexpr uint64_t READY_ADDR       = 0x101C;
-static constexpr uint64_t DEBUG_SRC_LO      = 0x1020;
-static constexpr uint64_t DEBUG_SRC_MID     = 0x1024;
-static constexpr uint64_t DEBUG_DST_LO      = 0x1028;
-static constexpr uint64_t DEBUG_DST_MID     = 0x102C;
-static constexpr uint64_t DEBUG_NODE_ID     = 0x1030;
-static constexpr uint64_t DEBUG_LOCAL_COORD = 0x1034;
-
 // GDDR target
 static constexpr uint8_t GDDR_X = 17;
 static constexpr uint8_t GDDR_Y = 12;
@@ -38,24 +21,6 @@ static constexpr uint8_t GDDR_Y = 12;
 // Buffer size
 static constexpr size_t BUFFER_SIZE = 4ULL * 1024 * 1024;
 
-std::vector<uint8_t> read_bin(const char *filename)
-{
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file) {
-        throw std::runtime_error(std::string("Error opening ") + filename);
-    }
-
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
-
-    std::vector<uint8_t> data(size);
-    if (!file.read(reinterpret_cast<char*>(data.data()), size)) {
-        throw std::runtime_error(std::string("Error reading from ") + filename);
-    }
-
-    return data;
-}
-
 int main(int argc, char *argv[])
 {
     (void)argc;
@@ -105,12 +70,15 @@ int main(int argc, char *argv[])
     src_ptr[1] = 0xCAFEBABE;
     std::cout << "   Set src[0]=0xDEADBEEF, src[1]=0xCAFEBABE\n";
 
-    // Load program
-    std::vector<uint8_t> program = read_bin("tensix/iter05.bin");
-    std::cout << "4. Loading Tensix program (" << program.size() << " bytes)...\n";
+    // Load program; its parameters are found by name in the ELF
+    Firmware fw("tensix/iter05.elf");
+    auto var = [&](const char* name) { return fw.get_symbol(name); };
+    std::cout << "4. Loading Tensix program (" << fw.get_end() << " bytes)...\n";
 
     device.noc_write32(TENSIX_X, TENSIX_Y, TENSIX_RESET_REG, TENSIX_IN_RESET);
-    device.noc_write(TENSIX_X, TENSIX_Y, 0x0, program.data(), program.size());
+    if (!device.load_firmware(TENSIX_X, TENSIX_Y, fw)) {
+        std::cout << "   Code already loaded\n";
+    }
 
     // Write parameters
     std::cout << "5. Writing parameters...\n";
@@ -121,16 +89,22 @@ int main(int argc, char *argv[])
     std::cout << "   Sending dst to Tensix: lo=0x" << std::hex << (uint32_t)(dst_noc_addr & 0xFFFFFFFF)
               << " mid=0x" << (uint32_t)(dst_noc_addr >> 32) << " hi=0x" << pcie_coord << std::dec << "\n";
 
-    device.noc_write32(TENSIX_X, TENSIX_Y, SRC_BUF_ADDR_LO, (uint32_t)(src_noc_addr & 0xFFFFFFFF));
-    device.noc_write32(TENSIX_X, TENSIX_Y, SRC_BUF_ADDR_MID, (uint32_t)(src_noc_addr >> 32));
-    device.noc_write32(TENSIX_X, TENSIX_Y, SRC_BUF_ADDR_HI, pcie_coord);
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("src_buf_addr_lo"), (uint32_t)(src_noc_addr & 0xFFFFFFFF));
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("src_buf_addr_mid"), (uint32_t)(src_noc_addr >> 32));
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("src_buf_addr_hi"), pcie_coord);
+
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("dst_buf_addr_lo"), (uint32_t)(dst_noc_addr & 0xFFFFFFFF));
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("dst_buf_addr_mid"), (uint32_t)(dst_noc_addr >> 32));
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("dst_buf_addr_hi"), pcie_coord);
 
-    device.noc_write32(TENSIX_X, TENSIX_Y, DST_BUF_ADDR_LO, (uint32_t)(dst_noc_addr & 0xFFFFFFFF));
-    device.noc_write32(TENSIX_X, TENSIX_Y, DST_BUF_ADDR_MID, (uint32_t)(dst_noc_addr >> 32));
-    device.noc_write32(TENSIX_X, TENSIX_Y, DST_BUF_ADDR_HI, pcie_coord);
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("transfer_size"), (uint32_t)BUFFER_SIZE);
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("ready"), 0);
 
-    device.noc_write32(TENSIX_X, TENSIX_Y, TRANSFER_SIZE, (uint32_t)BUFFER_SIZE);
-    device.noc_write32(TENSIX_X, TENSIX_Y, READY_ADDR, 0);
+    // The core writes ready here at the end; we wait on it locally.
+    Completion completion(device);
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("completion_lo"), (uint32_t)(completion.get_noc_addr() & 0xFFFFFFFF));
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("completion_mid"), (uint32_t)(completion.get_noc_addr() >> 32));
+    device.noc_write32(TENSIX_X, TENSIX_Y, var("completion_hi"), pcie_coord);
 
     // Start
     std::cout << "6. Starting Tensix...\n";
@@ -142,44 +116,26 @@ int main(int argc, char *argv[])
 
     device.noc_write32(TENSIX_X, TENSIX_Y, TENSIX_RESET_REG, TENSIX_OUT_RESET);
 
-    // Poll with timeout
+    // Wait on the host-memory completion word; no MMIO until it's there
     std::cout << "7. Waiting for completion...\n";
-    uint32_t ready = 0;
-    int polls = 0;
     auto start = std::chrono::steady_clock::now();
-
-    while (ready != 0xC0DEC0DE && polls < 100) {  // 10s timeout
-        usleep(100000);  // 100ms
-        ready = device.noc_read32(TENSIX_X, TENSIX_Y, READY_ADDR);
-        polls++;
-
-        if (polls % 10 == 0 || (ready != 0 && ready != 0xAAAAAAAA)) {
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
-
-            std::cout << "   Poll " << polls << " (" << (elapsed/1000.0) << "s) "
-                      << "Ready=0x" << std::hex << ready << std::dec;
-
-            if (ready == 0x11111111) {
-                std::cout << " [Phase 1: PCIe->L1->GDDR]";
-            } else if (ready == 0x22222222) {
-                std::cout << " [Phase 2: GDDR->L1->PCIe]";
-            }
-            std::cout << "\n";
-
-            if (ready == 0xC0DEC0DE) break;
-        }
-    }
-
+    bool done = completion.wait(0xC0DEC0DE, std::chrono::seconds(10));
     auto end = std::chrono::steady_clock::now();
-    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-
-    if (ready != 0xC0DEC0DE) {
-        std::cout << "ERROR: Timeout (ready = 0x" << std::hex << ready << std::dec << ")\n";
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+    if (!done) {
+        uint32_t ready = device.noc_read32(TENSIX_X, TENSIX_Y, var("ready"));
+        std::cout << "ERROR: Timeout (ready = 0x" << std::hex << ready << std::dec << ")";
+        if (ready == 0x11111111) {
+            std::cout << " [Phase 1: PCIe->L1->GDDR]";
+        } else if (ready == 0x22222222) {
+            std::cout << " [Phase 2: GDDR->L1->PCIe]";
+        }
+        std::cout << "\n";
         return 1;
     }
 
-    std::cout << "   Completed in " << (elapsed_ms / 1000.0) << " seconds\n";
+    std::cout << "   Completed in " << elapsed_us << " us\n";
 
     // Verify
     std::cout << "8. Verifying data...\n";
@@ -192,11 +148,11 @@ int main(int argc, char *argv[])
     std::cout << "   GDDR[0]=" << gddr_0 << " GDDR[1]=" << gddr_4 << "\n";
 
     // Check what Tensix saw
-    uint32_t total_size_tensix = device.noc_read32(TENSIX_X, TENSIX_Y, DEBUG_SRC_LO);
-    uint32_t chunks_phase1 = device.noc_read32(TENSIX_X, TENSIX_Y, DEBUG_SRC_MID);
-    uint32_t chunks_phase2 = device.noc_read32(TENSIX_X, TENSIX_Y, DEBUG_DST_MID);
-    uint32_t node_id_tensix = device.noc_read32(TENSIX_X, TENSIX_Y, DEBUG_NODE_ID);
-    uint32_t local_coord_tensix = device.noc_read32(TENSIX_X, TENSIX_Y, DEBUG_LOCAL_COORD);
+    uint32_t total_size_tensix = device.noc_read32(TENSIX_X, TENSIX_Y, var("debug_src_lo"));
+    uint32_t chunks_phase1 = device.noc_read32(TENSIX_X, TENSIX_Y, var("debug_src_mid"));
+    uint32_t chunks_phase2 = device.noc_read32(TENSIX_X, TENSIX_Y, var("debug_dst_mid"));
+    uint32_t node_id_tensix = device.noc_read32(TENSIX_X, TENSIX_Y, var("debug_node_id"));
+    uint32_t local_coord_tensix = device.noc_read32(TENSIX_X, TENSIX_Y, var("debug_local_coord"));
 
     std::cout << "   Tensix saw transfer_size: " << total_size_tensix << " bytes\n";
     std::cout << "   Tensix node_id: 0x" << std::hex << node_id_tensix << std::dec 
@@ -205,8 +161,6 @@ int main(int argc, char *argv[])
     std::cout << "   Tensix did phase1 chunks: " << chunks_phase1 << "\n";
     std::cout << "   Tensix did phase2 chunks: " << chunks_phase2 << "\n";
 
-    uint32_t tensix_dst_lo = device.noc_read32(TENSIX_X, TENSIX_Y, DEBUG_DST_LO);
-
     uint64_t tensix_saw_src = src_noc_addr;
     uint64_t tensix_saw_dst = dst_noc_addr;
 
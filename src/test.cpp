@@ -396,6 +396,1309 @@ int block_io_test(Device& dev)
     return 0;
 }
 
+int vectored_io_test(Device& dev)
+{
+    uint16_t ddr_x = dev.is_wormhole() ? WH_DDR_X : dev.is_blackhole() ? BH_DDR_X : -1;
+    uint16_t ddr_y = dev.is_wormhole() ? WH_DDR_Y : dev.is_blackhole() ? BH_DDR_Y : -1;
+
+    /* Scatter single words and small blocks across several pages, out of order. */
+    const size_t count = 64;
+    std::vector<std::vector<uint32_t>> written(count);
+    std::vector<std::vector<uint32_t>> readback(count);
+    std::vector<tt_noc_iov_t> writes(count);
+    std::vector<tt_noc_iov_t> reads(count);
+
+    my_srand(7);
+    for (size_t i = 0; i < count; i++) {
+        size_t words = (i % 3 == 0) ? 1 : 16;
+        uint64_t addr = ((count - i) % 5) * 0x400000 + i * 0x100;
+
+        written[i].resize(words);
+        readback[i].resize(words);
+        for (auto& w : written[i]) {
+            w = my_rand();
+        }
+
+        writes[i] = {(uint8_t)ddr_x, (uint8_t)ddr_y, addr, written[i].data(), words * sizeof(uint32_t)};
+        reads[i] = {(uint8_t)ddr_x, (uint8_t)ddr_y, addr, readback[i].data(), words * sizeof(uint32_t)};
+    }
+
+    dev.noc_writev(writes);
+    dev.noc_readv(reads);
+
+    for (size_t i = 0; i < count; i++) {
+        if (written[i] != readback[i]) {
+            printf("Vectored I/O test FAILED: mismatch in descriptor %zu (addr 0x%lx)\n", i, writes[i].addr);
+            return -1;
+        }
+    }
+
+    /* Same page, different windows: a word then a block over it, and back. */
+    const uint64_t overlap = 0x1000;
+    uint32_t word = 0x600DF00D;
+    uint32_t block[4] = {0xB10C0000, 0xB10C0001, 0xB10C0002, 0xB10C0003};
+    std::vector<tt_noc_iov_t> ordered = {
+        {(uint8_t)ddr_x, (uint8_t)ddr_y, overlap, &word, sizeof(word)},
+        {(uint8_t)ddr_x, (uint8_t)ddr_y, overlap, block, sizeof(block)},
+    };
+    dev.noc_writev(ordered);
+    uint32_t first = dev.noc_read32(ddr_x, ddr_y, overlap);
+    std::swap(ordered[0], ordered[1]);
+    dev.noc_writev(ordered);
+    uint32_t second = dev.noc_read32(ddr_x, ddr_y, overlap);
+    if (first != block[0] || second != word) {
+        printf("Vectored I/O test FAILED: same-page writes out of order (0x%x, 0x%x)\n", first, second);
+        return -1;
+    }
+
+    printf("Vectored I/O test PASSED\n");
+    return 0;
+}
+
+int noc_engine_test(Device& dev)
+{
+    uint16_t ddr_x = dev.is_wormhole() ? WH_DDR_X : dev.is_blackhole() ? BH_DDR_X : -1;
+    uint16_t ddr_y = dev.is_wormhole() ? WH_DDR_Y : dev.is_blackhole() ? BH_DDR_Y : -1;
+
+    /* Off a window boundary and longer than the workers' windows put together,
+     * so every worker takes several chunks. */
+    const uint64_t addr = 0x100040;
+    const size_t len = 5 * TT_TLB_SIZE_2M + 4096;
+    std::vector<uint8_t> written(len);
+    std::vector<uint8_t> readback(len);
+    fill_with_random_data(written.data(), written.size());
+
+    NocEngine engine(dev, 3);
+
+    /* Two threads waiting on one token both return. */
+    NocEngine::Token token = engine.submit_write(ddr_x, ddr_y, addr, written.data(), len);
+    std::thread other([&] { engine.wait(token); });
+    engine.wait(token);
+    other.join();
+    if (!engine.poll(token)) {
+        printf("NOC engine test FAILED: finished token still pending\n");
+        return -1;
+    }
+
+    std::atomic<int> calls{0};
+    std::atomic<int> result{1};
+    engine.submit_read(ddr_x, ddr_y, addr, readback.data(), len, [&](int status) {
+        result = status;
+        calls++;
+    });
+    engine.drain();
+    if (calls != 1 || result != 0 || readback != written) {
+        printf("NOC engine test FAILED: read back %s (%d callbacks, status %d)\n",
+               readback == written ? "correctly" : "wrong data", calls.load(), result.load());
+        return -1;
+    }
+
+    /* The simulator refuses addresses past its tile span; one bad chunk fails the transfer. */
+    if (dev.is_simulated()) {
+        const uint64_t end = 1ULL << 40;
+        std::vector<uint8_t> scratch(8192);
+        token = engine.submit_read(ddr_x, ddr_y, end - 4096, scratch.data(), scratch.size());
+        try {
+            engine.wait(token);
+            printf("NOC engine test FAILED: bad chunk not reported\n");
+            return -1;
+        } catch (const std::system_error& e) {
+            if (e.code().value() != EINVAL) {
+                printf("NOC engine test FAILED: %s\n", e.what());
+                return -1;
+            }
+        }
+
+        engine.submit_read(ddr_x, ddr_y, end - 4096, scratch.data(), scratch.size(), [&](int status) {
+            result = status;
+        });
+        engine.drain();
+        if (result != -EINVAL) {
+            printf("NOC engine test FAILED: callback got status %d\n", result.load());
+            return -1;
+        }
+    }
+
+    printf("NOC engine test PASSED (%zu workers)\n", engine.get_num_workers());
+    return 0;
+}
+
+int thread_window_test(Device& dev)
+{
+    uint16_t ddr_x = dev.is_wormhole() ? WH_DDR_X : dev.is_blackhole() ? BH_DDR_X : -1;
+    uint16_t ddr_y = dev.is_wormhole() ? WH_DDR_Y : dev.is_blackhole() ? BH_DDR_Y : -1;
+
+    /* Twice as many threads as windows on offer: half must use the shared cache. */
+    const size_t num_threads = 4;
+    const uint64_t spare = 2;
+    const size_t len = TT_TLB_SIZE_2M + 8192;
+    uint64_t baseline = dev.get_stats().thread_windows;     // This thread's, from earlier tests
+    dev.set_thread_window_budget(baseline + spare);
+
+    std::mutex lock;
+    std::condition_variable cv;
+    size_t arrived = 0;
+    bool released = false;
+    std::atomic<int> mismatches{0};
+    std::vector<std::vector<uint8_t>> data(num_threads, std::vector<uint8_t>(len));
+    std::vector<std::thread> threads;
+
+    for (auto& d : data) {
+        fill_with_random_data(d.data(), d.size());
+    }
+
+    for (size_t i = 0; i < num_threads; i++) {
+        threads.emplace_back([&, i] {
+            /* Own region per thread, straddling a window boundary. */
+            uint64_t addr = 0x1000000 + i * 0x400000 + 0x1F0000;
+            const std::vector<uint8_t>& written = data[i];
+            std::vector<uint8_t> readback(len);
+            dev.noc_write(ddr_x, ddr_y, addr, written.data(), len);
+            dev.noc_read(ddr_x, ddr_y, addr, readback.data(), len);
+            if (readback != written) {
+                mismatches++;
+            }
+
+            /* Hold on to the windows until the main thread has counted them. */
+            std::unique_lock<std::mutex> guard(lock);
+            arrived++;
+            cv.notify_all();
+            cv.wait(guard, [&] { return released; });
+        });
+    }
+
+    uint64_t held;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        cv.wait(guard, [&] { return arrived == num_threads; });
+        held = dev.get_stats().thread_windows;
+        released = true;
+        cv.notify_all();
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    uint64_t after = dev.get_stats().thread_windows;
+    dev.set_thread_window_budget(8);    // The library default
+
+    if (mismatches != 0) {
+        printf("Thread window test FAILED: %d threads read back wrong data\n", mismatches.load());
+        return -1;
+    }
+    if (held != baseline + spare) {
+        printf("Thread window test FAILED: %lu windows held with %lu to spare\n", held - baseline, spare);
+        return -1;
+    }
+    if (after != baseline) {
+        printf("Thread window test FAILED: %lu windows left after the threads exited\n", after - baseline);
+        return -1;
+    }
+
+    printf("Thread window test PASSED (%zu threads, %lu windows)\n", num_threads, spare);
+    return 0;
+}
+
+int reserved_window_test(Device& dev)
+{
+    uint16_t ddr_x = dev.is_wormhole() ? WH_DDR_X : dev.is_blackhole() ? BH_DDR_X : -1;
+    uint16_t ddr_y = dev.is_wormhole() ? WH_DDR_Y : dev.is_blackhole() ? BH_DDR_Y : -1;
+    size_t window_size = dev.is_blackhole() ? TT_TLB_SIZE_4G : TT_TLB_SIZE_16M;
+
+    /* Straddles what would be a 2 MiB window boundary in the normal path. */
+    const uint64_t addr = 0x3F0000;
+    std::vector<uint32_t> written(0x10000);
+    std::vector<uint32_t> readback(written.size());
+
+    my_srand(11);
+    for (auto& w : written) {
+        w = my_rand();
+    }
+
+    dev.reserve_window(ddr_x, ddr_y, window_size);
+
+    uint64_t remaps_before = dev.get_stats().tlb_remaps_issued;
+    dev.noc_write(ddr_x, ddr_y, addr, written.data(), written.size() * sizeof(uint32_t));
+    dev.noc_read(ddr_x, ddr_y, addr, readback.data(), readback.size() * sizeof(uint32_t));
+    tt_device_stats_t stats = dev.get_stats();
+
+    dev.release_window(ddr_x, ddr_y);
+
+    if (written != readback) {
+        printf("Reserved window test FAILED: data mismatch\n");
+        return -1;
+    }
+
+    if (stats.tlb_remaps_issued != remaps_before || stats.reserved_windows != 1) {
+        printf("Reserved window test FAILED: %lu remaps, %lu reserved windows\n",
+               stats.tlb_remaps_issued - remaps_before, stats.reserved_windows);
+        return -1;
+    }
+
+    /* Same data through the ordinary path once the reservation is gone. */
+    std::fill(readback.begin(), readback.end(), 0);
+    dev.noc_read(ddr_x, ddr_y, addr, readback.data(), readback.size() * sizeof(uint32_t));
+    if (written != readback) {
+        printf("Reserved window test FAILED: mismatch after release\n");
+        return -1;
+    }
+
+    printf("Reserved window test PASSED\n");
+    return 0;
+}
+
+int dma_arena_test(Device& device)
+{
+    const size_t arena_size = 1ULL << 24;  /* 16 MiB */
+    std::unique_ptr<DmaArena> arena;
+    try {
+        arena = std::make_unique<DmaArena>(device, arena_size);
+    } catch (const std::system_error& e) {
+        printf("DMA arena test SKIPPED: %s\n", e.what());
+        return 0;
+    }
+
+    /* Carve it up with mixed sizes and alignments, then free in a scrambled order. */
+    std::vector<std::unique_ptr<DmaSlice>> slices;
+    my_srand(3);
+    for (;;) {
+        size_t len = ((my_rand() % 64) + 1) * 1024;
+        size_t alignment = (my_rand() % 2) ? 4096 : 64;
+        try {
+            slices.push_back(arena->allocate(len, alignment));
+        } catch (const std::bad_alloc&) {
+            break;
+        }
+    }
+
+    uint8_t* base = static_cast<uint8_t*>(arena->get_buffer().get_mem());
+    uint64_t iova = arena->get_buffer().get_iova();
+    uint64_t noc = arena->get_buffer().get_noc_addr();
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (auto& slice : slices) {
+        size_t offset = slice->get_offset();
+        if (static_cast<uint8_t*>(slice->get_mem()) != base + offset || slice->get_iova() != iova + offset ||
+            slice->get_noc_addr() != noc + offset) {
+            printf("DMA arena test FAILED: slice at 0x%zx has inconsistent addresses\n", offset);
+            return -1;
+        }
+        ranges.push_back({offset, offset + slice->get_len()});
+    }
+    std::sort(ranges.begin(), ranges.end());
+    for (size_t i = 1; i < ranges.size(); i++) {
+        if (ranges[i].first < ranges[i - 1].second) {
+            printf("DMA arena test FAILED: slices overlap at 0x%zx\n", ranges[i].first);
+            return -1;
+        }
+    }
+
+    /* Device writes land in the right slice. */
+    if (!device.is_simulated()) {
+        auto [x, y] = device.get_pcie_coordinates();
+        DmaSlice& slice = *slices[slices.size() / 2];
+        std::vector<uint8_t> pattern(slice.get_len());
+        fill_with_random_data(pattern.data(), pattern.size());
+        device.noc_write(x, y, slice.get_noc_addr(), pattern.data(), pattern.size());
+        device.noc_read32(x, y, slice.get_noc_addr());
+        if (memcmp(slice.get_mem(), pattern.data(), pattern.size()) != 0) {
+            printf("DMA arena test FAILED: NOC write to slice mismatch\n");
+            return -1;
+        }
+    }
+
+    size_t count = slices.size();
+    for (size_t i = 0; i < count; i++) {
+        std::swap(slices[i], slices[my_rand() % count]);
+    }
+    slices.clear();
+
+    if (arena->get_free_bytes() != arena_size || arena->get_free_ranges() != 1) {
+        printf("DMA arena test FAILED: %zu bytes free in %zu ranges after freeing everything\n",
+               arena->get_free_bytes(), arena->get_free_ranges());
+        return -1;
+    }
+
+    printf("DMA arena test PASSED (%zu slices)\n", count);
+    return 0;
+}
+
+int dma_cache_test(Device& device)
+{
+    const size_t page = getpagesize();
+    const size_t len = 64 * page;
+    uint8_t* mem = static_cast<uint8_t*>(
+        mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+    if (mem == MAP_FAILED) {
+        printf("DMA cache test FAILED: mmap: %s\n", strerror(errno));
+        return -1;
+    }
+
+    device.enable_dma_cache(len);
+    tt_device_stats_t before = device.get_stats();
+    int r = 0;
+
+    try {
+        /* Re-mapping the same staging buffer pins once. */
+        uint64_t iova;
+        {
+            DmaMapping first(device, mem, 16 * page, TT_DMA_FLAG_NONE);
+            iova = first.get_iova();
+        }
+        for (int i = 0; i < 100; i++) {
+            DmaMapping again(device, mem, 16 * page, TT_DMA_FLAG_NONE);
+            if (again.get_iova() != iova) {
+                printf("DMA cache test FAILED: IOVA changed on reuse\n");
+                r = -1;
+            }
+        }
+
+        /* A sub-range is a hit at the matching offset. */
+        {
+            DmaMapping inner(device, mem + 4 * page, 4 * page, TT_DMA_FLAG_NONE);
+            if (inner.get_iova() != iova + 4 * page) {
+                printf("DMA cache test FAILED: sub-range IOVA 0x%lx, expected 0x%lx\n", inner.get_iova(),
+                       iova + 4 * page);
+                r = -1;
+            }
+        }
+
+        /* Extending past the cached pin replaces it with one covering both. */
+        { DmaMapping grown(device, mem + 8 * page, 32 * page, TT_DMA_FLAG_NONE); }
+        { DmaMapping covered(device, mem, 40 * page, TT_DMA_FLAG_NONE); }
+    } catch (const std::system_error& e) {
+        printf("DMA cache test SKIPPED: %s\n", e.what());
+        device.disable_dma_cache();
+        munmap(mem, len);
+        return 0;
+    }
+
+    tt_device_stats_t after = device.get_stats();
+    uint64_t hits = after.dma_cache_hits - before.dma_cache_hits;
+    uint64_t misses = after.dma_cache_misses - before.dma_cache_misses;
+    if (hits != 102 || misses != 2 || after.dma_cache_pinned_bytes != 40 * page) {
+        printf("DMA cache test FAILED: %lu hits, %lu misses, %lu bytes pinned\n", hits, misses,
+               after.dma_cache_pinned_bytes);
+        r = -1;
+    }
+
+    device.invalidate_dma_cache(mem, len);
+    if (device.get_stats().dma_cache_pinned_bytes != 0) {
+        printf("DMA cache test FAILED: pins survived invalidation\n");
+        r = -1;
+    }
+
+    device.disable_dma_cache();
+    munmap(mem, len);
+
+    if (r == 0) {
+        printf("DMA cache test PASSED (%lu hits, %lu misses)\n", hits, misses);
+    }
+    return r;
+}
+
+int noc_aperture_test(Device& device)
+{
+    const size_t page = getpagesize();
+    const size_t buf_len = 16 * page;
+    const size_t num_bufs = 8;
+    const size_t budget = 3;
+    const size_t len = num_bufs * buf_len;
+    uint8_t* mem = static_cast<uint8_t*>(
+        mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0));
+    if (mem == MAP_FAILED) {
+        printf("NOC aperture test FAILED: mmap: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int r = 0;
+    uint64_t cycles = 0;
+    try {
+        /* More buffers than the budget allows; buffer 0 stays held throughout. */
+        NocAperture aperture(device, 0, budget);
+        std::vector<NocAperture::Handle> handles;
+        for (size_t i = 0; i < num_bufs; i++) {
+            handles.push_back(aperture.add(mem + i * buf_len, buf_len));
+        }
+
+        uint64_t hot = aperture.acquire(handles[0]);
+        auto [x, y] = device.get_pcie_coordinates();
+        std::vector<uint8_t> pattern(buf_len);
+
+        my_srand(13);
+        for (int round = 0; round < 4 && r == 0; round++) {
+            for (size_t i = 1; i < num_bufs; i++) {
+                size_t n = 1 + my_rand() % (num_bufs - 1);
+                uint64_t noc = aperture.acquire(handles[n]);
+
+                if (aperture.get_resident_count() > budget) {
+                    printf("NOC aperture test FAILED: %zu buffers resident\n", aperture.get_resident_count());
+                    r = -1;
+                }
+
+                if (!device.is_simulated()) {
+                    fill_with_random_data(pattern.data(), pattern.size());
+                    device.noc_write(x, y, noc, pattern.data(), pattern.size());
+                    device.noc_read32(x, y, noc);
+                    if (memcmp(mem + n * buf_len, pattern.data(), pattern.size()) != 0) {
+                        printf("NOC aperture test FAILED: NOC write to buffer %zu mismatch\n", n);
+                        r = -1;
+                    }
+                }
+
+                aperture.release(handles[n]);
+            }
+        }
+
+        if (!aperture.is_resident(handles[0]) || aperture.acquire(handles[0]) != hot) {
+            printf("NOC aperture test FAILED: held buffer was evicted\n");
+            r = -1;
+        }
+        if (aperture.get_evictions() == 0) {
+            printf("NOC aperture test FAILED: nothing was evicted\n");
+            r = -1;
+        }
+        cycles = aperture.get_remaps();
+    } catch (const std::system_error& e) {
+        printf("NOC aperture test SKIPPED: %s\n", e.what());
+        munmap(mem, len);
+        return 0;
+    }
+
+    munmap(mem, len);
+
+    if (r == 0) {
+        printf("NOC aperture test PASSED (%lu remaps)\n", cycles);
+    }
+    return r;
+}
+
+int hugepage_pool_test(Device& device)
+{
+    const size_t page_2m = 1ULL << 21;
+    const size_t pool_pages = 4;
+    HugePagePool pool(0, pool_pages * page_2m);
+    HugePagePool::Stats stats = pool.get_stats();
+    size_t reserved = stats.reserved_2m;
+    int r = 0;
+
+    try {
+        /* The reservation isn't bound to a node, so a buffer wanted on one doesn't come from it. */
+        DmaBuffer elsewhere(device, page_2m, TT_DMA_FLAG_NONE, 0, pool);
+        if (elsewhere.is_pooled()) {
+            printf("Hugepage pool test FAILED: node 0 buffer from an unbound pool\n");
+            r = -1;
+        }
+
+        std::vector<std::unique_ptr<DmaBuffer>> buffers;
+        for (size_t i = 0; i < reserved / page_2m; i++) {
+            buffers.push_back(
+                std::make_unique<DmaBuffer>(device, page_2m, TT_DMA_FLAG_NONE, DmaBuffer::ANY_NODE, pool));
+            if (!buffers.back()->is_pooled() || buffers.back()->get_page_size() != page_2m) {
+                printf("Hugepage pool test FAILED: buffer %zu not from the pool\n", i);
+                r = -1;
+            }
+        }
+        if (pool.get_stats().free_2m != 0) {
+            printf("Hugepage pool test FAILED: %zu bytes left in the pool\n", pool.get_stats().free_2m);
+            r = -1;
+        }
+
+        /* Past the reservation (or without one) it still gets memory, and says what kind. */
+        HugePagePool::Allocation extra = pool.allocate(page_2m);
+        if (extra.pooled || (extra.page_size != page_2m && extra.page_size != 0 &&
+                             extra.page_size != (size_t)getpagesize())) {
+            printf("Hugepage pool test FAILED: fallback allocation page size %zu\n", extra.page_size);
+            r = -1;
+        }
+        pool.free(extra);
+
+        DmaBuffer small(device, getpagesize(), TT_DMA_FLAG_NONE, DmaBuffer::ANY_NODE, pool);
+        if (small.is_pooled() || small.get_page_size() != (size_t)getpagesize()) {
+            printf("Hugepage pool test FAILED: small buffer page size %zu\n", small.get_page_size());
+            r = -1;
+        }
+    } catch (const std::system_error& e) {
+        printf("Hugepage pool test SKIPPED: %s\n", e.what());
+        return 0;
+    }
+
+    stats = pool.get_stats();
+    if (stats.free_2m != reserved) {
+        printf("Hugepage pool test FAILED: %zu of %zu bytes returned\n", stats.free_2m, reserved);
+        r = -1;
+    }
+
+    if (r == 0) {
+        printf("Hugepage pool test PASSED (%zu MiB reserved; %lu pooled, %lu hugetlb, %lu THP, %lu small)\n",
+               reserved >> 20, stats.from_pool, stats.from_hugetlb, stats.from_thp, stats.from_small_pages);
+    }
+    return r;
+}
+
+int coherent_dma_test(Device& device)
+{
+    const size_t len = 1 << 16;
+    int r = 0;
+
+    try {
+        DmaBuffer coherent(device, len, DmaPolicy::Coherent);
+        if (coherent.get_policy() != DmaPolicy::Coherent || coherent.get_noc_addr() == ~0ULL) {
+            printf("Coherent DMA test FAILED: buffer has no NOC address\n");
+            return -1;
+        }
+
+        if (!device.is_simulated()) {
+            auto [x, y] = device.get_pcie_coordinates();
+            std::vector<uint8_t> pattern(len);
+            fill_with_random_data(pattern.data(), pattern.size());
+            device.noc_write(x, y, coherent.get_noc_addr(), pattern.data(), pattern.size());
+            device.noc_read32(x, y, coherent.get_noc_addr());
+            if (memcmp(coherent.get_mem(), pattern.data(), pattern.size()) != 0) {
+                printf("Coherent DMA test FAILED: NOC write mismatch\n");
+                r = -1;
+            }
+        }
+
+        /* On a coherent host Auto buffers come and go without using up the
+         * driver's coherent ones (256, never freed); elsewhere they are those. */
+        bool expect_coherent = !device.is_dma_coherent();
+        int rounds = expect_coherent ? 1 : 300;
+        for (int i = 0; i < rounds; i++) {
+            DmaBuffer automatic(device, len, DmaPolicy::Auto);
+            if ((automatic.get_policy() == DmaPolicy::Coherent) != expect_coherent) {
+                printf("Coherent DMA test FAILED: auto policy chose %s\n",
+                       automatic.get_policy() == DmaPolicy::Coherent ? "coherent" : "pinned");
+                r = -1;
+                break;
+            }
+        }
+
+        if (r == 0) {
+            printf("Coherent DMA test PASSED (auto chose %s)\n", expect_coherent ? "coherent" : "pinned");
+        }
+    } catch (const std::system_error& e) {
+        printf("Coherent DMA test SKIPPED: %s\n", e.what());
+        return 0;
+    }
+
+    return r;
+}
+
+int dma_read_test(Device& dev)
+{
+    uint16_t ddr_x = dev.is_wormhole() ? WH_DDR_X : dev.is_blackhole() ? BH_DDR_X : -1;
+    uint16_t ddr_y = dev.is_wormhole() ? WH_DDR_Y : dev.is_blackhole() ? BH_DDR_Y : -1;
+    const uint64_t addr = 0x1000000;
+    const size_t len = 1 << 20;
+    std::vector<uint8_t> pattern(len);
+    const char* path = "MMIO";
+
+    fill_with_random_data(pattern.data(), pattern.size());
+    dev.noc_write(ddr_x, ddr_y, addr, pattern.data(), pattern.size());
+
+    if (dev.is_blackhole() && !dev.is_simulated()) {
+        try {
+            dev.start_copy_engine();
+            path = "copy engine";
+        } catch (const std::exception& e) {
+            printf("Device DMA read: copy engine unavailable (%s), using MMIO\n", e.what());
+        }
+    }
+
+    int r = 0;
+    {
+        DmaBuffer buf(dev, 2 * len);
+        uint8_t* mem = static_cast<uint8_t*>(buf.get_mem());
+
+        /* Bulk read at an offset, then a small unaligned one that stays on MMIO. */
+        memset(mem, 0, buf.get_len());
+        dev.dma_read(ddr_x, ddr_y, addr, buf, len, len);
+        dev.dma_read(ddr_x, ddr_y, addr + 4, buf, 4, 100);
+
+        if (memcmp(mem + len, pattern.data(), len) != 0) {
+            printf("Device DMA read test FAILED: bulk data mismatch\n");
+            r = -1;
+        } else if (memcmp(mem + 4, pattern.data() + 4, 100) != 0 || mem[0] != 0 || mem[104] != 0) {
+            printf("Device DMA read test FAILED: small read mismatch\n");
+            r = -1;
+        }
+    }
+
+    dev.stop_copy_engine();
+
+    if (r == 0) {
+        printf("Device DMA read test PASSED (%s)\n", path);
+    }
+    return r;
+}
+
+int dma_write_test(Device& dev)
+{
+    uint16_t ddr_x = dev.is_wormhole() ? WH_DDR_X : dev.is_blackhole() ? BH_DDR_X : -1;
+    uint16_t ddr_y = dev.is_wormhole() ? WH_DDR_Y : dev.is_blackhole() ? BH_DDR_Y : -1;
+    const uint64_t addr = 0x2000000;
+    const size_t len = 1 << 20;
+    const size_t pieces = 16;
+    const char* path = "MMIO";
+
+    if (dev.is_blackhole() && !dev.is_simulated()) {
+        try {
+            dev.start_copy_engine();
+            path = "copy engine";
+        } catch (const std::exception& e) {
+            printf("Device DMA write: copy engine unavailable (%s), using MMIO\n", e.what());
+        }
+    }
+
+    int r = 0;
+    {
+        DmaBuffer buf(dev, len);
+        std::vector<uint8_t> readback(len);
+        fill_with_random_data(buf.get_mem(), len);
+
+        /* One synchronous upload, then the same data again as queued pieces. */
+        dev.dma_write(ddr_x, ddr_y, addr, buf, 0, len);
+        dev.noc_read(ddr_x, ddr_y, addr, readback.data(), len);
+        if (memcmp(readback.data(), buf.get_mem(), len) != 0) {
+            printf("Device DMA write test FAILED: data mismatch\n");
+            r = -1;
+        }
+
+        if (r == 0 && dev.get_copy_engine()) {
+            CopyEngine& engine = *dev.get_copy_engine();
+            auto [pcie_x, pcie_y] = dev.get_pcie_coordinates();
+            uint32_t ticket = 0;
+            for (size_t i = 0; i < pieces; i++) {
+                size_t off = i * (len / pieces);
+                ticket = engine.submit(pcie_x, pcie_y, buf.get_noc_addr() + off, ddr_x, ddr_y, addr + len + off,
+                                       len / pieces);
+            }
+            engine.wait(ticket);
+
+            dev.noc_read(ddr_x, ddr_y, addr + len, readback.data(), len);
+            if (memcmp(readback.data(), buf.get_mem(), len) != 0) {
+                printf("Device DMA write test FAILED: queued upload mismatch\n");
+                r = -1;
+            }
+        }
+    }
+
+    dev.stop_copy_engine();
+
+    if (r == 0) {
+        printf("Device DMA write test PASSED (%s)\n", path);
+    }
+    return r;
+}
+
+int copy_engine_group_test(Device& dev)
+{
+    if (!dev.is_blackhole() || dev.is_simulated()) {
+        printf("Copy engine group test SKIPPED (needs Blackhole hardware)\n");
+        return 0;
+    }
+
+    const uint64_t addr = 0x3000000;
+    const size_t len = 1 << 20;
+    const size_t stripe = 64 * 1024;
+    int r = 0;
+
+    try {
+        CopyEngineGroup group(dev, 4, 4, stripe);
+        DmaBuffer buf(dev, 2 * len);
+        uint8_t* mem = static_cast<uint8_t*>(buf.get_mem());
+        std::vector<uint8_t> readback(stripe);
+        auto channels = dev.get_gddr_coordinates();
+
+        for (size_t i = 0; i < group.get_core_count(); i++) {
+            CopyEngine& engine = group.get_engine(i);
+            if (!dev.is_reserved_core(engine.get_x(), engine.get_y())) {
+                printf("Copy engine group test FAILED: core (%u, %u) not reserved\n", engine.get_x(), engine.get_y());
+                return -1;
+            }
+        }
+
+        fill_with_random_data(mem, len);
+        CopyEngineGroup::Transfer upload = group.submit_write(addr, buf, 0, len);
+        group.wait(upload);
+        if (group.get_shards_done(upload) != len / stripe) {
+            printf("Copy engine group test FAILED: %zu of %zu shards done\n", group.get_shards_done(upload),
+                   len / stripe);
+            return -1;
+        }
+
+        /* Stripe k is on channel k % 4. */
+        for (size_t k = 0; k < len / stripe; k++) {
+            auto [x, y] = channels[k % 4];
+            dev.noc_read(x, y, addr + (k / 4) * stripe, readback.data(), stripe);
+            if (memcmp(readback.data(), mem + k * stripe, stripe) != 0) {
+                printf("Copy engine group test FAILED: stripe %zu not on channel (%u, %u)\n", k, x, y);
+                return -1;
+            }
+        }
+
+        group.read(addr, buf, len, len);
+        if (memcmp(mem, mem + len, len) != 0) {
+            printf("Copy engine group test FAILED: readback mismatch\n");
+            r = -1;
+        }
+        if (group.get_cycles_per_byte() <= 0) {
+            printf("Copy engine group test FAILED: no cycle counts from the cores\n");
+            r = -1;
+        }
+    } catch (const std::runtime_error& e) {
+        printf("Copy engine group test SKIPPED: %s\n", e.what());
+        return 0;
+    }
+
+    if (r == 0) {
+        printf("Copy engine group test PASSED\n");
+    }
+    return r;
+}
+
+int completion_test(Device& dev)
+{
+    using namespace std::chrono;
+
+    try {
+        Completion completion(dev);
+        int r = 0;
+
+        /* Another thread stands in for the device. */
+        std::thread writer([&] {
+            std::this_thread::sleep_for(milliseconds(20));
+            __atomic_store_n(completion.get_word(), 7, __ATOMIC_RELEASE);
+        });
+        auto start = steady_clock::now();
+        bool done = completion.wait(7, seconds(5));
+        auto waited = duration_cast<microseconds>(steady_clock::now() - start).count();
+        writer.join();
+        if (!done || completion.get() != 7) {
+            printf("Completion test FAILED: missed the write\n");
+            r = -1;
+        }
+
+        /* Sequence numbers compare with wrap. */
+        completion.reset(0x80000001);
+        if (r == 0 && (!completion.wait_seq(0x7FFFFFFF, milliseconds(1)) || completion.wait_seq(0x80000002, 0ns))) {
+            printf("Completion test FAILED: sequence comparison\n");
+            r = -1;
+        }
+
+        start = steady_clock::now();
+        if (r == 0 && (completion.wait(8, milliseconds(10)) || steady_clock::now() - start < milliseconds(10))) {
+            printf("Completion test FAILED: timeout not honoured\n");
+            r = -1;
+        }
+
+        /* The real thing: a write through the PCIe tile into the word. */
+        if (r == 0 && !dev.is_simulated()) {
+            auto [x, y] = completion.get_noc_xy();
+            completion.reset();
+            dev.noc_write32(x, y, completion.get_noc_addr(), 0xC0DEC0DE);
+            if (!completion.wait(0xC0DEC0DE, seconds(1))) {
+                printf("Completion test FAILED: NOC write never arrived\n");
+                r = -1;
+            }
+        }
+
+        if (r == 0) {
+            printf("Completion test PASSED (woke %ld us after a 20 ms write; UMWAIT %s)\n", (long)waited,
+                   Completion::has_umwait() ? "available" : "unavailable");
+        }
+        return r;
+    } catch (const std::system_error& e) {
+        printf("Completion test SKIPPED: %s\n", e.what());
+        return 0;
+    }
+}
+
+int command_ring_test(Device& dev)
+{
+    const uint64_t mailbox = 0x10000;
+    const size_t entries = 16;      // Doorbell every 4
+    NocRect rect = dev.get_tensix_rect();
+    uint16_t x = rect.x_start;
+    uint16_t y = rect.y_start;
+
+    while (!dev.is_tensix(x, y) || dev.is_reserved_core(x, y)) {
+        if (++x > rect.x_end) {
+            x = rect.x_start;
+            if (++y > rect.y_end) {
+                printf("Command ring test SKIPPED (no free Tensix core)\n");
+                return 0;
+            }
+        }
+    }
+
+    /* The host side alone, with this thread playing the core. */
+    try {
+        CommandRing ring(dev, x, y, mailbox, entries);
+        volatile uint32_t* head = ring.get_completion_word();
+
+        uint32_t ticket = 0;
+        for (uint32_t i = 0; i < 3; i++) {
+            ticket = ring.push(100 + i, {i, i * 2});
+        }
+        if (dev.noc_read32(x, y, mailbox + CommandRing::DOORBELL) != 0) {
+            printf("Command ring test FAILED: doorbell rung early\n");
+            return -1;
+        }
+        ring.flush();
+        if (dev.noc_read32(x, y, mailbox + CommandRing::DOORBELL) != ticket) {
+            printf("Command ring test FAILED: doorbell not rung\n");
+            return -1;
+        }
+        for (uint32_t i = 0; i < 3; i++) {
+            const CommandRing::Command& cmd = ring.get_command(i);
+            if (cmd.opcode != 100 + i || cmd.seq != i || cmd.args[1] != i * 2 || cmd.args[2] != 0) {
+                printf("Command ring test FAILED: slot %u holds the wrong command\n", i);
+                return -1;
+            }
+        }
+
+        __atomic_store_n(head, 2, __ATOMIC_RELEASE);
+        if (!ring.is_done(2) || ring.is_done(3) || ring.get_pending() != 1) {
+            printf("Command ring test FAILED: completion accounting\n");
+            return -1;
+        }
+
+        /* Fill the ring; the next push waits for the "core" to retire one. */
+        for (size_t i = ring.get_pending(); i < entries; i++) {
+            ring.push(0);
+        }
+        std::thread core([&] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            __atomic_store_n(head, 3, __ATOMIC_RELEASE);
+        });
+        ticket = ring.push(7);
+        core.join();
+        if (ticket != 3 + entries || ring.get_command(ticket - 1).opcode != 7 ||
+            dev.noc_read32(x, y, mailbox + CommandRing::DOORBELL) != ticket - 1) {
+            printf("Command ring test FAILED: wrap-around\n");
+            return -1;
+        }
+    } catch (const std::system_error& e) {
+        printf("Command ring test SKIPPED: %s\n", e.what());
+        return 0;
+    }
+
+    if (!dev.is_blackhole() || dev.is_simulated()) {
+        printf("Command ring test PASSED (host side only)\n");
+        return 0;
+    }
+
+    /* The real thing: one launch, then a stream of commands. */
+    const int nops = 10000;
+    double us_per_command = 0;
+    try {
+        CommandServer server(dev, x, y);
+        auto start = std::chrono::steady_clock::now();
+        uint32_t ticket = 0;
+        for (int i = 0; i < nops; i++) {
+            ticket = server.nop();
+        }
+        server.wait(ticket);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        us_per_command = std::chrono::duration<double, std::micro>(elapsed).count() / nops;
+
+        server.wait(server.store32(0x30000, 0xFEEDF00D));
+        if (dev.noc_read32(x, y, 0x30000) != 0xFEEDF00D) {
+            printf("Command ring test FAILED: store not done\n");
+            return -1;
+        }
+
+        const size_t len = 1 << 20;
+        DmaBuffer buf(dev, 2 * len);
+        uint8_t* mem = static_cast<uint8_t*>(buf.get_mem());
+        auto [pcie_x, pcie_y] = dev.get_pcie_coordinates();
+        fill_with_random_data(mem, len);
+        memset(mem + len, 0, len);
+        server.wait(server.copy(pcie_x, pcie_y, buf.get_noc_addr(), pcie_x, pcie_y, buf.get_noc_addr() + len, len));
+        if (memcmp(mem, mem + len, len) != 0) {
+            printf("Command ring test FAILED: copy mismatch\n");
+            return -1;
+        }
+    } catch (const std::runtime_error& e) {
+        printf("Command ring test SKIPPED: %s\n", e.what());
+        return 0;
+    }
+
+    printf("Command ring test PASSED (%.2f us per command over %d)\n", us_per_command, nops);
+    return 0;
+}
+
+int multicast_test(Device& dev)
+{
+    /* Tensix rectangles of the whole grid, a column of them at a time. */
+    std::vector<NocRect> expected;
+    if (dev.is_wormhole()) {
+        expected = {{1, 1, 4, 5}, {1, 7, 4, 11}, {6, 1, 9, 5}, {6, 7, 9, 11}};
+    } else {
+        expected = {{1, 2, 7, 11}, {10, 2, 16, 11}};
+    }
+    auto same = [](const std::vector<NocRect>& a, const std::vector<NocRect>& b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const NocRect& p, const NocRect& q) {
+            return p.x_start == q.x_start && p.y_start == q.y_start && p.x_end == q.x_end && p.y_end == q.y_end;
+        });
+    };
+    NocRect grid = dev.get_tensix_rect();
+    std::vector<uint8_t> data(4096);
+    fill_with_random_data(data.data(), data.size());
+
+    /* Unknown harvesting (Wormhole hardware) must refuse rather than guess. */
+    if (!dev.is_harvesting_known()) {
+        try {
+            dev.noc_multicast_write(grid, 0x20000, data.data(), data.size());
+        } catch (const std::runtime_error&) {
+            printf("Multicast test PASSED (harvesting unknown; refused)\n");
+            return 0;
+        }
+        printf("Multicast test FAILED: multicast with unknown harvesting\n");
+        return -1;
+    }
+
+    uint64_t saved_x = dev.get_harvested_tensix_x();
+    uint64_t saved_y = dev.get_harvested_tensix_y();
+
+    if (saved_x == 0 && saved_y == 0 && !same(dev.split_tensix_rect(grid), expected)) {
+        printf("Multicast test FAILED: wrong split of the Tensix grid\n");
+        return -1;
+    }
+
+    /* Harvesting the last column pulls in the right edge of the rectangles touching it. */
+    dev.set_harvested_tensix(1ULL << grid.x_end, 0);
+    std::vector<NocRect> split = dev.split_tensix_rect(grid);
+    for (NocRect& rect : expected) {
+        if (rect.x_end == grid.x_end) {
+            rect.x_end--;
+        }
+    }
+    bool harvested_ok = same(split, expected);
+    dev.set_harvested_tensix(saved_x, saved_y);
+    if (!harvested_ok) {
+        printf("Multicast test FAILED: harvested column still covered\n");
+        return -1;
+    }
+
+    if (!dev.is_simulated()) {
+        printf("Multicast test PASSED (split only; writes need the simulator)\n");
+        return 0;
+    }
+
+    /* A simulated device only delivers multicasts to each rectangle's first core. */
+    const uint64_t addr = 0x20000;
+    std::vector<uint8_t> readback(data.size());
+    dev.noc_multicast_write(grid, addr, data.data(), data.size());
+    for (const NocRect& rect : dev.split_tensix_rect(grid)) {
+        dev.noc_read(rect.x_start, rect.y_start, addr, readback.data(), readback.size());
+        if (readback != data) {
+            printf("Multicast test FAILED: data missing at (%u, %u)\n", rect.x_start, rect.y_start);
+            return -1;
+        }
+    }
+
+    printf("Multicast test PASSED\n");
+    return 0;
+}
+
+int kernel_launch_test(Device& dev)
+{
+    if (!dev.is_blackhole()) {
+        printf("Kernel launch test SKIPPED (Blackhole only)\n");
+        return 0;
+    }
+
+    const uint64_t args_at = Kernel::ARGS_ADDR + Kernel::HEADER_WORDS * 4;
+    const uint16_t held_x = 3, held_y = 5;
+    NocRect grid = dev.get_tensix_rect();
+    size_t expected = 0;
+    for (uint16_t y = grid.y_start; y <= grid.y_end; y++) {
+        for (uint16_t x = grid.x_start; x <= grid.x_end; x++) {
+            expected += dev.is_tensix(x, y) && !dev.is_reserved_core(x, y);
+        }
+    }
+
+    /* Someone else's core inside the grid must come through untouched. */
+    dev.reserve_core(held_x, held_y);
+    dev.noc_write32(held_x, held_y, args_at, 0x5AFE5AFE);
+    int r = 0;
+
+    try {
+        /* Real cores run what they're given, so only the simulator gets random bytes. */
+        std::vector<uint8_t> program(256);
+        if (dev.is_simulated()) {
+            fill_with_random_data(program.data(), program.size());
+        } else {
+            program = read_firmware("tensix/grid_hello.bin");
+            program.resize((program.size() + 3) & ~size_t(3));
+        }
+        auto kernel = dev.launch(grid, program, [](uint16_t x, uint16_t y) {
+            return std::vector<uint32_t>{(uint32_t)(x * 100 + y)};
+        });
+
+        if (kernel->get_cores().size() != expected - 1 || dev.get_reserved_cores().size() != expected) {
+            printf("Kernel launch test FAILED: launched on %zu cores\n", kernel->get_cores().size());
+            r = -1;
+        }
+        if (kernel->get_multicast_count() != 3 * kernel->get_rects().size()) {
+            printf("Kernel launch test FAILED: %zu multicasts\n", kernel->get_multicast_count());
+            r = -1;
+        }
+        for (auto [x, y] : kernel->get_cores()) {
+            if (dev.noc_read32(x, y, args_at) != (uint32_t)(x * 100 + y)) {
+                printf("Kernel launch test FAILED: core (%u, %u) has the wrong arguments\n", x, y);
+                r = -1;
+                break;
+            }
+        }
+        if (dev.noc_read32(held_x, held_y, args_at) != 0x5AFE5AFE) {
+            printf("Kernel launch test FAILED: reserved core written\n");
+            r = -1;
+        }
+
+        /* A simulated device only delivers multicasts to each rectangle's first core. */
+        std::vector<uint8_t> loaded(program.size());
+        for (const NocRect& rect : kernel->get_rects()) {
+            dev.noc_read(rect.x_start, rect.y_start, 0x0, loaded.data(), loaded.size());
+            if (loaded != program) {
+                printf("Kernel launch test FAILED: program missing at (%u, %u)\n", rect.x_start, rect.y_start);
+                r = -1;
+                break;
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        printf("Kernel launch test SKIPPED: %s\n", e.what());
+        dev.release_core(held_x, held_y);
+        return 0;
+    }
+
+    if (r == 0 && dev.get_reserved_cores().size() != 1) {
+        printf("Kernel launch test FAILED: cores still reserved\n");
+        r = -1;
+    }
+    dev.release_core(held_x, held_y);
+
+    if (r != 0 || dev.is_simulated()) {
+        if (r == 0) {
+            printf("Kernel launch test PASSED (%zu cores; simulated, not run)\n", expected - 1);
+        }
+        return r;
+    }
+
+    /* The real thing: every core runs, with shared arguments. */
+    try {
+        auto start = std::chrono::steady_clock::now();
+        auto kernel = dev.launch(grid, "tensix/grid_hello.bin", [](uint16_t, uint16_t) {
+            return std::vector<uint32_t>{1000};
+        });
+        kernel->wait();
+        auto us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        for (auto [x, y] : kernel->get_cores()) {
+            if (kernel->get_result(x, y) != 1000u + ((y << 6) | x)) {
+                printf("Kernel launch test FAILED: core (%u, %u) reported 0x%x\n", x, y, kernel->get_result(x, y));
+                return -1;
+            }
+        }
+        printf("Kernel launch test PASSED (%zu cores in %.0f us, %zu multicasts)\n", kernel->get_cores().size(), us,
+               kernel->get_multicast_count());
+    } catch (const std::runtime_error& e) {
+        printf("Kernel launch test SKIPPED: %s\n", e.what());
+    }
+    return 0;
+}
+
+/* A two-segment firmware ELF like tensix/linker.ld makes: code at 0, then
+ * 16 bytes of .data and 16 of .bss at 0x100, with symbols for both. */
+static std::vector<uint8_t> make_test_elf(const std::vector<uint8_t>& text)
+{
+    const char names[] = "\0counter\0buffer\0";
+    const uint32_t data_words[4] = {0x11111111, 0x22222222, 0x33333333, 0x44444444};
+    const uint32_t text_off = 128, data_off = text_off + text.size();
+    const uint32_t str_off = data_off + sizeof(data_words), sym_off = str_off + sizeof(names);
+    const uint32_t sh_off = sym_off + 3 * sizeof(Elf32_Sym);
+
+    std::vector<uint8_t> elf(sh_off + 3 * sizeof(Elf32_Shdr));
+    Elf32_Ehdr eh = {};
+    memcpy(eh.e_ident, ELFMAG, SELFMAG);
+    eh.e_ident[EI_CLASS] = ELFCLASS32;
+    eh.e_ident[EI_DATA] = ELFDATA2LSB;
+    eh.e_ident[EI_VERSION] = EV_CURRENT;
+    eh.e_type = ET_EXEC;
+    eh.e_machine = EM_RISCV;
+    eh.e_version = EV_CURRENT;
+    eh.e_phoff = sizeof(eh);
+    eh.e_shoff = sh_off;
+    eh.e_ehsize = sizeof(eh);
+    eh.e_phentsize = sizeof(Elf32_Phdr);
+    eh.e_phnum = 2;
+    eh.e_shentsize = sizeof(Elf32_Shdr);
+    eh.e_shnum = 3;
+    memcpy(elf.data(), &eh, sizeof(eh));
+
+    Elf32_Phdr ph[2] = {
+        {PT_LOAD, text_off, 0x0, 0x0, (uint32_t)text.size(), (uint32_t)text.size(), PF_R | PF_X, 4},
+        {PT_LOAD, data_off, 0x100, 0x100, sizeof(data_words), 2 * sizeof(data_words), PF_R | PF_W, 4},
+    };
+    memcpy(elf.data() + eh.e_phoff, ph, sizeof(ph));
+    memcpy(elf.data() + text_off, text.data(), text.size());
+    memcpy(elf.data() + data_off, data_words, sizeof(data_words));
+    memcpy(elf.data() + str_off, names, sizeof(names));
+
+    Elf32_Sym syms[3] = {
+        {},
+        {1, 0x100, 4, ELF32_ST_INFO(STB_GLOBAL, STT_OBJECT), 0, 0},
+        {9, 0x110, 16, ELF32_ST_INFO(STB_GLOBAL, STT_OBJECT), 0, 0},
+    };
+    memcpy(elf.data() + sym_off, syms, sizeof(syms));
+
+    Elf32_Shdr sh[3] = {
+        {},
+        {0, SHT_SYMTAB, 0, 0, sym_off, sizeof(syms), 2, 1, 4, sizeof(Elf32_Sym)},
+        {0, SHT_STRTAB, 0, 0, str_off, sizeof(names), 0, 0, 1, 0},
+    };
+    memcpy(elf.data() + sh_off, sh, sizeof(sh));
+    return elf;
+}
+
+int firmware_loader_test(Device& dev)
+{
+    std::vector<uint8_t> text(64);
+    fill_with_random_data(text.data(), text.size());
+    std::vector<uint8_t> elf = make_test_elf(text);
+
+    char path[] = "/tmp/holething-fw-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("Firmware loader test SKIPPED (no temporary file)\n");
+        return 0;
+    }
+    bool written = write(fd, elf.data(), elf.size()) == (ssize_t)elf.size();
+    close(fd);
+    std::unique_ptr<Firmware> fw;
+    try {
+        if (written) {
+            fw = std::make_unique<Firmware>(path);
+        }
+    } catch (const std::runtime_error& e) {
+        printf("Firmware loader test FAILED: %s\n", e.what());
+    }
+    unlink(path);
+    if (!fw) {
+        return -1;
+    }
+
+    /* Only the PT_LOAD segments, .bss zero-filled. */
+    const auto& segs = fw->get_segments();
+    if (segs.size() != 2 || segs[0].addr != 0x0 || segs[0].data != text || segs[0].writable || segs[1].addr != 0x100 ||
+        segs[1].data.size() != 32 || !segs[1].writable || segs[1].data[16] != 0 || fw->get_end() != 0x120) {
+        printf("Firmware loader test FAILED: wrong segments\n");
+        return -1;
+    }
+    if (fw->get_symbol("counter") != 0x100 || fw->get_symbol("buffer") != 0x110 || fw->has_symbol("missing")) {
+        printf("Firmware loader test FAILED: wrong symbols\n");
+        return -1;
+    }
+    try {
+        fw->get_symbol("missing");
+        printf("Firmware loader test FAILED: missing symbol found\n");
+        return -1;
+    } catch (const std::runtime_error&) {
+    }
+
+    if (!dev.is_blackhole()) {
+        printf("Firmware loader test PASSED (ELF only; cache is Blackhole only)\n");
+        return 0;
+    }
+
+    /* One core, held in reset: code goes up once, variables every time. */
+    static constexpr uint64_t TENSIX_RESET_REG = 0xFFB121B0;
+    static constexpr uint32_t TENSIX_IN_RESET = 0x47800;
+    NocRect grid = dev.get_tensix_rect();
+    uint16_t x = grid.x_start, y = grid.y_start;
+    int r = 0;
+
+    dev.reserve_core(x, y);
+    dev.noc_write32(x, y, TENSIX_RESET_REG, TENSIX_IN_RESET);
+    dev.noc_write32(x, y, fw->get_symbol("buffer"), 0xFFFFFFFF);
+
+    bool first = dev.load_firmware(x, y, *fw);
+    dev.noc_write32(x, y, 0x0, ~dev.noc_read32(x, y, 0x0));
+    dev.noc_write32(x, y, fw->get_symbol("counter"), 0xDEAD);
+    bool second = dev.load_firmware(x, y, *fw);
+
+    if (!first || second || dev.noc_read32(x, y, fw->get_symbol("counter")) != 0x11111111 ||
+        dev.noc_read32(x, y, fw->get_symbol("buffer")) != 0) {
+        printf("Firmware loader test FAILED: variables not reloaded\n");
+        r = -1;
+    }
+    uint32_t word0;
+    memcpy(&word0, text.data(), sizeof(word0));
+    if (r == 0 && dev.noc_read32(x, y, 0x0) == word0) {
+        printf("Firmware loader test FAILED: cached code uploaded again\n");
+        r = -1;
+    }
+
+    dev.forget_core_image(x, y);
+    if (r == 0 && (!dev.load_firmware(x, y, *fw) || dev.noc_read32(x, y, 0x0) != word0)) {
+        printf("Firmware loader test FAILED: forgotten code not uploaded\n");
+        r = -1;
+    }
+    dev.release_core(x, y);
+    if (r != 0) {
+        return r;
+    }
+
+    /* Relaunching the same ELF on a grid skips one multicast per rectangle and
+     * read-only segment.  Real cores run what they're given, so only the
+     * simulator gets the synthetic ELF. */
+    if (!dev.is_simulated()) {
+        try {
+            fw = std::make_unique<Firmware>("tensix/grid_hello.elf");
+        } catch (const std::runtime_error& e) {
+            printf("Firmware loader test PASSED (launch SKIPPED: %s)\n", e.what());
+            return 0;
+        }
+    }
+
+    try {
+        auto args = [](uint16_t, uint16_t) { return std::vector<uint32_t>{1000}; };
+        size_t code = std::count_if(fw->get_segments().begin(), fw->get_segments().end(),
+                                    [](const Firmware::Segment& seg) { return !seg.writable; });
+        size_t cold, warm;
+        {
+            auto kernel = dev.launch(grid, *fw, args);
+            cold = kernel->get_multicast_count();
+            r = kernel->was_cached() ? -1 : 0;
+            if (!dev.is_simulated()) {
+                kernel->wait();
+            }
+        }
+        {
+            auto kernel = dev.launch(grid, *fw, args);
+            warm = kernel->get_multicast_count();
+            if (!kernel->was_cached() || warm != cold - code * kernel->get_rects().size()) {
+                r = -1;
+            }
+            if (!dev.is_simulated()) {
+                kernel->wait();
+            }
+        }
+        if (r != 0) {
+            printf("Firmware loader test FAILED: %zu then %zu multicasts\n", cold, warm);
+            return r;
+        }
+        printf("Firmware loader test PASSED (%zu then %zu multicasts)\n", cold, warm);
+    } catch (const std::system_error& e) {
+        printf("Firmware loader test PASSED (launch SKIPPED: %s)\n", e.what());
+    } catch (const std::runtime_error& e) {
+        printf("Firmware loader test FAILED: %s\n", e.what());
+        return -1;
+    }
+
+    return 0;
+}
 
 int run_tests(Device& device)
 {
@@ -409,6 +1712,97 @@ int run_tests(Device& device)
         return -1;
     }
 
+    // Scattered writes and reads through tt_noc_writev/readv
+    if (vectored_io_test(device) != 0) {
+        return -1;
+    }
+
+    // Transfers split across a pool of worker threads
+    if (noc_engine_test(device) != 0) {
+        return -1;
+    }
+
+    // Threads with windows of their own, and those left to the shared cache
+    if (thread_window_test(device) != 0) {
+        return -1;
+    }
+
+    // Transfers through a window reserved for the DDR tile
+    if (reserved_window_test(device) != 0) {
+        return -1;
+    }
+
+    // Sub-allocation from one pinned region
+    if (dma_arena_test(device) != 0) {
+        return -1;
+    }
+
+    // Re-mapping the same host memory with the registration cache
+    if (dma_cache_test(device) != 0) {
+        return -1;
+    }
+
+    // DMA buffers from reserved huge pages, and the fallbacks
+    if (hugepage_pool_test(device) != 0) {
+        return -1;
+    }
+
+    // Driver-allocated buffers and the automatic allocation policy
+    if (coherent_dma_test(device) != 0) {
+        return -1;
+    }
+
+    // Cycling more host buffers than the aperture budget allows
+    if (noc_aperture_test(device) != 0) {
+        return -1;
+    }
+
+    // GDDR readback pushed into host memory by a Tensix core, or MMIO
+    if (dma_read_test(device) != 0) {
+        return -1;
+    }
+
+    // GDDR uploads pulled from host memory by the same core
+    if (dma_write_test(device) != 0) {
+        return -1;
+    }
+
+    // A transfer interleaved across GDDR channels by several cores
+    if (copy_engine_group_test(device) != 0) {
+        return -1;
+    }
+
+    // Waiting on a host-memory word the device writes
+    if (completion_test(device) != 0) {
+        return -1;
+    }
+
+    // Commands queued for a persistent kernel
+    if (command_ring_test(device) != 0) {
+        return -1;
+    }
+
+    // One write to every Tensix core, split around non-Tensix columns and rows
+    if (multicast_test(device) != 0) {
+        return -1;
+    }
+
+    // One program on the whole grid, by multicast
+    if (kernel_launch_test(device) != 0) {
+        return -1;
+    }
+
+    // ELF loading and the per-core image cache
+    if (firmware_loader_test(device) != 0) {
+        return -1;
+    }
+
+    // The simulator doesn't route the PCIe tile to host memory.
+    if (device.is_simulated()) {
+        printf("NOC DMA tests SKIPPED (simulated device)\n");
+        return 0;
+    }
+
     // 4096 KiB DMA test
     if (test_noc_dma(device, 12) != 0) {
         return -1;
@@ -441,9 +1835,10 @@ int run(std::string device_path)
 }
 
 void print_usage(const char* prog_name) {
-    fprintf(stderr, "Usage: %s <device_id | -1>\n", prog_name);
+    fprintf(stderr, "Usage: %s <device_id | -1 | sim:<arch>>\n", prog_name);
     fprintf(stderr, "  <device_id>: The ID of the specific device to test (e.g., 0).\n");
     fprintf(stderr, "  -1:          Test all available devices.\n");
+    fprintf(stderr, "  sim:<arch>:  Test a simulated device (sim:blackhole or sim:wormhole).\n");
 }
 
 int main(int argc, char *argv[])
@@ -480,6 +1875,9 @@ int main(int argc, char *argv[])
             return 0;
         }
 
+    } else if (arg.rfind("sim:", 0) == 0) {
+        // Run on a simulated device, e.g. sim:blackhole.
+        return run(arg);
     } else {
         // Run on a single, specified device.
         std::string device_path = "/dev/tenstorrent/" + arg;
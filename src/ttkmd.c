@@ -4,18 +4,13 @@
  */
 
 #include "ttkmd.h"
-
-#include "ioctl.h"    /* From tt-kmd */
+#include "ttkmd_backend.h"
 
 #include <errno.h>
-#include <fcntl.h>
-#include <linux/mman.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/ioctl.h>
-#include <sys/mman.h>
 #include <unistd.h>
 
 #define BLACKHOLE_PCI_DEVICE_ID 0xb140
@@ -47,23 +42,168 @@ static uint64_t TLB_COUNT_4G[] = {
     [TT_DEVICE_ARCH_BLACKHOLE] = 8
 };
 
-struct tt_device_t {
-    int fd;
-};
+uint64_t tt_arch_tlb_count(uint64_t arch, size_t size)
+{
+    if (arch > TT_DEVICE_ARCH_BLACKHOLE) {
+        return 0;
+    }
+
+    switch (size) {
+        case TT_TLB_SIZE_1M:
+            return TLB_COUNT_1M[arch];
+        case TT_TLB_SIZE_2M:
+            return TLB_COUNT_2M[arch];
+        case TT_TLB_SIZE_16M:
+            return TLB_COUNT_16M[arch];
+        case TT_TLB_SIZE_4G:
+            return TLB_COUNT_4G[arch];
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Windows kept open by the device for the tt_noc_* convenience functions, per
+ * caching mode.  Small on purpose: WH only has 10 2M windows, so the cache
+ * uses 1M windows there and leaves the rest to the application.
+ *
+ * Before the shared cache, each calling thread gets a window of its own (one
+ * per caching mode, allocated on first use) so threads don't contend for ways
+ * or remap each other's windows.  Threads may hold THREAD_WINDOW_BUDGET windows
+ * between them unless tt_device_set_thread_window_budget() says otherwise;
+ * threads that arrive after that use the shared cache.  The default is small
+ * because they keep them until they exit.
+ */
+#define TLB_CACHE_WAYS 4
+#define THREAD_WINDOW_BUDGET 8
 
 struct tt_tlb_t {
     uint32_t id;
     size_t size;
     void* mmio;
+    int configured;                 /* config below was applied by the driver */
+    tt_noc_addr_config_t config;    /* Last successfully applied configuration */
+};
+
+/*
+ * Windows the application has dedicated to one tile with tt_noc_reserve(): aimed
+ * at the start of the tile once and never moved, so tt_noc_read/tt_noc_write
+ * inside them are plain copies with no window bookkeeping or syscalls.
+ */
+#define MAX_RESERVATIONS 16
+
+struct noc_reservation {
+    tt_tlb_t* tlb;          /* NULL if the slot is free; published last */
+    uint8_t x;
+    uint8_t y;
+};
+
+struct tlb_cache_entry {
+    tt_tlb_t* tlb;          /* NULL until first use */
+    uint64_t last_use;      /* LRU clock value at last acquire */
+    int busy;               /* Owned by a caller; not eligible for reuse */
+    int per_thread;         /* Belongs to a thread_windows set, not the shared cache */
+};
+
+/* One thread's windows for one device; the pthread key's value. */
+struct thread_windows {
+    tt_device_t* dev;
+    struct tlb_cache_entry ways[2];     /* [enum tt_tlb_cache_mode] */
+    int exhausted[2];                   /* Couldn't get a window; use the shared cache */
+    struct thread_windows* prev;
+    struct thread_windows* next;
+};
+
+/*
+ * Registration cache (tt_dma_cache_enable()): pins outlive the tt_dma_t handles
+ * that created them, so mapping the same memory again is a lookup.  A pin is
+ * reused by any request it covers with the same pin flags; a request that
+ * overlaps or abuts idle pins replaces them with one pin of the union.  Idle
+ * pins are unpinned least recently used first once the cache holds more than
+ * its byte limit, and by tt_dma_cache_invalidate().
+ */
+struct dma_pin {
+    uint64_t addr;
+    size_t len;
+    uint32_t pin_flags;
+    uint64_t iova;
+    uint64_t noc;           /* ~0ULL if not NOC-mapped */
+    uint64_t refs;          /* tt_dma_t handles using it */
+    uint64_t last_use;
+    int stale;              /* Invalidated while in use; unpin on last unmap */
+    struct dma_pin* next;
 };
 
+struct tt_device_t {
+    const struct tt_backend_ops* ops;
+    void* backend;          /* Backend's per-device state */
+    uint64_t arch;
+    size_t tlb_cache_size;
+    pthread_mutex_t tlb_cache_lock;
+    uint64_t tlb_cache_clock;
+    struct tlb_cache_entry tlb_cache[2][TLB_CACHE_WAYS];    /* [enum tt_tlb_cache_mode][way] */
+    pthread_key_t thread_windows_key;
+    struct thread_windows* thread_windows;  /* Every thread's set; under tlb_cache_lock */
+    uint64_t thread_window_budget;
+    uint64_t thread_window_count;           /* Windows held by threads; under tlb_cache_lock */
+    struct noc_reservation reservations[MAX_RESERVATIONS];  /* Changed under tlb_cache_lock */
+    uint64_t reservation_count;
+    pthread_mutex_t dma_cache_lock;
+    int dma_cache_enabled;
+    size_t dma_cache_limit;                 /* Bytes */
+    size_t dma_cache_bytes;                 /* Bytes pinned by the cache, idle or not */
+    uint64_t dma_cache_clock;
+    struct dma_pin* dma_pins;
+    uint64_t dma_cache_hits;
+    uint64_t dma_cache_misses;
+    uint64_t dma_cache_evictions;
+    uint64_t tlb_remaps_issued;
+    uint64_t tlb_remaps_elided;
+};
+
+#define STAT_INC(counter) __atomic_fetch_add(&(counter), 1, __ATOMIC_RELAXED)
+#define STAT_GET(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
 struct tt_dma_t {
     void* addr;             /* Virtual address */
     size_t len;             /* Bytes */
     uint64_t iova;          /* I/O Virtual Address */
     uint64_t noc;           /* NOC address (inside EP PCIe tile) */
+    struct dma_pin* pin;    /* Registration cache entry backing this, or NULL */
+    int allocated;          /* From tt_dma_alloc() rather than pinned */
 };
 
+static void thread_windows_free(tt_device_t* dev, struct thread_windows* tw)
+{
+    for (size_t mode = 0; mode < 2; ++mode) {
+        if (tw->ways[mode].tlb) {
+            tt_tlb_free(dev, tw->ways[mode].tlb);
+        }
+    }
+    free(tw);
+}
+
+/* Key destructor: a thread that used the device is exiting. */
+static void thread_windows_destroy(void* arg)
+{
+    struct thread_windows* tw = arg;
+    tt_device_t* dev = tw->dev;
+
+    pthread_mutex_lock(&dev->tlb_cache_lock);
+    if (tw->prev) {
+        tw->prev->next = tw->next;
+    } else {
+        dev->thread_windows = tw->next;
+    }
+    if (tw->next) {
+        tw->next->prev = tw->prev;
+    }
+    dev->thread_window_count -= (tw->ways[0].tlb != NULL) + (tw->ways[1].tlb != NULL);
+    pthread_mutex_unlock(&dev->tlb_cache_lock);
+
+    thread_windows_free(dev, tw);
+}
+
 int tt_device_open(const char* chardev_path, tt_device_t** out_dev)
 {
     struct tt_device_t* dev = malloc(sizeof(struct tt_device_t));
@@ -74,22 +214,26 @@ int tt_device_open(const char* chardev_path, tt_device_t** out_dev)
 
     memset(dev, 0, sizeof(struct tt_device_t));
 
-    dev->fd = open(chardev_path, O_RDWR | O_CLOEXEC);
-    if (dev->fd == -1) {
-        int e = errno;
+    if (strncmp(chardev_path, TT_SIM_PATH_PREFIX, strlen(TT_SIM_PATH_PREFIX)) == 0) {
+        dev->ops = &tt_sim_backend;
+    } else {
+        dev->ops = &tt_kmd_backend;
+    }
+
+    int ret = dev->ops->open(chardev_path, &dev->backend);
+    if (ret != 0) {
         free(dev);
-        return -e;
+        return ret;
     }
 
     uint64_t major = 0;
     uint64_t minor = 0;
     uint64_t patch = 0;
 
-    int ret;
     if ((ret = tt_driver_get_attr(dev, TT_DRIVER_SEMVER_MAJOR, &major)) != 0 ||
         (ret = tt_driver_get_attr(dev, TT_DRIVER_SEMVER_MINOR, &minor)) != 0 ||
         (ret = tt_driver_get_attr(dev, TT_DRIVER_SEMVER_PATCH, &patch)) != 0) {
-        close(dev->fd);
+        dev->ops->close(dev->backend);
         free(dev);
         return ret;
     }
@@ -99,12 +243,31 @@ int tt_device_open(const char* chardev_path, tt_device_t** out_dev)
 	    DEBUG("Driver version mismatch: compiled for v%d.%d.%d; detected v%lu.%lu.%lu\n",
               TENSTORRENT_DRIVER_VERSION_MAJOR, TENSTORRENT_DRIVER_VERSION_MINOR, TENSTORRENT_DRIVER_VERSION_PATCH,
               major, minor, patch);
-	    close(dev->fd);
+	    dev->ops->close(dev->backend);
 	    free(dev);
 	    return -ENODEV;
     }
 #endif
 
+    if ((ret = tt_device_get_attr(dev, TT_DEVICE_ATTR_CHIP_ARCH, &dev->arch)) != 0) {
+        dev->ops->close(dev->backend);
+        free(dev);
+        return ret;
+    }
+
+    dev->tlb_cache_size = dev->arch == TT_DEVICE_ARCH_WORMHOLE ? TT_TLB_SIZE_1M : TT_TLB_SIZE_2M;
+    dev->thread_window_budget = MIN(THREAD_WINDOW_BUDGET, tt_arch_tlb_count(dev->arch, dev->tlb_cache_size));
+    pthread_mutex_init(&dev->tlb_cache_lock, NULL);
+    pthread_mutex_init(&dev->dma_cache_lock, NULL);
+
+    if ((ret = pthread_key_create(&dev->thread_windows_key, thread_windows_destroy)) != 0) {
+        pthread_mutex_destroy(&dev->dma_cache_lock);
+        pthread_mutex_destroy(&dev->tlb_cache_lock);
+        dev->ops->close(dev->backend);
+        free(dev);
+        return -ret;
+    }
+
     *out_dev = dev;
 
     return 0;
@@ -112,8 +275,41 @@ int tt_device_open(const char* chardev_path, tt_device_t** out_dev)
 
 int tt_device_close(tt_device_t* dev)
 {
-    if (close(dev->fd) != 0) {
-        return -errno;
+    /* Threads still running keep their key values, but no destructor will run. */
+    pthread_key_delete(dev->thread_windows_key);
+
+    while (dev->thread_windows) {
+        struct thread_windows* tw = dev->thread_windows;
+        dev->thread_windows = tw->next;
+        thread_windows_free(dev, tw);
+    }
+
+    for (size_t i = 0; i < MAX_RESERVATIONS; ++i) {
+        if (dev->reservations[i].tlb) {
+            tt_tlb_free(dev, dev->reservations[i].tlb);
+        }
+    }
+
+    while (dev->dma_pins) {
+        struct dma_pin* pin = dev->dma_pins;
+        dev->dma_pins = pin->next;
+        dev->ops->unpin_pages(dev->backend, (void*)pin->addr, pin->len);
+        free(pin);
+    }
+    pthread_mutex_destroy(&dev->dma_cache_lock);
+
+    for (size_t mode = 0; mode < 2; ++mode) {
+        for (size_t way = 0; way < TLB_CACHE_WAYS; ++way) {
+            if (dev->tlb_cache[mode][way].tlb) {
+                tt_tlb_free(dev, dev->tlb_cache[mode][way].tlb);
+            }
+        }
+    }
+    pthread_mutex_destroy(&dev->tlb_cache_lock);
+
+    int ret = dev->ops->close(dev->backend);
+    if (ret != 0) {
+        return ret;
     }
 
     free(dev);
@@ -122,42 +318,41 @@ int tt_device_close(tt_device_t* dev)
 
 int tt_device_get_attr(tt_device_t* dev, enum tt_device_attr attr, uint64_t* out_value)
 {
-    struct tenstorrent_get_device_info get_device_info = {0};
+    struct tenstorrent_get_device_info_out info;
 
-    get_device_info.in.output_size_bytes = sizeof(get_device_info.out);
-
-    if (ioctl(dev->fd, TENSTORRENT_IOCTL_GET_DEVICE_INFO, &get_device_info) != 0) {
-        return -errno;
+    int ret = dev->ops->get_device_info(dev->backend, &info);
+    if (ret != 0) {
+        return ret;
     }
 
     uint64_t arch = TT_DEVICE_ARCH_UNKNOWN;
-    if (get_device_info.out.device_id == BLACKHOLE_PCI_DEVICE_ID) {
+    if (info.device_id == BLACKHOLE_PCI_DEVICE_ID) {
         arch = TT_DEVICE_ARCH_BLACKHOLE;
-    } else if (get_device_info.out.device_id == WORMHOLE_PCI_DEVICE_ID) {
+    } else if (info.device_id == WORMHOLE_PCI_DEVICE_ID) {
         arch = TT_DEVICE_ARCH_WORMHOLE;
     }
 
     switch (attr) {
         case TT_DEVICE_ATTR_PCI_DOMAIN:
-            *out_value = get_device_info.out.pci_domain;
+            *out_value = info.pci_domain;
             break;
         case TT_DEVICE_ATTR_PCI_BUS:
-            *out_value = get_device_info.out.bus_dev_fn >> 8;
+            *out_value = info.bus_dev_fn >> 8;
             break;
         case TT_DEVICE_ATTR_PCI_DEVICE:
-            *out_value = (get_device_info.out.bus_dev_fn >> 3) & 0x1F;
+            *out_value = (info.bus_dev_fn >> 3) & 0x1F;
             break;
         case TT_DEVICE_ATTR_PCI_FUNCTION:
-            *out_value = get_device_info.out.bus_dev_fn & 0x07;
+            *out_value = info.bus_dev_fn & 0x07;
             break;
         case TT_DEVICE_ATTR_PCI_VENDOR_ID:
-            *out_value = get_device_info.out.vendor_id;
+            *out_value = info.vendor_id;
             break;
         case TT_DEVICE_ATTR_PCI_DEVICE_ID:
-            *out_value = get_device_info.out.device_id;
+            *out_value = info.device_id;
             break;
         case TT_DEVICE_ATTR_PCI_SUBSYSTEM_ID:
-            *out_value = get_device_info.out.subsystem_id;
+            *out_value = info.subsystem_id;
             break;
         case TT_DEVICE_ATTR_CHIP_ARCH:
             *out_value = arch;
@@ -174,6 +369,9 @@ int tt_device_get_attr(tt_device_t* dev, enum tt_device_attr attr, uint64_t* out
         case TT_DEVICE_ATTR_NUM_4G_TLBS:
             *out_value = TLB_COUNT_4G[arch];
             break;
+        case TT_DEVICE_ATTR_MAX_DMA_BUF_SIZE:
+            *out_value = info.max_dma_buf_size_log2 ? 1ULL << info.max_dma_buf_size_log2 : 0;
+            break;
         default:
             return -EINVAL;
     }
@@ -181,15 +379,50 @@ int tt_device_get_attr(tt_device_t* dev, enum tt_device_attr attr, uint64_t* out
     return 0;
 }
 
+int tt_device_get_stats(tt_device_t* dev, tt_device_stats_t* out_stats)
+{
+    memset(out_stats, 0, sizeof(*out_stats));
+
+    out_stats->tlb_remaps_issued = STAT_GET(dev->tlb_remaps_issued);
+    out_stats->tlb_remaps_elided = STAT_GET(dev->tlb_remaps_elided);
+
+    pthread_mutex_lock(&dev->tlb_cache_lock);
+    out_stats->thread_windows = dev->thread_window_count;
+    out_stats->reserved_windows = dev->reservation_count;
+    pthread_mutex_unlock(&dev->tlb_cache_lock);
+
+    pthread_mutex_lock(&dev->dma_cache_lock);
+    out_stats->dma_cache_hits = dev->dma_cache_hits;
+    out_stats->dma_cache_misses = dev->dma_cache_misses;
+    out_stats->dma_cache_evictions = dev->dma_cache_evictions;
+    out_stats->dma_cache_pinned_bytes = dev->dma_cache_bytes;
+    pthread_mutex_unlock(&dev->dma_cache_lock);
+
+    return 0;
+}
+
+int tt_device_set_thread_window_budget(tt_device_t* dev, uint64_t windows)
+{
+    if (windows > tt_arch_tlb_count(dev->arch, dev->tlb_cache_size)) {
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&dev->tlb_cache_lock);
+    dev->thread_window_budget = windows;
+    pthread_mutex_unlock(&dev->tlb_cache_lock);
+
+    return 0;
+}
+
 int tt_driver_get_attr(tt_device_t* dev, enum tt_driver_attr attr, uint64_t* out_value)
 {
-    struct tenstorrent_get_driver_info get_driver_info = {0};
-    get_driver_info.in.output_size_bytes = sizeof(get_driver_info.out);
+    struct tenstorrent_get_driver_info_out info = {0};
 
     /* OK to call with NULL dev, but can't return semver without a device. */
     if (dev) {
-        if (ioctl(dev->fd, TENSTORRENT_IOCTL_GET_DRIVER_INFO, &get_driver_info) != 0) {
-            return -errno;
+        int ret = dev->ops->get_driver_info(dev->backend, &info);
+        if (ret != 0) {
+            return ret;
         }
     }
 
@@ -198,13 +431,13 @@ int tt_driver_get_attr(tt_device_t* dev, enum tt_driver_attr attr, uint64_t* out
             *out_value = TENSTORRENT_DRIVER_VERSION;
             return 0;
         case TT_DRIVER_SEMVER_MAJOR:
-            *out_value = get_driver_info.out.driver_version_major;
+            *out_value = info.driver_version_major;
             return dev ? 0 : -ENODEV;
         case TT_DRIVER_SEMVER_MINOR:
-            *out_value = get_driver_info.out.driver_version_minor;
+            *out_value = info.driver_version_minor;
             return dev ? 0 : -ENODEV;
         case TT_DRIVER_SEMVER_PATCH:
-            *out_value = get_driver_info.out.driver_version_patch;
+            *out_value = info.driver_version_patch;
             return dev ? 0 : -ENODEV;
         default:
             return -EINVAL;
@@ -213,153 +446,627 @@ int tt_driver_get_attr(tt_device_t* dev, enum tt_driver_attr attr, uint64_t* out
     return 0;
 }
 
-int tt_noc_read32(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, uint32_t* value)
+/* Is the window currently a plain NOC0 unicast mapping of (x, y, addr)? */
+static int tlb_targets(const tt_tlb_t* tlb, uint8_t x, uint8_t y, uint64_t addr)
 {
-    if (addr % 4 != 0) {
-        return -EINVAL;
-    }
+    const tt_noc_addr_config_t* c = &tlb->config;
 
-    tt_tlb_t* tlb;
-    int ret = tt_tlb_alloc(dev, TT_TLB_SIZE_2M, TT_MMIO_CACHE_MODE_UC, &tlb);
-    if (ret != 0) {
-        return ret;
+    return tlb->configured && c->addr == addr && c->x_end == x && c->y_end == y && c->x_start == 0 &&
+           c->y_start == 0 && c->noc == 0 && c->mcast == 0 && c->ordering == 0 && c->static_vc == 0;
+}
+
+/*
+ * The calling thread's own window of the given caching mode, allocated on first
+ * use.  NULL if the thread can't have one (budget spent, allocation failed) or
+ * is already using it, in which case the caller goes to the shared cache.
+ */
+static struct tlb_cache_entry* thread_window_acquire(tt_device_t* dev, enum tt_tlb_cache_mode cache)
+{
+    struct thread_windows* tw = pthread_getspecific(dev->thread_windows_key);
+
+    if (!tw) {
+        tw = calloc(1, sizeof(struct thread_windows));
+        if (!tw) {
+            return NULL;
+        }
+
+        tw->dev = dev;
+        tw->ways[0].per_thread = 1;
+        tw->ways[1].per_thread = 1;
+
+        if (pthread_setspecific(dev->thread_windows_key, tw) != 0) {
+            free(tw);
+            return NULL;
+        }
+
+        pthread_mutex_lock(&dev->tlb_cache_lock);
+        tw->next = dev->thread_windows;
+        if (tw->next) {
+            tw->next->prev = tw;
+        }
+        dev->thread_windows = tw;
+        pthread_mutex_unlock(&dev->tlb_cache_lock);
     }
 
-    uint64_t aligned_addr = addr & ~(tlb->size - 1);
-    ret = tt_tlb_map_unicast(dev, tlb, x, y, aligned_addr);
+    struct tlb_cache_entry* e = &tw->ways[cache];
 
-    if (ret != 0) {
-        tt_tlb_free(dev, tlb);
-        return ret;
+    if (e->busy) {
+        return NULL;
     }
 
-    uint64_t offset = addr & (tlb->size - 1);
-    *value = *(volatile uint32_t*)((uint8_t*)tlb->mmio + offset);
+    if (!e->tlb) {
+        int granted = 0;
 
-    tt_tlb_free(dev, tlb);
-    return 0;
+        if (tw->exhausted[cache]) {
+            return NULL;
+        }
+
+        pthread_mutex_lock(&dev->tlb_cache_lock);
+        if (dev->thread_window_count < dev->thread_window_budget) {
+            dev->thread_window_count++;
+            granted = 1;
+        }
+        pthread_mutex_unlock(&dev->tlb_cache_lock);
+
+        if (!granted || tt_tlb_alloc(dev, dev->tlb_cache_size, cache, &e->tlb) != 0) {
+            if (granted) {
+                pthread_mutex_lock(&dev->tlb_cache_lock);
+                dev->thread_window_count--;
+                pthread_mutex_unlock(&dev->tlb_cache_lock);
+            }
+            e->tlb = NULL;
+            tw->exhausted[cache] = 1;
+            return NULL;
+        }
+    }
+
+    e->busy = 1;
+    return e;
 }
 
-int tt_noc_write32(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, uint32_t value)
+/*
+ * Take a window of the given caching mode for exclusive use: the calling
+ * thread's own if it has or can get one, otherwise a shared cached one,
+ * preferring
+ * one already aimed at (x, y, addr), then an unallocated way, then the least
+ * recently used idle way.  If every way is busy (e.g. many threads in flight),
+ * fall back to a temporary window owned by `tmp`, which the caller releases.
+ */
+static int tlb_cache_acquire(tt_device_t* dev, enum tt_tlb_cache_mode cache, uint8_t x, uint8_t y, uint64_t addr,
+                             struct tlb_cache_entry* tmp, struct tlb_cache_entry** out_entry)
 {
-    if (addr % 4 != 0) {
-        return -EINVAL;
+    struct tlb_cache_entry* ways = dev->tlb_cache[cache];
+    struct tlb_cache_entry* victim = NULL;
+    uint64_t aligned_addr = addr & ~(dev->tlb_cache_size - 1);
+    int ret = 0;
+
+    if ((victim = thread_window_acquire(dev, cache)) != NULL) {
+        *out_entry = victim;
+        return 0;
     }
 
-    tt_tlb_t* tlb;
-    int ret = tt_tlb_alloc(dev, TT_TLB_SIZE_2M, TT_MMIO_CACHE_MODE_UC, &tlb);
-    if (ret != 0) {
-        return ret;
+    pthread_mutex_lock(&dev->tlb_cache_lock);
+
+    for (size_t way = 0; way < TLB_CACHE_WAYS; ++way) {
+        struct tlb_cache_entry* e = &ways[way];
+
+        if (e->busy) {
+            continue;
+        }
+
+        if (e->tlb && tlb_targets(e->tlb, x, y, aligned_addr)) {
+            victim = e;
+            break;
+        }
+
+        if (!victim || (victim->tlb && (!e->tlb || e->last_use < victim->last_use))) {
+            victim = e;
+        }
+    }
+
+    if (victim) {
+        if (!victim->tlb) {
+            ret = tt_tlb_alloc(dev, dev->tlb_cache_size, cache, &victim->tlb);
+        }
+
+        if (ret == 0) {
+            victim->busy = 1;
+            victim->last_use = ++dev->tlb_cache_clock;
+        }
     }
 
-    uint64_t aligned_addr = addr & ~(tlb->size - 1);
-    ret = tt_tlb_map_unicast(dev, tlb, x, y, aligned_addr);
+    pthread_mutex_unlock(&dev->tlb_cache_lock);
 
     if (ret != 0) {
-        tt_tlb_free(dev, tlb);
         return ret;
     }
 
-    uint64_t offset = addr & (tlb->size - 1);
-    *(volatile uint32_t*)((uint8_t*)tlb->mmio + offset) = value;
+    if (!victim) {
+        memset(tmp, 0, sizeof(*tmp));
+        ret = tt_tlb_alloc(dev, dev->tlb_cache_size, cache, &tmp->tlb);
+        if (ret != 0) {
+            return ret;
+        }
+        victim = tmp;
+    }
 
-    tt_tlb_free(dev, tlb);
+    *out_entry = victim;
     return 0;
 }
 
-int tt_noc_read(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, void* dst, size_t len)
+static void tlb_cache_release(tt_device_t* dev, struct tlb_cache_entry* entry, struct tlb_cache_entry* tmp)
 {
-    uint8_t* dst_ptr = (uint8_t*)dst;
-    tt_tlb_t* tlb;
-    int32_t ret;
-
-    if (addr % 4 != 0 || len % 4 != 0) {
-        return -EINVAL;
+    if (entry == tmp) {
+        tt_tlb_free(dev, tmp->tlb);
+        return;
     }
 
-    ret = tt_tlb_alloc(dev, TT_TLB_SIZE_2M, TT_MMIO_CACHE_MODE_WC, &tlb);
-    if (ret != 0) {
-        return ret;
+    if (entry->per_thread) {
+        entry->busy = 0;
+        return;
     }
 
+    pthread_mutex_lock(&dev->tlb_cache_lock);
+    entry->busy = 0;
+    pthread_mutex_unlock(&dev->tlb_cache_lock);
+}
+
+/* Move len bytes between buf and (x, y, addr) through an acquired window. */
+static int noc_transfer(tt_device_t* dev, tt_tlb_t* tlb, enum tt_tlb_cache_mode cache, uint8_t x, uint8_t y,
+                        uint64_t addr, void* buf, size_t len, int write)
+{
+    uint8_t* buf_ptr = (uint8_t*)buf;
+
     while (len > 0) {
-        uint64_t aligned_addr = addr & ~(tlb->size - 1);
         uint64_t offset = addr & (tlb->size - 1);
         size_t chunk_size = MIN(len, tlb->size - offset);
-        uint8_t* src_ptr = (uint8_t*)tlb->mmio + offset;
-
-        ret = tt_tlb_map_unicast(dev, tlb, x, y, aligned_addr);
+        uint8_t* mmio_ptr = (uint8_t*)tlb->mmio + offset;
 
+        int ret = tt_tlb_map_unicast(dev, tlb, x, y, addr - offset);
         if (ret != 0) {
-            tt_tlb_free(dev, tlb);
             return ret;
         }
 
-#if 0
-        memcpy(dst_ptr, src_ptr, chunk_size);
-#else
-        for (size_t i = 0; i < chunk_size / sizeof(uint32_t); ++i) {
-            uint32_t* src32 = (uint32_t*)src_ptr;
-            volatile uint32_t* dst32 = (volatile uint32_t*)dst_ptr;
-            dst32[i] = src32[i];
+        if (write && cache == TT_MMIO_CACHE_MODE_WC) {
+            tt_memcpy_to_device(mmio_ptr, buf_ptr, chunk_size);
+        } else if (write) {
+            for (size_t i = 0; i < chunk_size / sizeof(uint32_t); ++i) {
+                uint32_t* src32 = (uint32_t*)buf_ptr;
+                volatile uint32_t* dst32 = (volatile uint32_t*)mmio_ptr;
+                dst32[i] = src32[i];
+            }
+        } else if (cache == TT_MMIO_CACHE_MODE_WC) {
+            tt_memcpy_from_device(buf_ptr, mmio_ptr, chunk_size);
+        } else {
+            for (size_t i = 0; i < chunk_size / sizeof(uint32_t); ++i) {
+                volatile uint32_t* src32 = (volatile uint32_t*)mmio_ptr;
+                uint32_t* dst32 = (uint32_t*)buf_ptr;
+                dst32[i] = src32[i];
+            }
         }
-#endif
 
-        dst_ptr += chunk_size;
+        buf_ptr += chunk_size;
         len -= chunk_size;
         addr += chunk_size;
     }
 
-    tt_tlb_free(dev, tlb);
+    return 0;
+}
+
+/* Where [addr, addr + len) of (x, y) is in a reserved window, or NULL. */
+static uint8_t* reserved_mmio(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, size_t len)
+{
+    if (__atomic_load_n(&dev->reservation_count, __ATOMIC_ACQUIRE) == 0) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < MAX_RESERVATIONS; ++i) {
+        struct noc_reservation* r = &dev->reservations[i];
+        tt_tlb_t* tlb = __atomic_load_n(&r->tlb, __ATOMIC_ACQUIRE);
+
+        if (tlb && r->x == x && r->y == y && addr < tlb->size && len <= tlb->size - addr) {
+            return (uint8_t*)tlb->mmio + addr;
+        }
+    }
+
+    return NULL;
+}
+
+/* Shared body of the tt_noc_* convenience functions. */
+static int noc_access(tt_device_t* dev, enum tt_tlb_cache_mode cache, uint8_t x, uint8_t y, uint64_t addr,
+                      void* buf, size_t len, int write)
+{
+    struct tlb_cache_entry tmp;
+    struct tlb_cache_entry* entry;
+    uint8_t* mmio;
+
+    if (cache == TT_MMIO_CACHE_MODE_WC && (mmio = reserved_mmio(dev, x, y, addr, len)) != NULL) {
+        if (write) {
+            tt_memcpy_to_device(mmio, buf, len);
+        } else {
+            tt_memcpy_from_device(buf, mmio, len);
+        }
+        return 0;
+    }
+
+    int ret = tlb_cache_acquire(dev, cache, x, y, addr, &tmp, &entry);
+    if (ret != 0) {
+        return ret;
+    }
+
+    ret = noc_transfer(dev, entry->tlb, cache, x, y, addr, buf, len, write);
+
+    tlb_cache_release(dev, entry, &tmp);
+
+    return ret;
+}
+
+/* Execution order for the vectored functions; see noc_iov_compare(). */
+struct noc_iov_order {
+    uint8_t x;
+    uint8_t y;
+    uint64_t page;
+    size_t index;
+};
+
+/*
+ * Group descriptors by tile, then page, so each distinct page is mapped at
+ * most once per window type.  The original index breaks ties, which keeps
+ * accesses to the same page in array order whichever window they use.
+ */
+static int noc_iov_compare(const void* a, const void* b)
+{
+    const struct noc_iov_order* l = (const struct noc_iov_order*)a;
+    const struct noc_iov_order* r = (const struct noc_iov_order*)b;
 
+    if (l->x != r->x) {
+        return l->x < r->x ? -1 : 1;
+    }
+    if (l->y != r->y) {
+        return l->y < r->y ? -1 : 1;
+    }
+    if (l->page != r->page) {
+        return l->page < r->page ? -1 : 1;
+    }
+    if (l->index != r->index) {
+        return l->index < r->index ? -1 : 1;
+    }
     return 0;
 }
 
+static int noc_accessv(tt_device_t* dev, const tt_noc_iov_t* iov, size_t count, int write)
+{
+    struct tlb_cache_entry tmp[2];
+    struct tlb_cache_entry* entries[2] = {NULL, NULL};   /* [enum tt_tlb_cache_mode] */
+    struct noc_iov_order* order;
+    int ret = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (iov[i].addr % 4 != 0 || iov[i].len % 4 != 0) {
+            return -EINVAL;
+        }
+    }
+
+    order = malloc(count * sizeof(*order));
+    if (count && !order) {
+        return -ENOMEM;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        order[i].x = iov[i].x;
+        order[i].y = iov[i].y;
+        order[i].page = iov[i].addr & ~(dev->tlb_cache_size - 1);
+        order[i].index = i;
+    }
+
+    qsort(order, count, sizeof(*order), noc_iov_compare);
+
+    for (size_t i = 0; i < count && ret == 0; ++i) {
+        const tt_noc_iov_t* op = &iov[order[i].index];
+        int uc = op->len == sizeof(uint32_t);
+        enum tt_tlb_cache_mode cache = uc ? TT_MMIO_CACHE_MODE_UC : TT_MMIO_CACHE_MODE_WC;
+        uint8_t* mmio;
+
+        if (!uc && (mmio = reserved_mmio(dev, op->x, op->y, op->addr, op->len)) != NULL) {
+            if (write) {
+                tt_memcpy_to_device(mmio, op->buf, op->len);
+            } else {
+                tt_memcpy_from_device(op->buf, mmio, op->len);
+            }
+            continue;
+        }
+
+        if (!entries[cache]) {
+            ret = tlb_cache_acquire(dev, cache, op->x, op->y, op->addr, &tmp[cache], &entries[cache]);
+            if (ret != 0) {
+                break;
+            }
+        }
+
+        ret = noc_transfer(dev, entries[cache]->tlb, cache, op->x, op->y, op->addr, op->buf, op->len, write);
+    }
+
+    for (size_t cache = 0; cache < 2; ++cache) {
+        if (entries[cache]) {
+            tlb_cache_release(dev, entries[cache], &tmp[cache]);
+        }
+    }
+
+    free(order);
+
+    return ret;
+}
+
+int tt_noc_read32(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, uint32_t* value)
+{
+    if (addr % 4 != 0) {
+        return -EINVAL;
+    }
+
+    return noc_access(dev, TT_MMIO_CACHE_MODE_UC, x, y, addr, value, sizeof(*value), 0);
+}
+
+int tt_noc_write32(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, uint32_t value)
+{
+    if (addr % 4 != 0) {
+        return -EINVAL;
+    }
+
+    return noc_access(dev, TT_MMIO_CACHE_MODE_UC, x, y, addr, &value, sizeof(value), 1);
+}
+
+int tt_noc_read(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, void* dst, size_t len)
+{
+    if (addr % 4 != 0 || len % 4 != 0) {
+        return -EINVAL;
+    }
+
+    return noc_access(dev, TT_MMIO_CACHE_MODE_WC, x, y, addr, dst, len, 0);
+}
+
 int tt_noc_write(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, const void* src, size_t len)
 {
+    if (addr % 4 != 0 || len % 4 != 0) {
+        return -EINVAL;
+    }
+
+    return noc_access(dev, TT_MMIO_CACHE_MODE_WC, x, y, addr, (void*)src, len, 1);
+}
+
+int tt_noc_readv(tt_device_t* dev, const tt_noc_iov_t* iov, size_t count)
+{
+    return noc_accessv(dev, iov, count, 0);
+}
+
+int tt_noc_writev(tt_device_t* dev, const tt_noc_iov_t* iov, size_t count)
+{
+    return noc_accessv(dev, iov, count, 1);
+}
+
+int tt_noc_multicast_write(tt_device_t* dev, uint8_t x_start, uint8_t y_start, uint8_t x_end, uint8_t y_end,
+                           uint64_t addr, const void* src, size_t len)
+{
+    struct tlb_cache_entry tmp;
+    struct tlb_cache_entry* entry;
     const uint8_t* src_ptr = (const uint8_t*)src;
-    tt_tlb_t* tlb;
-    int32_t ret;
 
-    if (addr % 4 != 0 || len % 4 != 0) {
+    if (addr % 4 != 0 || len % 4 != 0 || x_start > x_end || y_start > y_end) {
         return -EINVAL;
     }
 
-    ret = tt_tlb_alloc(dev, TT_TLB_SIZE_2M, TT_MMIO_CACHE_MODE_WC, &tlb);
+    int ret = tlb_cache_acquire(dev, TT_MMIO_CACHE_MODE_WC, x_end, y_end, addr, &tmp, &entry);
     if (ret != 0) {
         return ret;
     }
 
     while (len > 0) {
-        uint64_t aligned_addr = addr & ~(tlb->size - 1);
+        tt_tlb_t* tlb = entry->tlb;
         uint64_t offset = addr & (tlb->size - 1);
         size_t chunk_size = MIN(len, tlb->size - offset);
-        uint8_t* dst_ptr = (uint8_t*)tlb->mmio + offset;
+        tt_noc_addr_config_t config = {0};
 
-        ret = tt_tlb_map_unicast(dev, tlb, x, y, aligned_addr);
+        config.addr = addr - offset;
+        config.x_start = x_start;
+        config.y_start = y_start;
+        config.x_end = x_end;
+        config.y_end = y_end;
+        config.mcast = 1;
 
+        ret = tt_tlb_map(dev, tlb, &config);
         if (ret != 0) {
-            tt_tlb_free(dev, tlb);
-            return ret;
+            break;
         }
 
-#if 0
-        memcpy(dst_ptr, src_ptr, chunk_size);
-#else
-        for (size_t i = 0; i < chunk_size / sizeof(uint32_t); ++i) {
-            uint32_t* src32 = (uint32_t*)src_ptr;
-            volatile uint32_t* dst32 = (volatile uint32_t*)dst_ptr;
-            dst32[i] = src32[i];
-        }
-#endif
+        tt_memcpy_to_device((uint8_t*)tlb->mmio + offset, src_ptr, chunk_size);
 
         src_ptr += chunk_size;
         len -= chunk_size;
         addr += chunk_size;
     }
 
-    tt_tlb_free(dev, tlb);
+    tlb_cache_release(dev, entry, &tmp);
+
+    return ret;
+}
+
+int tt_noc_reserve(tt_device_t* dev, uint8_t x, uint8_t y, size_t size)
+{
+    struct noc_reservation* slot = NULL;
+    tt_tlb_t* tlb = NULL;
+    int ret = 0;
+
+    pthread_mutex_lock(&dev->tlb_cache_lock);
+
+    for (size_t i = 0; i < MAX_RESERVATIONS; ++i) {
+        struct noc_reservation* r = &dev->reservations[i];
+
+        if (r->tlb && r->x == x && r->y == y) {
+            ret = -EEXIST;
+            break;
+        }
+        if (!r->tlb && !slot) {
+            slot = r;
+        }
+    }
+
+    if (ret == 0 && !slot) {
+        ret = -ENOSPC;
+    }
+
+    if (ret == 0) {
+        ret = tt_tlb_alloc(dev, size, TT_MMIO_CACHE_MODE_WC, &tlb);
+    }
 
+    if (ret == 0) {
+        ret = tt_tlb_map_unicast(dev, tlb, x, y, 0);
+        if (ret != 0) {
+            tt_tlb_free(dev, tlb);
+        }
+    }
+
+    if (ret == 0) {
+        slot->x = x;
+        slot->y = y;
+        __atomic_store_n(&slot->tlb, tlb, __ATOMIC_RELEASE);
+        __atomic_store_n(&dev->reservation_count, dev->reservation_count + 1, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&dev->tlb_cache_lock);
+
+    return ret;
+}
+
+int tt_noc_unreserve(tt_device_t* dev, uint8_t x, uint8_t y)
+{
+    tt_tlb_t* tlb = NULL;
+
+    pthread_mutex_lock(&dev->tlb_cache_lock);
+
+    for (size_t i = 0; i < MAX_RESERVATIONS; ++i) {
+        struct noc_reservation* r = &dev->reservations[i];
+
+        if (r->tlb && r->x == x && r->y == y) {
+            tlb = r->tlb;
+            __atomic_store_n(&r->tlb, NULL, __ATOMIC_RELEASE);
+            __atomic_store_n(&dev->reservation_count, dev->reservation_count - 1, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&dev->tlb_cache_lock);
+
+    if (!tlb) {
+        return -ENOENT;
+    }
+
+    return tt_tlb_free(dev, tlb);
+}
+
+/* Unpin and forget an idle cached pin; caller holds dma_cache_lock. */
+static void dma_pin_drop(tt_device_t* dev, struct dma_pin** link)
+{
+    struct dma_pin* pin = *link;
+
+    *link = pin->next;
+    dev->dma_cache_bytes -= pin->len;
+    dev->ops->unpin_pages(dev->backend, (void*)pin->addr, pin->len);
+    free(pin);
+}
+
+/* Unpin idle pins, oldest first, until the cache is within `limit` bytes. */
+static void dma_cache_trim(tt_device_t* dev, size_t limit)
+{
+    while (dev->dma_cache_bytes > limit) {
+        struct dma_pin** victim = NULL;
+
+        for (struct dma_pin** link = &dev->dma_pins; *link; link = &(*link)->next) {
+            if ((*link)->refs == 0 && (!victim || (*link)->last_use < (*victim)->last_use)) {
+                victim = link;
+            }
+        }
+
+        if (!victim) {
+            break;
+        }
+
+        dma_pin_drop(dev, victim);
+        dev->dma_cache_evictions++;
+    }
+}
+
+/*
+ * Find or create a cached pin covering [addr, addr + len); caller holds
+ * dma_cache_lock.  Returns it with a reference taken.
+ */
+static int dma_cache_get(tt_device_t* dev, uint64_t addr, size_t len, uint32_t pin_flags, struct dma_pin** out_pin)
+{
+    uint64_t start = addr;
+    uint64_t end = addr + len;
+    int ret;
+
+    for (struct dma_pin* pin = dev->dma_pins; pin; pin = pin->next) {
+        if (!pin->stale && pin->pin_flags == pin_flags && pin->addr <= addr && addr + len <= pin->addr + pin->len) {
+            pin->refs++;
+            pin->last_use = ++dev->dma_cache_clock;
+            dev->dma_cache_hits++;
+            *out_pin = pin;
+            return 0;
+        }
+    }
+
+    dev->dma_cache_misses++;
+
+    /* Grow the request over idle pins it touches, which the new pin replaces. */
+    for (struct dma_pin** link = &dev->dma_pins; *link;) {
+        struct dma_pin* pin = *link;
+
+        if (!pin->stale && pin->refs == 0 && pin->pin_flags == pin_flags && pin->addr <= end &&
+            start <= pin->addr + pin->len) {
+            start = MIN(start, pin->addr);
+            end = pin->addr + pin->len > end ? pin->addr + pin->len : end;
+            dma_pin_drop(dev, link);
+        } else {
+            link = &pin->next;
+        }
+    }
+
+    struct dma_pin* pin = calloc(1, sizeof(struct dma_pin));
+    if (!pin) {
+        return -ENOMEM;
+    }
+
+    ret = dev->ops->pin_pages(dev->backend, (void*)start, end - start, pin_flags, &pin->iova, &pin->noc);
+
+    if (ret != 0 && (start != addr || end != addr + len)) {
+        /* The union may be too big (e.g. for the NOC aperture); try just the request. */
+        start = addr;
+        end = addr + len;
+        ret = dev->ops->pin_pages(dev->backend, (void*)start, end - start, pin_flags, &pin->iova, &pin->noc);
+    }
+
+    if (ret != 0 && dev->dma_cache_bytes > 0) {
+        /* Out of pinnable memory or aperture space; give back the idle pins and retry. */
+        dma_cache_trim(dev, 0);
+        ret = dev->ops->pin_pages(dev->backend, (void*)start, end - start, pin_flags, &pin->iova, &pin->noc);
+    }
+
+    if (ret != 0) {
+        free(pin);
+        return ret;
+    }
+
+    pin->addr = start;
+    pin->len = end - start;
+    pin->pin_flags = pin_flags;
+    pin->refs = 1;
+    pin->last_use = ++dev->dma_cache_clock;
+    pin->next = dev->dma_pins;
+    dev->dma_pins = pin;
+    dev->dma_cache_bytes += pin->len;
+
+    dma_cache_trim(dev, dev->dma_cache_limit);
+
+    *out_pin = pin;
     return 0;
 }
 
@@ -378,37 +1085,43 @@ int tt_dma_map(tt_device_t* dev, void* addr, size_t len, int flags, tt_dma_t** o
 
     memset(dma, 0, sizeof(struct tt_dma_t));
 
-    struct {
-        struct tenstorrent_pin_pages_in in;
-        struct tenstorrent_pin_pages_out_extended out;
-    } pin_pages;
-
-    memset(&pin_pages, 0, sizeof(pin_pages));
-
-    pin_pages.in.output_size_bytes = sizeof(pin_pages.out);
-    pin_pages.in.virtual_address = (uint64_t)addr;
-    pin_pages.in.size = len;
+    uint32_t pin_flags = 0;
+    uint64_t iova = 0;
+    uint64_t noc = 0;
+    int ret = -EAGAIN;
 
     if (flags & TT_DMA_FLAG_NOC) {
-        pin_pages.in.flags = TENSTORRENT_PIN_PAGES_NOC_DMA;
+        pin_flags = TENSTORRENT_PIN_PAGES_NOC_DMA;
     } else if (flags & TT_DMA_FLAG_NOC_TOP_DOWN) {
-        pin_pages.in.flags = TENSTORRENT_PIN_PAGES_NOC_TOP_DOWN;
-    } else {
-        pin_pages.in.flags = 0;
+        pin_flags = TENSTORRENT_PIN_PAGES_NOC_TOP_DOWN;
+    }
+
+    pthread_mutex_lock(&dev->dma_cache_lock);
+    if (dev->dma_cache_enabled) {
+        ret = dma_cache_get(dev, (uint64_t)addr, len, pin_flags, &dma->pin);
+        if (ret == 0) {
+            uint64_t offset = (uint64_t)addr - dma->pin->addr;
+            iova = dma->pin->iova + offset;
+            noc = dma->pin->noc + offset;
+        }
     }
+    pthread_mutex_unlock(&dev->dma_cache_lock);
 
-    if (ioctl(dev->fd, TENSTORRENT_IOCTL_PIN_PAGES, &pin_pages) != 0) {
-        int e = errno;
+    if (!dma->pin) {
+        ret = dev->ops->pin_pages(dev->backend, addr, len, pin_flags, &iova, &noc);
+    }
+
+    if (ret != 0) {
         free(dma);
-        return -e;
+        return ret;
     }
 
     dma->addr = addr;
     dma->len = len;
-    dma->iova = pin_pages.out.physical_address;
+    dma->iova = iova;
 
     if (flags & (TT_DMA_FLAG_NOC | TT_DMA_FLAG_NOC_TOP_DOWN)) {
-        dma->noc = pin_pages.out.noc_address;
+        dma->noc = noc;
     } else {
         dma->noc = ~0ULL;
     }
@@ -420,12 +1133,86 @@ int tt_dma_map(tt_device_t* dev, void* addr, size_t len, int flags, tt_dma_t** o
 
 int tt_dma_unmap(tt_device_t* dev, tt_dma_t* dma)
 {
-    struct tenstorrent_unpin_pages unpin = {0};
-    unpin.in.virtual_address = (uint64_t)dma->addr;
-    unpin.in.size = dma->len;
+    if (dma->allocated) {
+        return -EINVAL;
+    }
+
+    if (dma->pin) {
+        pthread_mutex_lock(&dev->dma_cache_lock);
+        struct dma_pin* pin = dma->pin;
+        if (--pin->refs == 0) {
+            if (pin->stale || !dev->dma_cache_enabled) {
+                for (struct dma_pin** link = &dev->dma_pins; *link; link = &(*link)->next) {
+                    if (*link == pin) {
+                        dma_pin_drop(dev, link);
+                        break;
+                    }
+                }
+            } else {
+                dma_cache_trim(dev, dev->dma_cache_limit);
+            }
+        }
+        pthread_mutex_unlock(&dev->dma_cache_lock);
+
+        free(dma);
+        return 0;
+    }
+
+    int ret = dev->ops->unpin_pages(dev->backend, dma->addr, dma->len);
+    if (ret != 0) {
+        return ret;
+    }
+
+    free(dma);
+
+    return 0;
+}
+
+int tt_dma_alloc(tt_device_t* dev, size_t len, int flags, tt_dma_t** out_dma)
+{
+    uint64_t max_len = 0;
+    uint64_t noc = 0;
+
+    if (len == 0 || len % getpagesize() != 0 || (flags & TT_DMA_FLAG_NOC_TOP_DOWN)) {
+        return -EINVAL;
+    }
+
+    tt_device_get_attr(dev, TT_DEVICE_ATTR_MAX_DMA_BUF_SIZE, &max_len);
+    if (len > UINT32_MAX || (max_len && len > max_len)) {
+        return -EINVAL;
+    }
+
+    struct tt_dma_t* dma = calloc(1, sizeof(struct tt_dma_t));
+
+    if (!dma) {
+        return -ENOMEM;
+    }
+
+    uint32_t alloc_flags = (flags & TT_DMA_FLAG_NOC) ? TENSTORRENT_ALLOCATE_DMA_BUF_NOC_DMA : 0;
+    int ret = dev->ops->dma_alloc(dev->backend, len, alloc_flags, &dma->addr, &dma->iova, &noc);
+    if (ret != 0) {
+        free(dma);
+        return ret;
+    }
+
+    dma->len = len;
+    dma->noc = (flags & TT_DMA_FLAG_NOC) ? noc : ~0ULL;
+    dma->allocated = 1;
+
+    *out_dma = dma;
+
+    return 0;
+}
+
+int tt_dma_free(tt_device_t* dev, tt_dma_t* dma)
+{
+    if (!dma->allocated) {
+        return -EINVAL;
+    }
 
-    if (ioctl(dev->fd, TENSTORRENT_IOCTL_UNPIN_PAGES, &unpin) != 0) {
-        return -errno;
+    int ret = dev->ops->dma_free(dev->backend, dma->addr, dma->len);
+    if (ret != 0) {
+        return ret;
     }
 
     free(dma);
@@ -433,6 +1220,58 @@ int tt_dma_unmap(tt_device_t* dev, tt_dma_t* dma)
     return 0;
 }
 
+int tt_dma_get_mem(tt_dma_t* dma, void** out_mem)
+{
+    *out_mem = dma->addr;
+    return 0;
+}
+
+int tt_dma_cache_enable(tt_device_t* dev, size_t max_pinned_bytes)
+{
+    pthread_mutex_lock(&dev->dma_cache_lock);
+    dev->dma_cache_enabled = 1;
+    dev->dma_cache_limit = max_pinned_bytes;
+    dma_cache_trim(dev, dev->dma_cache_limit);
+    pthread_mutex_unlock(&dev->dma_cache_lock);
+
+    return 0;
+}
+
+int tt_dma_cache_disable(tt_device_t* dev)
+{
+    pthread_mutex_lock(&dev->dma_cache_lock);
+    dev->dma_cache_enabled = 0;
+    dma_cache_trim(dev, 0);
+    pthread_mutex_unlock(&dev->dma_cache_lock);
+
+    return 0;
+}
+
+int tt_dma_cache_invalidate(tt_device_t* dev, void* addr, size_t len)
+{
+    uint64_t start = (uint64_t)addr;
+    uint64_t end = start + len;
+
+    pthread_mutex_lock(&dev->dma_cache_lock);
+
+    for (struct dma_pin** link = &dev->dma_pins; *link;) {
+        struct dma_pin* pin = *link;
+
+        if (pin->addr < end && start < pin->addr + pin->len) {
+            if (pin->refs == 0) {
+                dma_pin_drop(dev, link);
+                continue;
+            }
+            pin->stale = 1;
+        }
+        link = &pin->next;
+    }
+
+    pthread_mutex_unlock(&dev->dma_cache_lock);
+
+    return 0;
+}
+
 int tt_dma_get_dma_addr(tt_dma_t* dma, uint64_t* out_dma_addr)
 {
     *out_dma_addr = dma->iova;
@@ -459,32 +1298,13 @@ int tt_tlb_alloc(tt_device_t* dev, size_t size, enum tt_tlb_cache_mode cache, tt
 
     memset(tlb, 0, sizeof(struct tt_tlb_t));
 
-    struct tenstorrent_allocate_tlb alloc_tlb = {0};
-    alloc_tlb.in.size = size;
-
-    if (ioctl(dev->fd, TENSTORRENT_IOCTL_ALLOCATE_TLB, &alloc_tlb) != 0) {
-        int e = errno;
+    int ret = dev->ops->tlb_alloc(dev->backend, size, cache, &tlb->id, &tlb->mmio);
+    if (ret != 0) {
         free(tlb);
-        return -e;
+        return ret;
     }
 
-    off_t offset = cache == TT_MMIO_CACHE_MODE_UC ? alloc_tlb.out.mmap_offset_uc : alloc_tlb.out.mmap_offset_wc;
-    tlb->id = alloc_tlb.out.id;
     tlb->size = size;
-    tlb->mmio = mmap(NULL, tlb->size, PROT_READ | PROT_WRITE, MAP_SHARED, dev->fd, offset);
-
-    if (tlb->mmio == MAP_FAILED) {
-        struct tenstorrent_free_tlb free_tlb = {0};
-        int e = errno;
-        free_tlb.in.id = tlb->id;
-        if (ioctl(dev->fd, TENSTORRENT_IOCTL_FREE_TLB, &free_tlb) != 0) {
-            fprintf(stderr, "Leaked TLB %u: after mmap failure: %s\n", tlb->id, strerror(errno));
-        }
-
-        free(tlb);
-        errno = e;
-        return -e;
-    }
 
     *out_tlb = tlb;
 
@@ -493,17 +1313,7 @@ int tt_tlb_alloc(tt_device_t* dev, size_t size, enum tt_tlb_cache_mode cache, tt
 
 int tt_tlb_free(tt_device_t* dev, tt_tlb_t* tlb)
 {
-    int ret = 0;
-
-    /* Unmap the userspace view of the TLB. This is required by the driver. */
-    munmap(tlb->mmio, tlb->size);
-
-    /* Tell the driver to release the backing hardware resource. */
-    struct tenstorrent_free_tlb free_tlb = {0};
-    free_tlb.in.id = tlb->id;
-    if (ioctl(dev->fd, TENSTORRENT_IOCTL_FREE_TLB, &free_tlb) != 0) {
-        ret = -errno;
-    }
+    int ret = dev->ops->tlb_free(dev->backend, tlb->id, tlb->mmio, tlb->size);
 
     free(tlb);
 
@@ -518,46 +1328,42 @@ int tt_tlb_get_mmio(tt_tlb_t* tlb, void** out_mmio)
 
 int tt_tlb_map(tt_device_t* dev, tt_tlb_t* tlb, tt_noc_addr_config_t* config)
 {
-    struct tenstorrent_configure_tlb configure_tlb = {0};
+    const tt_noc_addr_config_t* last = &tlb->config;
 
     if (config->addr & (tlb->size - 1)) {
         return -EINVAL;
     }
 
-    configure_tlb.in.id = tlb->id;
-    configure_tlb.in.config.addr = config->addr;
-    configure_tlb.in.config.x_end = config->x_end;
-    configure_tlb.in.config.y_end = config->y_end;
-    configure_tlb.in.config.x_start = config->x_start;
-    configure_tlb.in.config.y_start = config->y_start;
-    configure_tlb.in.config.noc = config->noc;
-    configure_tlb.in.config.mcast = config->mcast;
-    configure_tlb.in.config.ordering = config->ordering;
-    configure_tlb.in.config.static_vc = config->static_vc;
+    if (tlb->configured && last->addr == config->addr && last->x_end == config->x_end &&
+        last->y_end == config->y_end && last->x_start == config->x_start && last->y_start == config->y_start &&
+        last->noc == config->noc && last->mcast == config->mcast && last->ordering == config->ordering &&
+        last->static_vc == config->static_vc) {
+        STAT_INC(dev->tlb_remaps_elided);
+        return 0;
+    }
+
+    /* If configuring fails the window's state is unknown; don't elide the retry. */
+    tlb->configured = 0;
 
-    if (ioctl(dev->fd, TENSTORRENT_IOCTL_CONFIGURE_TLB, &configure_tlb) != 0) {
-        return -errno;
+    STAT_INC(dev->tlb_remaps_issued);
+    int ret = dev->ops->tlb_configure(dev->backend, tlb->id, config);
+    if (ret != 0) {
+        return ret;
     }
 
+    tlb->config = *config;
+    tlb->configured = 1;
+
     return 0;
 }
 
 int tt_tlb_map_unicast(tt_device_t* dev, tt_tlb_t* tlb, uint8_t x, uint8_t y, uint64_t addr)
 {
-    struct tenstorrent_configure_tlb configure_tlb = {0};
+    tt_noc_addr_config_t config = {0};
 
-    if (addr & (tlb->size - 1)) {
-        return -EINVAL;
-    }
-
-    configure_tlb.in.id = tlb->id;
-    configure_tlb.in.config.addr = addr;
-    configure_tlb.in.config.x_end = x;
-    configure_tlb.in.config.y_end = y;
+    config.addr = addr;
+    config.x_end = x;
+    config.y_end = y;
 
-    if (ioctl(dev->fd, TENSTORRENT_IOCTL_CONFIGURE_TLB, &configure_tlb) != 0) {
-        return -errno;
-    }
-
-    return 0;
+    return tt_tlb_map(dev, tlb, &config);
 }
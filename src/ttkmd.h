@@ -58,6 +58,20 @@ typedef struct tt_noc_addr_config_t {
     uint8_t static_vc;  /**< 1 to enable static virtual channel */
 } tt_noc_addr_config_t;
 
+/**
+ * @brief Library-side counters for a device; see `tt_device_get_stats()`.
+ */
+typedef struct tt_device_stats_t {
+    uint64_t tlb_remaps_issued;     /**< Window reconfigurations issued by `tt_tlb_map()` */
+    uint64_t tlb_remaps_elided;     /**< Remaps skipped; window already had the requested config */
+    uint64_t thread_windows;        /**< Windows currently owned by calling threads (see `tt_noc_read()`) */
+    uint64_t reserved_windows;      /**< Windows dedicated to a tile by `tt_noc_reserve()` */
+    uint64_t dma_cache_hits;        /**< `tt_dma_map()` calls served by an existing pin */
+    uint64_t dma_cache_misses;      /**< `tt_dma_map()` calls that pinned (with the cache enabled) */
+    uint64_t dma_cache_evictions;   /**< Idle pins dropped to stay under the byte limit */
+    uint64_t dma_cache_pinned_bytes;/**< Bytes currently pinned by the cache, idle or in use */
+} tt_device_stats_t;
+
 /**
  * @brief Supported Tenstorrent device architectures.
  */
@@ -83,6 +97,7 @@ enum tt_device_attr {
     TT_DEVICE_ATTR_NUM_2M_TLBS = 9,
     TT_DEVICE_ATTR_NUM_16M_TLBS = 10,
     TT_DEVICE_ATTR_NUM_4G_TLBS = 11,
+    TT_DEVICE_ATTR_MAX_DMA_BUF_SIZE = 12,   /**< Largest `tt_dma_alloc()` buffer in bytes; 0 if unknown */
 };
 
 /**
@@ -124,7 +139,12 @@ enum tt_noc_ordering {
 /**
  * @brief Open a Tenstorrent device.
  *
- * @param chardev_path e.g. "/dev/tenstorrent/0"
+ * A path of the form "sim:<arch>" ("sim:blackhole" or "sim:wormhole") opens
+ * an in-process simulated device instead: per-tile memory behind real TLB
+ * window mappings, with no firmware or host DMA.  Useful for exercising and
+ * benchmarking the library without a card.
+ *
+ * @param chardev_path e.g. "/dev/tenstorrent/0" or "sim:blackhole"
  * @param out_dev Device handle
  */
 int tt_device_open(const char* chardev_path, tt_device_t** out_dev);
@@ -146,6 +166,18 @@ int tt_device_close(tt_device_t* dev);
  */
 int tt_device_get_attr(tt_device_t* dev, enum tt_device_attr attr, uint64_t* out_value);
 
+/**
+ * @brief Snapshot the library's counters for a device.
+ *
+ * Counters are cumulative since `tt_device_open()` and are updated without
+ * locking, so a snapshot taken while other threads are active is approximate.
+ *
+ * @param dev Device handle
+ * @param out_stats Counter values
+ * @return 0 on success, error code on failure
+ */
+int tt_device_get_stats(tt_device_t* dev, tt_device_stats_t* out_stats);
+
 /**
  * @brief Query driver attributes.
  *
@@ -160,7 +192,10 @@ int tt_driver_get_attr(tt_device_t* dev, enum tt_driver_attr attr, uint64_t* out
  * @brief Convenience function to read a 32-bit value from a device NOC address.
  *
  * Appropriate for reading device registers or memory.
- * Inefficient due to resource lifecycle management overhead.
+ * Uses an uncached TLB window owned by the calling thread (or, once the
+ * device's per-thread budget is spent, one from a small shared cache); costs at
+ * most one TLB reconfiguration, and none if the window already targets the same
+ * page.
  *
  * @param dev Device handle
  * @param x NOC0 x-coordinate
@@ -175,7 +210,10 @@ int tt_noc_read32(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, uint32_
  * @brief Convenience function to write a 32-bit value to a device NOC address.
  *
  * Appropriate for writing device registers or memory.
- * Inefficient due to resource lifecycle management overhead.
+ * Uses an uncached TLB window owned by the calling thread (or, once the
+ * device's per-thread budget is spent, one from a small shared cache); costs at
+ * most one TLB reconfiguration, and none if the window already targets the same
+ * page.
  *
  * @param dev Device handle
  * @param x NOC0 x-coordinate
@@ -190,7 +228,10 @@ int tt_noc_write32(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, uint32
  * @brief Convenience function for reading from the device NOC.
  *
  * Appropriate for reading device memory (L1/DRAM).
- * Inefficient due to resource lifecycle management overhead.
+ * Uses a write-combined TLB window owned by the calling thread (or, once the
+ * device's per-thread budget is spent, one from a small shared cache) and
+ * reconfigures it once per window-sized page touched.  Threads therefore don't
+ * contend with each other.
  *
  * @param dev Device handle
  * @param x NOC0 x-coordinate
@@ -206,7 +247,10 @@ int tt_noc_read(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, void* dst
  * @brief Convenience function for writing to the device NOC.
  *
  * Appropriate for writing device memory (L1/DRAM).
- * Inefficient due to resource lifecycle management overhead.
+ * Uses a write-combined TLB window owned by the calling thread (or, once the
+ * device's per-thread budget is spent, one from a small shared cache) and
+ * reconfigures it once per window-sized page touched.  Threads therefore don't
+ * contend with each other.
  *
  * @param dev Device handle
  * @param x NOC0 x-coordinate
@@ -218,6 +262,172 @@ int tt_noc_read(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, void* dst
  */
 int tt_noc_write(tt_device_t* dev, uint8_t x, uint8_t y, uint64_t addr, const void* src, size_t len);
 
+/**
+ * @brief Write the same data to a rectangle of tiles with one NOC multicast.
+ *
+ * The rectangle is inclusive and in NOC0 coordinates. Every tile inside it
+ * receives the write, so it must not contain tiles that can't accept it (e.g.
+ * harvested or non-Tensix tiles); split the target set into rectangles that
+ * avoid them.
+ *
+ * @param dev Device handle
+ * @param x_start Rectangle start x-coordinate
+ * @param y_start Rectangle start y-coordinate
+ * @param x_end Rectangle end x-coordinate; >= x_start
+ * @param y_end Rectangle end y-coordinate; >= y_start
+ * @param addr NOC address; 4-byte aligned
+ * @param src Pointer to the data to write
+ * @param len Number of bytes to write; multiple of 4
+ * @return int 0 on success, error code on failure
+ */
+int tt_noc_multicast_write(tt_device_t* dev, uint8_t x_start, uint8_t y_start, uint8_t x_end, uint8_t y_end,
+                           uint64_t addr, const void* src, size_t len);
+
+/**
+ * @brief Dedicate a window to the first `size` bytes of a tile.
+ *
+ * The window is mapped once and never moved.  From then on `tt_noc_read()`,
+ * `tt_noc_write()` and the vectored functions go straight to it for any range
+ * inside [0, size) of (x, y): a plain copy, no window selection, no syscalls.
+ * 32-bit accesses still use uncached windows.
+ *
+ * Intended for a few hot targets, e.g. the Blackhole GDDR channels with
+ * `TT_TLB_SIZE_4G` windows, of which there are only 8.  Windows used this way
+ * are unavailable to everything else until `tt_noc_unreserve()`.
+ *
+ * @param dev Device handle
+ * @param x NOC0 x-coordinate
+ * @param y NOC0 y-coordinate
+ * @param size Window size; one of the TT_TLB_SIZE_* sizes the device has
+ * @return int 0 on success, -EEXIST if (x, y) is already reserved, -ENOSPC if
+ *         16 tiles are already reserved, other error code on failure
+ */
+int tt_noc_reserve(tt_device_t* dev, uint8_t x, uint8_t y, size_t size);
+
+/**
+ * @brief Release the window reserved for a tile by `tt_noc_reserve()`.
+ *
+ * Must not race with NOC transfers to that tile from other threads.
+ *
+ * @param dev Device handle
+ * @param x NOC0 x-coordinate
+ * @param y NOC0 y-coordinate
+ * @return int 0 on success, -ENOENT if (x, y) isn't reserved
+ */
+int tt_noc_unreserve(tt_device_t* dev, uint8_t x, uint8_t y);
+
+/**
+ * @brief One element of a vectored NOC transfer; see `tt_noc_readv()`.
+ */
+typedef struct tt_noc_iov_t {
+    uint8_t x;          /**< NOC0 x-coordinate */
+    uint8_t y;          /**< NOC0 y-coordinate */
+    uint64_t addr;      /**< NOC address; 4-byte aligned */
+    void* buf;          /**< Destination for reads; source for writes */
+    size_t len;         /**< Number of bytes; multiple of 4 */
+} tt_noc_iov_t;
+
+/**
+ * @brief Read from many NOC locations in one call.
+ *
+ * Descriptors are executed grouped by tile and window-sized page so that each
+ * distinct page costs at most one TLB reconfiguration per window type, using
+ * the device's cached windows. 4-byte descriptors go through an uncached
+ * window, as with `tt_noc_read32()`; longer ones through a write-combined
+ * window.
+ *
+ * Descriptors targeting the same page execute in array order, whichever
+ * window they use; no other ordering is guaranteed. On error, some descriptors may have been executed.
+ *
+ * @param dev Device handle
+ * @param iov Array of descriptors
+ * @param count Number of descriptors
+ * @return 0 on success, error code on failure
+ */
+int tt_noc_readv(tt_device_t* dev, const tt_noc_iov_t* iov, size_t count);
+
+/**
+ * @brief Write to many NOC locations in one call.
+ *
+ * The write counterpart of `tt_noc_readv()`, with the same grouping and
+ * ordering rules.
+ *
+ * @param dev Device handle
+ * @param iov Array of descriptors
+ * @param count Number of descriptors
+ * @return 0 on success, error code on failure
+ */
+int tt_noc_writev(tt_device_t* dev, const tt_noc_iov_t* iov, size_t count);
+
+/**
+ * @brief Copy kernels for transfers through TLB windows.
+ *
+ * `TT_COPY_KERNEL_AUTO` picks the widest kernel the CPU supports; this is done
+ * once when the library is loaded.
+ */
+enum tt_copy_kernel {
+    TT_COPY_KERNEL_AUTO = 0,
+    TT_COPY_KERNEL_SCALAR,      /**< 32-bit loads/stores; the only kernel on non-x86 hosts */
+    TT_COPY_KERNEL_SSE2,        /**< 16-byte NT stores; 16-byte streaming loads if SSE4.1 */
+    TT_COPY_KERNEL_AVX2,        /**< 32-byte NT stores and streaming loads */
+    TT_COPY_KERNEL_AVX512,      /**< 64-byte NT stores and streaming loads */
+};
+
+/**
+ * @brief Copy host memory into a write-combined TLB window.
+ *
+ * Stores full 64-byte lines with non-temporal hints where the CPU supports it
+ * and ends with a store fence, so the data has left the CPU's write-combining
+ * buffers when this returns. `tt_noc_write()` uses this internally.
+ *
+ * @param dst Pointer into a TLB window's MMIO region; 4-byte aligned
+ * @param src Source buffer
+ * @param len Number of bytes; multiple of 4
+ */
+void tt_memcpy_to_device(void* dst, const void* src, size_t len);
+
+/**
+ * @brief Copy from a write-combined TLB window into host memory.
+ *
+ * Reads of at least a few hundred bytes use streaming (MOVNTDQA) loads with
+ * several cache lines in flight; shorter reads use 32-bit loads. `tt_noc_read()`
+ * uses this internally.
+ *
+ * @param dst Destination buffer
+ * @param src Pointer into a TLB window's MMIO region; 4-byte aligned
+ * @param len Number of bytes; multiple of 4
+ */
+void tt_memcpy_from_device(void* dst, const void* src, size_t len);
+
+/**
+ * @brief Select the kernel used by `tt_memcpy_to_device()` and
+ * `tt_memcpy_from_device()`.
+ *
+ * Not safe to call while other threads are copying.
+ *
+ * @param kernel Kernel to use, or `TT_COPY_KERNEL_AUTO`
+ * @return 0 on success, -ENOTSUP if the CPU lacks the required instructions
+ */
+int tt_copy_select(enum tt_copy_kernel kernel);
+
+/**
+ * @brief Check whether a copy kernel can run on this CPU.
+ *
+ * @param kernel Kernel to check
+ * @return 1 if supported, 0 otherwise
+ */
+int tt_copy_is_supported(enum tt_copy_kernel kernel);
+
+/**
+ * @brief Get the kernel currently used by the `tt_memcpy_*_device()` functions.
+ */
+enum tt_copy_kernel tt_copy_get_kernel(void);
+
+/**
+ * @brief Get a short human-readable name for a copy kernel, e.g. "avx2".
+ */
+const char* tt_copy_kernel_name(enum tt_copy_kernel kernel);
+
 /**
  * @brief Flags to control how a host memory buffer is mapped for device access.
  *
@@ -298,6 +508,96 @@ int tt_dma_map(tt_device_t* dev, void* addr, size_t len, int flags, tt_dma_t** o
  */
 int tt_dma_unmap(tt_device_t* dev, tt_dma_t* dma);
 
+/**
+ * @brief Allocates a DMA buffer in the driver and maps it into the process.
+ *
+ * The driver allocates the memory with dma_alloc_coherent().  Unlike memory
+ * pinned with `tt_dma_map()`, it is coherent with the device even on hosts
+ * whose PCIe isn't I/O coherent (there, the CPU's mapping is uncached, so CPU
+ * access is slow).  It is physically contiguous, so no IOMMU is needed.
+ *
+ * Limitations:
+ * - `len` may not exceed `TT_DEVICE_ATTR_MAX_DMA_BUF_SIZE`
+ * - `TT_DMA_FLAG_NOC_TOP_DOWN` is not supported
+ * - tt-kmd releases the memory only when the device is closed, and allows at
+ *   most 256 allocations per open device; `tt_dma_free()` only unmaps it
+ *
+ * Use `tt_dma_get_mem()` for the buffer's virtual address.
+ *
+ * @param dev Device handle
+ * @param len Number of bytes; must be a multiple of the page size
+ * @param flags `TT_DMA_FLAG_NONE` or `TT_DMA_FLAG_NOC`
+ * @param out_dma On success, a handle for the buffer
+ * @return 0 on success, error code on failure
+ */
+int tt_dma_alloc(tt_device_t* dev, size_t len, int flags, tt_dma_t** out_dma);
+
+/**
+ * @brief Releases a buffer from `tt_dma_alloc()`.
+ *
+ * @param dev Device handle
+ * @param dma DMA handle from `tt_dma_alloc()`
+ * @return 0 on success, error code on failure
+ */
+int tt_dma_free(tt_device_t* dev, tt_dma_t* dma);
+
+/**
+ * @brief Gets the virtual address of a DMA buffer or mapping.
+ *
+ * @param dma DMA handle from `tt_dma_alloc()` or `tt_dma_map()`
+ * @param out_mem Virtual address of the memory
+ * @return 0 on success, error code on failure
+ */
+int tt_dma_get_mem(tt_dma_t* dma, void** out_mem);
+
+/**
+ * @brief Keep pins around after `tt_dma_unmap()` so mapping the same memory
+ * again is free.
+ *
+ * With the cache enabled, `tt_dma_map()` reuses any cached pin that covers the
+ * requested range with the same flags, and a request that overlaps or abuts
+ * idle pins replaces them with one pin of the union.  `tt_dma_unmap()` only
+ * drops a reference; idle pins are unpinned least recently used first when the
+ * cache holds more than `max_pinned_bytes`, or when a new pin fails for lack of
+ * room (e.g. in the Wormhole NOC aperture).
+ *
+ * A cached pin refers to the pages that were mapped when it was created.  The
+ * application must call `tt_dma_cache_invalidate()` before it unmaps or frees
+ * memory that has been passed to `tt_dma_map()`, or a later buffer at the same
+ * address could be handed a stale pin.  Opt-in for that reason.
+ *
+ * @param dev Device handle
+ * @param max_pinned_bytes Limit on bytes pinned by the cache (in-use pins are
+ *        never unpinned, so it can be exceeded while they're held)
+ * @return 0 on success, error code on failure
+ */
+int tt_dma_cache_enable(tt_device_t* dev, size_t max_pinned_bytes);
+
+/**
+ * @brief Stop caching pins and unpin the idle ones.
+ *
+ * Pins still in use are unpinned by their last `tt_dma_unmap()`.
+ *
+ * @param dev Device handle
+ * @return 0 on success, error code on failure
+ */
+int tt_dma_cache_disable(tt_device_t* dev);
+
+/**
+ * @brief Forget cached pins overlapping [addr, addr + len).
+ *
+ * Call before unmapping or freeing memory that has been passed to
+ * `tt_dma_map()`.  Idle pins are unpinned now; pins still in use are unpinned by
+ * their last `tt_dma_unmap()` and are not reused in the meantime.  A no-op when
+ * the cache is disabled.
+ *
+ * @param dev Device handle
+ * @param addr Start of the range
+ * @param len Number of bytes
+ * @return 0 on success, error code on failure
+ */
+int tt_dma_cache_invalidate(tt_device_t* dev, void* addr, size_t len);
+
 /**
  * @brief Gets the DMA address for a mapped memory region.
  *
@@ -336,7 +636,11 @@ int tt_dma_get_noc_addr(tt_dma_t* dma, uint64_t* out_noc_addr);
  *   202x  2 MiB windows
  *     8x  4 GiB windows
  *
- * The driver may reserve one or more TLB windows for internal use.
+ * The driver may reserve one or more TLB windows for internal use.  The
+ * library also keeps some for the `tt_noc_*` functions: 8 for its shared cache
+ * (4 per caching mode) and up to the thread window budget, 8 by default, for
+ * calling threads; see `tt_device_set_thread_window_budget()`.  Those are
+ * 1 MiB windows on WH and 2 MiB windows on BH.
  *
  * @param dev Device handle
  * @param size 1, 2, or 16 MiB (WH); 2 MiB or 4 GiB (BH)
@@ -346,6 +650,22 @@ int tt_dma_get_noc_addr(tt_dma_t* dma, uint64_t* out_noc_addr);
  */
 int tt_tlb_alloc(tt_device_t* dev, size_t size, enum tt_tlb_cache_mode cache, tt_tlb_t** out_tlb);
 
+/**
+ * @brief Limit the windows calling threads may own for the `tt_noc_*` functions.
+ *
+ * Each thread that calls them gets a window of its own per caching mode, kept
+ * until the thread exits, while the device's total is under this budget;
+ * later threads share the library's cache instead.  Raising it suits programs
+ * with many I/O threads and few windows of their own.  Lowering it doesn't take
+ * windows back from threads that have them, and a thread refused a window keeps
+ * using the shared cache, so set it before the threads start.
+ *
+ * @param dev Device handle
+ * @param windows Windows of the cache size (1 MiB on WH, 2 MiB on BH); 0 disables per-thread windows
+ * @return 0 on success, -EINVAL if the device has fewer windows than that
+ */
+int tt_device_set_thread_window_budget(tt_device_t* dev, uint64_t windows);
+
 /**
  * @brief Releases a TLB window.
  *
@@ -371,6 +691,9 @@ int tt_tlb_get_mmio(tt_tlb_t* tlb, void** out_mmio);
 /**
  * @brief Maps a TLB window to a NOC endpoint.
  *
+ * The library remembers the last configuration applied to each window; asking
+ * for the same configuration again returns immediately without an ioctl.
+ *
  * @param dev Device handle
  * @param tlb TLB window handle from `tt_tlb_alloc()`
  * @param config NOC address configuration
@@ -0,0 +1,56 @@
+/**
+ * SPDX-FileCopyrightText: © 2025 Tenstorrent Inc.
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Internal to libttkmd: the operations a device backend provides.
+ *
+ * ttkmd.c implements the public API (window cache, NOC I/O, DMA bookkeeping)
+ * in terms of these; a backend only has to talk to the device.  There are two:
+ *
+ *   tt_kmd_backend  the tt-kmd character device (ioctl + mmap)
+ *   tt_sim_backend  an in-process simulated device, selected by opening a path
+ *                   of the form "sim:<arch>", e.g. "sim:blackhole"
+ *
+ * Every operation returns 0 on success or a negative errno value.
+ */
+
+#ifndef TTKMD_BACKEND_H
+#define TTKMD_BACKEND_H
+
+#include "ttkmd.h"
+
+#include "ioctl.h"    /* From tt-kmd */
+
+#define TT_SIM_PATH_PREFIX "sim:"
+
+struct tt_backend_ops {
+    const char* name;
+
+    /* Open the device at `path`; *out_ctx is passed to every other operation. */
+    int (*open)(const char* path, void** out_ctx);
+    int (*close)(void* ctx);
+
+    int (*get_device_info)(void* ctx, struct tenstorrent_get_device_info_out* out);
+    int (*get_driver_info)(void* ctx, struct tenstorrent_get_driver_info_out* out);
+
+    /* Allocate a window of `size` bytes and map it into the process. */
+    int (*tlb_alloc)(void* ctx, size_t size, enum tt_tlb_cache_mode cache, uint32_t* out_id, void** out_mmio);
+    int (*tlb_free)(void* ctx, uint32_t id, void* mmio, size_t size);
+    int (*tlb_configure)(void* ctx, uint32_t id, const tt_noc_addr_config_t* config);
+
+    /* `flags` are TENSTORRENT_PIN_PAGES_*; *out_noc is only set for NOC DMA. */
+    int (*pin_pages)(void* ctx, void* addr, size_t len, uint32_t flags, uint64_t* out_iova, uint64_t* out_noc);
+    int (*unpin_pages)(void* ctx, void* addr, size_t len);
+
+    /* Driver-allocated DMA memory; `flags` are TENSTORRENT_ALLOCATE_DMA_BUF_*. */
+    int (*dma_alloc)(void* ctx, size_t len, uint32_t flags, void** out_mem, uint64_t* out_iova, uint64_t* out_noc);
+    int (*dma_free)(void* ctx, void* mem, size_t len);
+};
+
+extern const struct tt_backend_ops tt_kmd_backend;
+extern const struct tt_backend_ops tt_sim_backend;
+
+/* Number of windows of `size` bytes the architecture has; 0 if none. */
+uint64_t tt_arch_tlb_count(uint64_t arch, size_t size);
+
+#endif
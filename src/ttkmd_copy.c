@@ -0,0 +1,352 @@
+/**
+ * SPDX-FileCopyrightText: © 2025 Tenstorrent Inc.
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * Copy kernels for moving data through write-combined TLB windows.
+ *
+ * A WC window only produces large PCIe writes if the CPU fills whole 64-byte
+ * write-combining buffers.  Scalar 32-bit stores leave most of each buffer
+ * empty, so the vector kernels align the destination to a cache line, emit
+ * full-line non-temporal stores, and finish with an sfence so the data is on
+ * its way to the device before the caller does anything else (e.g. a remap).
+ *
+ * Reads go the other way: PCIe reads are latency-bound, so one 4-byte load at
+ * a time leaves the link idle.  The read kernels use streaming loads (MOVNTDQA)
+ * from the WC mapping and issue a batch of them before storing any, so several
+ * reads are outstanding at once.  Small reads aren't worth the alignment work
+ * and always use 32-bit loads.
+ *
+ * The kernel is chosen by CPUID when the library is loaded; callers can
+ * override it with tt_copy_select(), e.g. to benchmark each one.
+ */
+
+#include "ttkmd.h"
+
+#include <errno.h>
+#include <stdint.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define CACHE_LINE 64
+
+/* Reads shorter than this use 32-bit loads regardless of the kernel. */
+#define STREAM_READ_MIN 256
+
+/* Cache lines loaded per iteration of the streaming read loops. */
+#define READ_LINES_IN_FLIGHT 4
+
+typedef void (*copy_fn)(void* dst, const void* src, size_t len);
+
+/*
+ * 32-bit stores up to the first cache line boundary of dst (or the end of the
+ * buffer).  Returns the number of bytes copied.
+ */
+static inline size_t copy_head32(uint8_t* dst, const uint8_t* src, size_t len)
+{
+    size_t head = (CACHE_LINE - ((uintptr_t)dst & (CACHE_LINE - 1))) & (CACHE_LINE - 1);
+
+    if (head > len) {
+        head = len;
+    }
+
+    for (size_t i = 0; i < head / sizeof(uint32_t); ++i) {
+        volatile uint32_t* dst32 = (volatile uint32_t*)dst;
+        dst32[i] = ((const uint32_t*)src)[i];
+    }
+
+    return head;
+}
+
+static inline void copy_tail32(uint8_t* dst, const uint8_t* src, size_t len)
+{
+    for (size_t i = 0; i < len / sizeof(uint32_t); ++i) {
+        volatile uint32_t* dst32 = (volatile uint32_t*)dst;
+        dst32[i] = ((const uint32_t*)src)[i];
+    }
+}
+
+/* Read-side counterparts; here it's the source (device) that gets aligned. */
+static inline size_t read_head32(uint8_t* dst, const uint8_t* src, size_t len)
+{
+    size_t head = (CACHE_LINE - ((uintptr_t)src & (CACHE_LINE - 1))) & (CACHE_LINE - 1);
+
+    if (head > len) {
+        head = len;
+    }
+
+    for (size_t i = 0; i < head / sizeof(uint32_t); ++i) {
+        volatile const uint32_t* src32 = (volatile const uint32_t*)src;
+        ((uint32_t*)dst)[i] = src32[i];
+    }
+
+    return head;
+}
+
+static inline void read_tail32(uint8_t* dst, const uint8_t* src, size_t len)
+{
+    for (size_t i = 0; i < len / sizeof(uint32_t); ++i) {
+        volatile const uint32_t* src32 = (volatile const uint32_t*)src;
+        ((uint32_t*)dst)[i] = src32[i];
+    }
+}
+
+static void read_scalar(void* dst, const void* src, size_t len)
+{
+    read_tail32((uint8_t*)dst, (const uint8_t*)src, len);
+}
+
+static void copy_scalar(void* dst, const void* src, size_t len)
+{
+    copy_tail32((uint8_t*)dst, (const uint8_t*)src, len);
+
+#if defined(__x86_64__)
+    _mm_sfence();
+#endif
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse2")))
+static void copy_sse2(void* dst, const void* src, size_t len)
+{
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+    size_t n = copy_head32(d, s, len);
+
+    for (; n + CACHE_LINE <= len; n += CACHE_LINE) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(s + n + 0));
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + n + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(s + n + 32));
+        __m128i e = _mm_loadu_si128((const __m128i*)(s + n + 48));
+        _mm_stream_si128((__m128i*)(d + n + 0), a);
+        _mm_stream_si128((__m128i*)(d + n + 16), b);
+        _mm_stream_si128((__m128i*)(d + n + 32), c);
+        _mm_stream_si128((__m128i*)(d + n + 48), e);
+    }
+
+    copy_tail32(d + n, s + n, len - n);
+    _mm_sfence();
+}
+
+__attribute__((target("avx2")))
+static void copy_avx2(void* dst, const void* src, size_t len)
+{
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+    size_t n = copy_head32(d, s, len);
+
+    for (; n + CACHE_LINE <= len; n += CACHE_LINE) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(s + n + 0));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(s + n + 32));
+        _mm256_stream_si256((__m256i*)(d + n + 0), a);
+        _mm256_stream_si256((__m256i*)(d + n + 32), b);
+    }
+
+    copy_tail32(d + n, s + n, len - n);
+    _mm_sfence();
+}
+
+__attribute__((target("avx512f")))
+static void copy_avx512(void* dst, const void* src, size_t len)
+{
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+    size_t n = copy_head32(d, s, len);
+
+    for (; n + CACHE_LINE <= len; n += CACHE_LINE) {
+        __m512i a = _mm512_loadu_si512((const void*)(s + n));
+        _mm512_stream_si512((void*)(d + n), a);
+    }
+
+    copy_tail32(d + n, s + n, len - n);
+    _mm_sfence();
+}
+
+#define READ_BLOCK (CACHE_LINE * READ_LINES_IN_FLIGHT)
+
+__attribute__((target("sse4.1")))
+static void read_sse41(void* dst, const void* src, size_t len)
+{
+    uint8_t* d = (uint8_t*)dst;
+    uint8_t* s = (uint8_t*)src;
+    size_t n = read_head32(d, s, len);
+
+    for (; n + READ_BLOCK <= len; n += READ_BLOCK) {
+        __m128i v[READ_BLOCK / 16];
+        for (size_t i = 0; i < READ_BLOCK / 16; ++i) {
+            v[i] = _mm_stream_load_si128((__m128i*)(s + n + i * 16));
+        }
+        for (size_t i = 0; i < READ_BLOCK / 16; ++i) {
+            _mm_storeu_si128((__m128i*)(d + n + i * 16), v[i]);
+        }
+    }
+
+    read_tail32(d + n, s + n, len - n);
+}
+
+__attribute__((target("avx2")))
+static void read_avx2(void* dst, const void* src, size_t len)
+{
+    uint8_t* d = (uint8_t*)dst;
+    uint8_t* s = (uint8_t*)src;
+    size_t n = read_head32(d, s, len);
+
+    for (; n + READ_BLOCK <= len; n += READ_BLOCK) {
+        __m256i v[READ_BLOCK / 32];
+        for (size_t i = 0; i < READ_BLOCK / 32; ++i) {
+            v[i] = _mm256_stream_load_si256((__m256i*)(s + n + i * 32));
+        }
+        for (size_t i = 0; i < READ_BLOCK / 32; ++i) {
+            _mm256_storeu_si256((__m256i*)(d + n + i * 32), v[i]);
+        }
+    }
+
+    read_tail32(d + n, s + n, len - n);
+}
+
+__attribute__((target("avx512f")))
+static void read_avx512(void* dst, const void* src, size_t len)
+{
+    uint8_t* d = (uint8_t*)dst;
+    uint8_t* s = (uint8_t*)src;
+    size_t n = read_head32(d, s, len);
+
+    for (; n + READ_BLOCK <= len; n += READ_BLOCK) {
+        __m512i v[READ_BLOCK / 64];
+        for (size_t i = 0; i < READ_BLOCK / 64; ++i) {
+            v[i] = _mm512_stream_load_si512((void*)(s + n + i * 64));
+        }
+        for (size_t i = 0; i < READ_BLOCK / 64; ++i) {
+            _mm512_storeu_si512((void*)(d + n + i * 64), v[i]);
+        }
+    }
+
+    read_tail32(d + n, s + n, len - n);
+}
+
+#endif
+
+static const char* KERNEL_NAMES[] = {
+    [TT_COPY_KERNEL_AUTO] = "auto",
+    [TT_COPY_KERNEL_SCALAR] = "scalar",
+    [TT_COPY_KERNEL_SSE2] = "sse2",
+    [TT_COPY_KERNEL_AVX2] = "avx2",
+    [TT_COPY_KERNEL_AVX512] = "avx512",
+};
+
+static enum tt_copy_kernel selected_kernel = TT_COPY_KERNEL_SCALAR;
+static copy_fn selected_to_device = copy_scalar;
+static copy_fn selected_from_device = read_scalar;
+
+static int kernel_supported(enum tt_copy_kernel kernel)
+{
+    switch (kernel) {
+        case TT_COPY_KERNEL_SCALAR:
+            return 1;
+#if defined(__x86_64__)
+        case TT_COPY_KERNEL_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case TT_COPY_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case TT_COPY_KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return 0;
+    }
+}
+
+static enum tt_copy_kernel best_kernel(void)
+{
+    static const enum tt_copy_kernel preference[] = {
+        TT_COPY_KERNEL_AVX512,
+        TT_COPY_KERNEL_AVX2,
+        TT_COPY_KERNEL_SSE2,
+    };
+
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); ++i) {
+        if (kernel_supported(preference[i])) {
+            return preference[i];
+        }
+    }
+
+    return TT_COPY_KERNEL_SCALAR;
+}
+
+int tt_copy_select(enum tt_copy_kernel kernel)
+{
+    if (kernel == TT_COPY_KERNEL_AUTO) {
+        kernel = best_kernel();
+    }
+
+    if (!kernel_supported(kernel)) {
+        return -ENOTSUP;
+    }
+
+    switch (kernel) {
+#if defined(__x86_64__)
+        case TT_COPY_KERNEL_SSE2:
+            selected_to_device = copy_sse2;
+            selected_from_device = __builtin_cpu_supports("sse4.1") ? read_sse41 : read_scalar;
+            break;
+        case TT_COPY_KERNEL_AVX2:
+            selected_to_device = copy_avx2;
+            selected_from_device = read_avx2;
+            break;
+        case TT_COPY_KERNEL_AVX512:
+            selected_to_device = copy_avx512;
+            selected_from_device = read_avx512;
+            break;
+#endif
+        default:
+            selected_to_device = copy_scalar;
+            selected_from_device = read_scalar;
+            break;
+    }
+
+    selected_kernel = kernel;
+    return 0;
+}
+
+int tt_copy_is_supported(enum tt_copy_kernel kernel)
+{
+    return kernel == TT_COPY_KERNEL_AUTO || kernel_supported(kernel);
+}
+
+enum tt_copy_kernel tt_copy_get_kernel(void)
+{
+    return selected_kernel;
+}
+
+const char* tt_copy_kernel_name(enum tt_copy_kernel kernel)
+{
+    if ((size_t)kernel >= sizeof(KERNEL_NAMES) / sizeof(KERNEL_NAMES[0])) {
+        return "unknown";
+    }
+    return KERNEL_NAMES[kernel];
+}
+
+void tt_memcpy_to_device(void* dst, const void* src, size_t len)
+{
+    selected_to_device(dst, src, len);
+}
+
+void tt_memcpy_from_device(void* dst, const void* src, size_t len)
+{
+    if (len < STREAM_READ_MIN) {
+        read_scalar(dst, src, len);
+    } else {
+        selected_from_device(dst, src, len);
+    }
+}
+
+__attribute__((constructor))
+static void copy_init(void)
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+#endif
+    tt_copy_select(TT_COPY_KERNEL_AUTO);
+}
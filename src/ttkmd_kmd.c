@@ -0,0 +1,268 @@
+/**
+ * SPDX-FileCopyrightText: © 2025 Tenstorrent Inc.
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * libttkmd backend for the tt-kmd character device.
+ */
+
+#include "ttkmd_backend.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+struct kmd_device {
+    int fd;
+    pthread_mutex_t dma_buf_lock;
+    uint32_t next_dma_buf;  /* tt-kmd's buffer indices aren't reusable; under dma_buf_lock */
+};
+
+static int kmd_open(const char* path, void** out_ctx)
+{
+    struct kmd_device* kmd = malloc(sizeof(struct kmd_device));
+
+    if (!kmd) {
+        return -ENOMEM;
+    }
+
+    kmd->next_dma_buf = 0;
+    kmd->fd = open(path, O_RDWR | O_CLOEXEC);
+    if (kmd->fd == -1) {
+        int e = errno;
+        free(kmd);
+        return -e;
+    }
+    pthread_mutex_init(&kmd->dma_buf_lock, NULL);
+
+    *out_ctx = kmd;
+
+    return 0;
+}
+
+static int kmd_close(void* ctx)
+{
+    struct kmd_device* kmd = ctx;
+
+    if (close(kmd->fd) != 0) {
+        return -errno;
+    }
+
+    pthread_mutex_destroy(&kmd->dma_buf_lock);
+    free(kmd);
+    return 0;
+}
+
+static int kmd_get_device_info(void* ctx, struct tenstorrent_get_device_info_out* out)
+{
+    struct kmd_device* kmd = ctx;
+    struct tenstorrent_get_device_info get_device_info = {0};
+
+    get_device_info.in.output_size_bytes = sizeof(get_device_info.out);
+
+    if (ioctl(kmd->fd, TENSTORRENT_IOCTL_GET_DEVICE_INFO, &get_device_info) != 0) {
+        return -errno;
+    }
+
+    *out = get_device_info.out;
+    return 0;
+}
+
+static int kmd_get_driver_info(void* ctx, struct tenstorrent_get_driver_info_out* out)
+{
+    struct kmd_device* kmd = ctx;
+    struct tenstorrent_get_driver_info get_driver_info = {0};
+
+    get_driver_info.in.output_size_bytes = sizeof(get_driver_info.out);
+
+    if (ioctl(kmd->fd, TENSTORRENT_IOCTL_GET_DRIVER_INFO, &get_driver_info) != 0) {
+        return -errno;
+    }
+
+    *out = get_driver_info.out;
+    return 0;
+}
+
+static int kmd_tlb_alloc(void* ctx, size_t size, enum tt_tlb_cache_mode cache, uint32_t* out_id, void** out_mmio)
+{
+    struct kmd_device* kmd = ctx;
+    struct tenstorrent_allocate_tlb alloc_tlb = {0};
+
+    alloc_tlb.in.size = size;
+
+    if (ioctl(kmd->fd, TENSTORRENT_IOCTL_ALLOCATE_TLB, &alloc_tlb) != 0) {
+        return -errno;
+    }
+
+    off_t offset = cache == TT_MMIO_CACHE_MODE_UC ? alloc_tlb.out.mmap_offset_uc : alloc_tlb.out.mmap_offset_wc;
+    void* mmio = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, kmd->fd, offset);
+
+    if (mmio == MAP_FAILED) {
+        struct tenstorrent_free_tlb free_tlb = {0};
+        int e = errno;
+        free_tlb.in.id = alloc_tlb.out.id;
+        if (ioctl(kmd->fd, TENSTORRENT_IOCTL_FREE_TLB, &free_tlb) != 0) {
+            fprintf(stderr, "Leaked TLB %u: after mmap failure: %s\n", alloc_tlb.out.id, strerror(errno));
+        }
+        return -e;
+    }
+
+    *out_id = alloc_tlb.out.id;
+    *out_mmio = mmio;
+
+    return 0;
+}
+
+static int kmd_tlb_free(void* ctx, uint32_t id, void* mmio, size_t size)
+{
+    struct kmd_device* kmd = ctx;
+
+    /* Unmap the userspace view of the TLB. This is required by the driver. */
+    munmap(mmio, size);
+
+    /* Tell the driver to release the backing hardware resource. */
+    struct tenstorrent_free_tlb free_tlb = {0};
+    free_tlb.in.id = id;
+    if (ioctl(kmd->fd, TENSTORRENT_IOCTL_FREE_TLB, &free_tlb) != 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+static int kmd_tlb_configure(void* ctx, uint32_t id, const tt_noc_addr_config_t* config)
+{
+    struct kmd_device* kmd = ctx;
+    struct tenstorrent_configure_tlb configure_tlb = {0};
+
+    configure_tlb.in.id = id;
+    configure_tlb.in.config.addr = config->addr;
+    configure_tlb.in.config.x_end = config->x_end;
+    configure_tlb.in.config.y_end = config->y_end;
+    configure_tlb.in.config.x_start = config->x_start;
+    configure_tlb.in.config.y_start = config->y_start;
+    configure_tlb.in.config.noc = config->noc;
+    configure_tlb.in.config.mcast = config->mcast;
+    configure_tlb.in.config.ordering = config->ordering;
+    configure_tlb.in.config.static_vc = config->static_vc;
+
+    if (ioctl(kmd->fd, TENSTORRENT_IOCTL_CONFIGURE_TLB, &configure_tlb) != 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+static int kmd_pin_pages(void* ctx, void* addr, size_t len, uint32_t flags, uint64_t* out_iova, uint64_t* out_noc)
+{
+    struct kmd_device* kmd = ctx;
+    struct {
+        struct tenstorrent_pin_pages_in in;
+        struct tenstorrent_pin_pages_out_extended out;
+    } pin_pages;
+
+    memset(&pin_pages, 0, sizeof(pin_pages));
+
+    pin_pages.in.output_size_bytes = sizeof(pin_pages.out);
+    pin_pages.in.virtual_address = (uint64_t)addr;
+    pin_pages.in.size = len;
+    pin_pages.in.flags = flags;
+
+    if (ioctl(kmd->fd, TENSTORRENT_IOCTL_PIN_PAGES, &pin_pages) != 0) {
+        return -errno;
+    }
+
+    *out_iova = pin_pages.out.physical_address;
+    *out_noc = pin_pages.out.noc_address;
+
+    return 0;
+}
+
+static int kmd_unpin_pages(void* ctx, void* addr, size_t len)
+{
+    struct kmd_device* kmd = ctx;
+    struct tenstorrent_unpin_pages unpin = {0};
+
+    unpin.in.virtual_address = (uint64_t)addr;
+    unpin.in.size = len;
+
+    if (ioctl(kmd->fd, TENSTORRENT_IOCTL_UNPIN_PAGES, &unpin) != 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+static int kmd_dma_alloc(void* ctx, size_t len, uint32_t flags, void** out_mem, uint64_t* out_iova,
+                         uint64_t* out_noc)
+{
+    struct kmd_device* kmd = ctx;
+    struct tenstorrent_allocate_dma_buf alloc = {0};
+
+    /* An index is only used up once the driver has given it a buffer. */
+    pthread_mutex_lock(&kmd->dma_buf_lock);
+    if (kmd->next_dma_buf >= TENSTORRENT_MAX_DMA_BUFS) {
+        pthread_mutex_unlock(&kmd->dma_buf_lock);
+        return -ENOSPC;
+    }
+
+    alloc.in.requested_size = len;
+    alloc.in.buf_index = kmd->next_dma_buf;
+    alloc.in.flags = flags;
+
+    if (ioctl(kmd->fd, TENSTORRENT_IOCTL_ALLOCATE_DMA_BUF, &alloc) != 0) {
+        int e = errno;
+        pthread_mutex_unlock(&kmd->dma_buf_lock);
+        return -e;
+    }
+    kmd->next_dma_buf++;
+    pthread_mutex_unlock(&kmd->dma_buf_lock);
+
+    /* On failure the buffer stays allocated until the device is closed. */
+    void* mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, kmd->fd, alloc.out.mapping_offset);
+    if (mem == MAP_FAILED) {
+        return -errno;
+    }
+
+    *out_mem = mem;
+    *out_iova = alloc.out.physical_address;
+    *out_noc = alloc.out.noc_address;
+
+    return 0;
+}
+
+static int kmd_dma_free(void* ctx, void* mem, size_t len)
+{
+    (void)ctx;
+
+    /*
+     * FREE_DMA_BUF has no way to say which buffer; tt-kmd releases them when
+     * the device is closed.  Drop the mapping so it's no longer reachable.
+     */
+    if (munmap(mem, len) != 0) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+const struct tt_backend_ops tt_kmd_backend = {
+    .name = "tt-kmd",
+    .open = kmd_open,
+    .close = kmd_close,
+    .get_device_info = kmd_get_device_info,
+    .get_driver_info = kmd_get_driver_info,
+    .tlb_alloc = kmd_tlb_alloc,
+    .tlb_free = kmd_tlb_free,
+    .tlb_configure = kmd_tlb_configure,
+    .pin_pages = kmd_pin_pages,
+    .unpin_pages = kmd_unpin_pages,
+    .dma_alloc = kmd_dma_alloc,
+    .dma_free = kmd_dma_free,
+};
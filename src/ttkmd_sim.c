@@ -0,0 +1,520 @@
+/**
+ * SPDX-FileCopyrightText: © 2025 Tenstorrent Inc.
+ * SPDX-License-Identifier: GPL-2.0-only
+ *
+ * In-process simulated device, so the library and the programs built on it
+ * can run (and be benchmarked) on a machine without a card.
+ *
+ * Open "sim:blackhole" or "sim:wormhole".  Every NOC coordinate (6 bits each
+ * way, so Blackhole's translated coordinates work too) is a tile with its own
+ * address space, a sparse memfd created on first use, with the NOC node ID
+ * registers filled in.  TLB windows are real mappings: configuring a
+ * window remaps it (MAP_FIXED) onto the target tile's memfd at the window's
+ * address, so loads and stores through it cost what they would against host
+ * memory and the remap costs a syscall, as with tt-kmd.
+ *
+ * Not modelled: nothing runs on the tiles; a multicast window only reaches the
+ * start tile of its rectangle; and pinned host memory is not visible through
+ * the PCIe tile (pinning succeeds and hands out addresses, but NOC accesses to
+ * them hit the PCIe tile's own memory).  The NOC-to-host aperture's limits are
+ * modelled, so NOC DMA pins fail where the driver's would.
+ */
+
+#define _GNU_SOURCE
+
+#include "ttkmd_backend.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define BLACKHOLE_PCI_DEVICE_ID 0xb140
+#define WORMHOLE_PCI_DEVICE_ID 0x401e
+#define TENSTORRENT_PCI_VENDOR_ID 0x1e52
+
+/* Bytes of NOC address space per tile; covers every address the library uses. */
+#define SIM_TILE_SPAN (1ULL << 40)
+
+#define SIM_GRID_MAX_X 64
+#define SIM_GRID_MAX_Y 64
+
+/* Where pinned host memory appears in the PCIe tile's NOC address space. */
+#define WH_PCIE_NOC_BASE 0x800000000ULL
+#define BH_PCIE_NOC_BASE (1ULL << 60)
+
+/* Reported as the device's largest driver-allocated DMA buffer. */
+#define SIM_MAX_DMA_BUF_SIZE_LOG2 28
+
+/* NOC-to-host aperture limits, as documented for tt_dma_map(). */
+#define WH_APERTURE_SIZE 0xFFFE0000ULL
+#define BH_APERTURE_SIZE (1ULL << 40)
+#define APERTURE_MAX_MAPPINGS 16
+
+static const size_t WINDOW_SIZES[] = {
+    TT_TLB_SIZE_1M,
+    TT_TLB_SIZE_2M,
+    TT_TLB_SIZE_16M,
+    TT_TLB_SIZE_4G,
+};
+
+struct sim_tlb {
+    size_t size;            /* 0 if free */
+    void* mmio;
+};
+
+struct sim_pin {
+    uint64_t addr;
+    size_t len;
+    int noc;                /* Occupies aperture space at noc_offset */
+    uint64_t noc_offset;
+    struct sim_pin* next;
+};
+
+struct sim_device {
+    uint64_t arch;
+    uint16_t device_id;
+    uint64_t pcie_noc_base;
+    pthread_mutex_t lock;
+    int tile_fd[SIM_GRID_MAX_X][SIM_GRID_MAX_Y];    /* -1 until first use */
+    struct sim_tlb* tlbs;
+    size_t num_tlbs;
+    uint64_t aperture_size;
+    struct sim_pin* pins;   /* Under lock */
+};
+
+static int sim_open(const char* path, void** out_ctx)
+{
+    const char* arch_name = path + strlen(TT_SIM_PATH_PREFIX);
+    struct sim_device* sim = malloc(sizeof(struct sim_device));
+
+    if (!sim) {
+        return -ENOMEM;
+    }
+
+    memset(sim, 0, sizeof(struct sim_device));
+
+    if (strcmp(arch_name, "blackhole") == 0 || strcmp(arch_name, "bh") == 0) {
+        sim->arch = TT_DEVICE_ARCH_BLACKHOLE;
+        sim->device_id = BLACKHOLE_PCI_DEVICE_ID;
+        sim->pcie_noc_base = BH_PCIE_NOC_BASE;
+        sim->aperture_size = BH_APERTURE_SIZE;
+    } else if (strcmp(arch_name, "wormhole") == 0 || strcmp(arch_name, "wh") == 0) {
+        sim->arch = TT_DEVICE_ARCH_WORMHOLE;
+        sim->device_id = WORMHOLE_PCI_DEVICE_ID;
+        sim->pcie_noc_base = WH_PCIE_NOC_BASE;
+        sim->aperture_size = WH_APERTURE_SIZE;
+    } else {
+        free(sim);
+        return -ENODEV;
+    }
+
+    for (size_t i = 0; i < sizeof(WINDOW_SIZES) / sizeof(WINDOW_SIZES[0]); ++i) {
+        sim->num_tlbs += tt_arch_tlb_count(sim->arch, WINDOW_SIZES[i]);
+    }
+
+    sim->tlbs = calloc(sim->num_tlbs, sizeof(struct sim_tlb));
+    if (!sim->tlbs) {
+        free(sim);
+        return -ENOMEM;
+    }
+
+    for (size_t x = 0; x < SIM_GRID_MAX_X; ++x) {
+        for (size_t y = 0; y < SIM_GRID_MAX_Y; ++y) {
+            sim->tile_fd[x][y] = -1;
+        }
+    }
+
+    pthread_mutex_init(&sim->lock, NULL);
+
+    *out_ctx = sim;
+
+    return 0;
+}
+
+static int sim_close(void* ctx)
+{
+    struct sim_device* sim = ctx;
+
+    for (size_t i = 0; i < sim->num_tlbs; ++i) {
+        if (sim->tlbs[i].size) {
+            munmap(sim->tlbs[i].mmio, sim->tlbs[i].size);
+        }
+    }
+
+    for (size_t x = 0; x < SIM_GRID_MAX_X; ++x) {
+        for (size_t y = 0; y < SIM_GRID_MAX_Y; ++y) {
+            if (sim->tile_fd[x][y] != -1) {
+                close(sim->tile_fd[x][y]);
+            }
+        }
+    }
+
+    while (sim->pins) {
+        struct sim_pin* pin = sim->pins;
+        sim->pins = pin->next;
+        free(pin);
+    }
+
+    pthread_mutex_destroy(&sim->lock);
+    free(sim->tlbs);
+    free(sim);
+
+    return 0;
+}
+
+static int sim_get_device_info(void* ctx, struct tenstorrent_get_device_info_out* out)
+{
+    struct sim_device* sim = ctx;
+
+    memset(out, 0, sizeof(*out));
+    out->output_size_bytes = sizeof(*out);
+    out->vendor_id = TENSTORRENT_PCI_VENDOR_ID;
+    out->device_id = sim->device_id;
+    out->max_dma_buf_size_log2 = SIM_MAX_DMA_BUF_SIZE_LOG2;
+
+    return 0;
+}
+
+static int sim_get_driver_info(void* ctx, struct tenstorrent_get_driver_info_out* out)
+{
+    (void)ctx;
+
+    memset(out, 0, sizeof(*out));
+    out->output_size_bytes = sizeof(*out);
+    out->driver_version = TENSTORRENT_DRIVER_VERSION;
+    out->driver_version_major = 2;
+
+    return 0;
+}
+
+static int write_reg(int fd, uint64_t addr, uint32_t value)
+{
+    if (pwrite(fd, &value, sizeof(value), addr) != sizeof(value)) {
+        return -errno;
+    }
+    return 0;
+}
+
+/* The tile's NOC node ID registers, wherever the library reads them. */
+static int init_tile(struct sim_device* sim, int fd, uint32_t x, uint32_t y)
+{
+    uint32_t node_id = (y << 6) | x;
+    int ret;
+
+    if ((ret = write_reg(fd, 0xFFB2002CULL, node_id)) != 0) {
+        return ret;
+    }
+
+    if (sim->arch == TT_DEVICE_ARCH_BLACKHOLE) {
+        return write_reg(fd, 0xFFB20148ULL, node_id);
+    }
+
+    /* Wormhole ARC and DDR tiles have theirs above the 4 GiB line. */
+    if ((ret = write_reg(fd, 0xFFFB2002CULL, node_id)) != 0) {
+        return ret;
+    }
+    return write_reg(fd, 0x10009002CULL, node_id);
+}
+
+static int get_tile_fd(struct sim_device* sim, uint32_t x, uint32_t y, int* out_fd)
+{
+    int ret = 0;
+
+    pthread_mutex_lock(&sim->lock);
+
+    if (sim->tile_fd[x][y] == -1) {
+        char name[32];
+        snprintf(name, sizeof(name), "ttkmd-sim-%u-%u", x, y);
+
+        int fd = memfd_create(name, MFD_CLOEXEC);
+        if (fd == -1) {
+            ret = -errno;
+        } else if (ftruncate(fd, SIM_TILE_SPAN) != 0) {
+            ret = -errno;
+        } else {
+            ret = init_tile(sim, fd, x, y);
+        }
+
+        if (ret == 0) {
+            sim->tile_fd[x][y] = fd;
+        } else if (fd != -1) {
+            close(fd);
+        }
+    }
+
+    *out_fd = sim->tile_fd[x][y];
+
+    pthread_mutex_unlock(&sim->lock);
+
+    return ret;
+}
+
+static int sim_tlb_alloc(void* ctx, size_t size, enum tt_tlb_cache_mode cache, uint32_t* out_id, void** out_mmio)
+{
+    struct sim_device* sim = ctx;
+    uint64_t limit = tt_arch_tlb_count(sim->arch, size);
+    uint64_t used = 0;
+    size_t slot = sim->num_tlbs;
+    int ret = 0;
+
+    (void)cache;
+
+    if (limit == 0) {
+        return -EINVAL;
+    }
+
+    /* Unconfigured windows read as zero until they're first pointed somewhere. */
+    void* mmio = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mmio == MAP_FAILED) {
+        return -errno;
+    }
+
+    pthread_mutex_lock(&sim->lock);
+
+    for (size_t i = 0; i < sim->num_tlbs; ++i) {
+        if (sim->tlbs[i].size == size) {
+            used++;
+        } else if (sim->tlbs[i].size == 0 && slot == sim->num_tlbs) {
+            slot = i;
+        }
+    }
+
+    if (used >= limit || slot == sim->num_tlbs) {
+        ret = -ENOSPC;
+    } else {
+        sim->tlbs[slot].size = size;
+        sim->tlbs[slot].mmio = mmio;
+    }
+
+    pthread_mutex_unlock(&sim->lock);
+
+    if (ret != 0) {
+        munmap(mmio, size);
+        return ret;
+    }
+
+    *out_id = slot;
+    *out_mmio = mmio;
+
+    return 0;
+}
+
+static int sim_tlb_free(void* ctx, uint32_t id, void* mmio, size_t size)
+{
+    struct sim_device* sim = ctx;
+
+    if (id >= sim->num_tlbs || sim->tlbs[id].mmio != mmio) {
+        return -EINVAL;
+    }
+
+    munmap(mmio, size);
+
+    pthread_mutex_lock(&sim->lock);
+    sim->tlbs[id].size = 0;
+    sim->tlbs[id].mmio = NULL;
+    pthread_mutex_unlock(&sim->lock);
+
+    return 0;
+}
+
+static int sim_tlb_configure(void* ctx, uint32_t id, const tt_noc_addr_config_t* config)
+{
+    struct sim_device* sim = ctx;
+    uint32_t x = config->mcast ? config->x_start : config->x_end;
+    uint32_t y = config->mcast ? config->y_start : config->y_end;
+    int fd;
+    int ret;
+
+    if (id >= sim->num_tlbs || sim->tlbs[id].size == 0) {
+        return -EINVAL;
+    }
+
+    struct sim_tlb* tlb = &sim->tlbs[id];
+
+    if (x >= SIM_GRID_MAX_X || y >= SIM_GRID_MAX_Y || config->addr + tlb->size > SIM_TILE_SPAN) {
+        return -EINVAL;
+    }
+
+    if ((ret = get_tile_fd(sim, x, y, &fd)) != 0) {
+        return ret;
+    }
+
+    void* mmio = mmap(tlb->mmio, tlb->size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, config->addr);
+    if (mmio == MAP_FAILED) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+/*
+ * Place `len` bytes in the aperture: the lowest free range, or the highest for
+ * top-down requests.  Caller holds sim->lock.
+ */
+static int aperture_place(struct sim_device* sim, size_t len, int top_down, uint64_t* out_offset)
+{
+    uint64_t best = ~0ULL;
+    size_t mappings = 0;
+
+    for (struct sim_pin* p = sim->pins; p; p = p->next) {
+        mappings += p->noc;
+    }
+
+    if (mappings >= APERTURE_MAX_MAPPINGS || len > sim->aperture_size) {
+        return -ENOSPC;
+    }
+
+    /* Candidates are the aperture's ends and the edges of every mapping. */
+    uint64_t candidates[2 * APERTURE_MAX_MAPPINGS + 2];
+    size_t n = 0;
+
+    candidates[n++] = 0;
+    candidates[n++] = sim->aperture_size - len;
+    for (struct sim_pin* p = sim->pins; p; p = p->next) {
+        if (p->noc) {
+            candidates[n++] = p->noc_offset + p->len;
+            if (p->noc_offset >= len) {
+                candidates[n++] = p->noc_offset - len;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t start = candidates[i];
+        int fits = start + len <= sim->aperture_size;
+
+        for (struct sim_pin* p = sim->pins; p && fits; p = p->next) {
+            if (p->noc && start < p->noc_offset + p->len && p->noc_offset < start + len) {
+                fits = 0;
+            }
+        }
+
+        if (fits && (best == ~0ULL || (top_down ? start > best : start < best))) {
+            best = start;
+        }
+    }
+
+    if (best == ~0ULL) {
+        return -ENOSPC;
+    }
+
+    *out_offset = best;
+    return 0;
+}
+
+static int sim_pin_pages(void* ctx, void* addr, size_t len, uint32_t flags, uint64_t* out_iova, uint64_t* out_noc)
+{
+    struct sim_device* sim = ctx;
+    int noc = (flags & (TENSTORRENT_PIN_PAGES_NOC_DMA | TENSTORRENT_PIN_PAGES_NOC_TOP_DOWN)) != 0;
+    int ret = 0;
+
+    if (((uintptr_t)addr | len) & (sysconf(_SC_PAGESIZE) - 1)) {
+        return -EINVAL;
+    }
+
+    struct sim_pin* pin = calloc(1, sizeof(struct sim_pin));
+    if (!pin) {
+        return -ENOMEM;
+    }
+
+    pin->addr = (uint64_t)addr;
+    pin->len = len;
+    pin->noc = noc;
+
+    pthread_mutex_lock(&sim->lock);
+    if (noc) {
+        ret = aperture_place(sim, len, flags & TENSTORRENT_PIN_PAGES_NOC_TOP_DOWN, &pin->noc_offset);
+    }
+    if (ret == 0) {
+        pin->next = sim->pins;
+        sim->pins = pin;
+    }
+    pthread_mutex_unlock(&sim->lock);
+
+    if (ret != 0) {
+        free(pin);
+        return ret;
+    }
+
+    *out_iova = (uint64_t)addr;
+    *out_noc = noc ? sim->pcie_noc_base + pin->noc_offset : 0;
+
+    return 0;
+}
+
+static int sim_unpin_pages(void* ctx, void* addr, size_t len)
+{
+    struct sim_device* sim = ctx;
+    struct sim_pin* found = NULL;
+
+    pthread_mutex_lock(&sim->lock);
+    for (struct sim_pin** link = &sim->pins; *link; link = &(*link)->next) {
+        if ((*link)->addr == (uint64_t)addr && (*link)->len == len) {
+            found = *link;
+            *link = found->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim->lock);
+
+    if (!found) {
+        return -EINVAL;
+    }
+
+    free(found);
+    return 0;
+}
+
+/* Driver-allocated buffers are ordinary memory, pinned as if by the caller. */
+static int sim_dma_alloc(void* ctx, size_t len, uint32_t flags, void** out_mem, uint64_t* out_iova,
+                         uint64_t* out_noc)
+{
+    uint32_t pin_flags = (flags & TENSTORRENT_ALLOCATE_DMA_BUF_NOC_DMA) ? TENSTORRENT_PIN_PAGES_NOC_DMA : 0;
+    void* mem = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (mem == MAP_FAILED) {
+        return -errno;
+    }
+
+    int ret = sim_pin_pages(ctx, mem, len, pin_flags, out_iova, out_noc);
+    if (ret != 0) {
+        munmap(mem, len);
+        return ret;
+    }
+
+    *out_mem = mem;
+
+    return 0;
+}
+
+static int sim_dma_free(void* ctx, void* mem, size_t len)
+{
+    int ret = sim_unpin_pages(ctx, mem, len);
+    if (ret != 0) {
+        return ret;
+    }
+
+    munmap(mem, len);
+
+    return 0;
+}
+
+const struct tt_backend_ops tt_sim_backend = {
+    .name = "sim",
+    .open = sim_open,
+    .close = sim_close,
+    .get_device_info = sim_get_device_info,
+    .get_driver_info = sim_get_driver_info,
+    .tlb_alloc = sim_tlb_alloc,
+    .tlb_free = sim_tlb_free,
+    .tlb_configure = sim_tlb_configure,
+    .pin_pages = sim_pin_pages,
+    .unpin_pages = sim_unpin_pages,
+    .dma_alloc = sim_dma_alloc,
+    .dma_free = sim_dma_free,
+};
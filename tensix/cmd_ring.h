@@ -0,0 +1,111 @@
+// Consumer side of a command ring (tt::CommandRing in include/holething.hpp)
+//
+// A persistent kernel's work queue: one producer (the host), one consumer
+// (this core).  Commands are 64-byte slots in pinned host memory, after a
+// cache line holding the head word:
+//
+//   ring + 0x00   head: commands retired, written here by cmd_ring_retire()
+//   ring + 0x40   slot 0, slot 1, ... slot entries-1
+//
+// The host bumps DOORBELL in the L1 mailbox (a posted write) after filling
+// slots.  cmd_ring_fetch() pulls what's new over the NOC in one read, and
+// cmd_ring_retire() posts the new head back, so neither side reads the
+// other's memory across PCIe while it waits.
+//
+// The mailbox is laid out like the copy engine's, and the host fills it in
+// before taking the core out of reset.
+
+#ifndef TENSIX_CMD_RING_H
+#define TENSIX_CMD_RING_H
+
+#include <stdint.h>
+
+#include "noc.h"
+
+// Mailbox, relative to its L1 address
+#define CMD_RING_STATUS         0x00
+#define CMD_RING_DOORBELL       0x04    // Commands submitted (host writes)
+#define CMD_RING_HEAD           0x08    // Commands retired
+#define CMD_RING_LO             0x0C    // Ring NOC address
+#define CMD_RING_MID            0x10
+#define CMD_RING_XY             0x14
+#define CMD_RING_ENTRIES        0x18    // Power of two
+
+#define CMD_RING_STATUS_READY   0x5E1FC0DE
+
+#define CMD_RING_HEADER_SIZE    64
+#define CMD_RING_ARGS           14
+
+// One slot; must match CommandRing::Command.  The host writes seq last.
+struct cmd_ring_cmd {
+    uint32_t opcode;
+    uint32_t seq;
+    uint32_t args[CMD_RING_ARGS];
+};
+
+struct cmd_ring {
+    uint32_t mailbox;
+    uint64_t ring;
+    uint32_t ring_xy;
+    uint32_t entries;
+    uint32_t head;
+    volatile struct cmd_ring_cmd* cmds;     // Fetched commands, in L1
+    uint32_t tid;
+};
+
+static inline uint32_t cmd_ring_mailbox_read(const struct cmd_ring* r, uint32_t off)
+{
+    return *(volatile uint32_t*)(r->mailbox + off);
+}
+
+// Read the mailbox and tell the host we're running.  Fetched commands go to
+// l1_cmds; ring traffic uses transaction ID tid.
+static inline void cmd_ring_init(struct cmd_ring* r, uint32_t mailbox, uint32_t l1_cmds, uint32_t tid)
+{
+    r->mailbox = mailbox;
+    r->ring = ((uint64_t)cmd_ring_mailbox_read(r, CMD_RING_MID) << 32) | cmd_ring_mailbox_read(r, CMD_RING_LO);
+    r->ring_xy = cmd_ring_mailbox_read(r, CMD_RING_XY);
+    r->entries = cmd_ring_mailbox_read(r, CMD_RING_ENTRIES);
+    r->head = cmd_ring_mailbox_read(r, CMD_RING_HEAD);
+    r->cmds = (volatile struct cmd_ring_cmd*)l1_cmds;
+    r->tid = tid;
+
+    noc_l1_write32(mailbox + CMD_RING_STATUS, CMD_RING_STATUS_READY);
+}
+
+// Fetch up to max new commands into r->cmds; returns how many, 0 if there are
+// none.  Stops at the end of the ring and at any slot whose seq shows the
+// host's write hasn't landed yet; those are fetched again next time.
+static inline uint32_t cmd_ring_fetch(struct cmd_ring* r, uint32_t max)
+{
+    uint32_t tail = cmd_ring_mailbox_read(r, CMD_RING_DOORBELL);
+    uint32_t slot = r->head & (r->entries - 1);
+    uint32_t count = tail - r->head;
+
+    if (count == 0) {
+        return 0;
+    }
+    if (count > r->entries - slot) count = r->entries - slot;
+    if (count > max) count = max;
+
+    noc_async_read(0, r->ring + CMD_RING_HEADER_SIZE + slot * sizeof(struct cmd_ring_cmd), r->ring_xy,
+                   (uint32_t)r->cmds, count * sizeof(struct cmd_ring_cmd), r->tid);
+    noc_wait_tid(0, r->tid);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (r->cmds[i].seq != r->head + i) {
+            return i;
+        }
+    }
+    return count;
+}
+
+// The first count fetched commands are done; post the new head to the host.
+// Their NOC writes must have been acknowledged first, or be on r->tid.
+static inline void cmd_ring_retire(struct cmd_ring* r, uint32_t count)
+{
+    r->head += count;
+    noc_post_completion(0, r->mailbox + CMD_RING_HEAD, r->head, r->ring, r->ring_xy, r->tid);
+}
+
+#endif
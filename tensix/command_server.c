@@ -0,0 +1,100 @@
+// Command server: a persistent kernel fed by a command ring
+// Used by tt::CommandServer in include/holething.hpp
+//
+// Loaded once.  After that the host queues commands in a ring in pinned host
+// memory (tensix/cmd_ring.h) rather than resetting the core and writing a new
+// set of parameters into L1 for every job, as the iterNN programs do.
+//
+// Commands (opcodes must match CommandServer):
+//   CMD_NOP       -                                      nothing; ring overhead
+//   CMD_STORE32   addr, value                            store to local L1
+//   CMD_COPY      src lo, mid, xy, dst lo, mid, xy, size NOC copy through L1
+//
+// Unknown opcodes are skipped.
+
+#include <stdint.h>
+
+#include "noc.h"
+#include "cmd_ring.h"
+
+#define MAILBOX          0x10000
+
+#define CMD_NOP          0
+#define CMD_STORE32      1
+#define CMD_COPY         2
+
+// Commands are fetched in batches of up to this many
+#define CMD_BATCH        16
+#define L1_CMD_BASE      0x11000
+
+// L1 staging buffer for CMD_COPY
+#define L1_STAGING_BASE  0x20000
+#define L1_STAGING_SIZE  (512 * 1024)
+
+#define TID_READ         0
+#define TID_WRITE        1
+#define TID_RING         15
+
+void _start(void) __attribute__((section(".start"), naked));
+void main(void) __attribute__((noreturn));
+
+static void copy(uint64_t src, uint32_t src_xy, uint64_t dst, uint32_t dst_xy, uint32_t size)
+{
+    while (size > 0) {
+        uint32_t n = (size > L1_STAGING_SIZE) ? L1_STAGING_SIZE : size;
+
+        noc_async_read(0, src, src_xy, L1_STAGING_BASE, n, TID_READ);
+        noc_wait_tid(0, TID_READ);
+        noc_async_write(0, L1_STAGING_BASE, dst, dst_xy, n, TID_WRITE);
+        noc_wait_tid(0, TID_WRITE);
+
+        src += n;
+        dst += n;
+        size -= n;
+    }
+}
+
+static void run(volatile struct cmd_ring_cmd* cmd)
+{
+    switch (cmd->opcode) {
+    case CMD_STORE32:
+        noc_l1_write32(cmd->args[0], cmd->args[1]);
+        break;
+    case CMD_COPY:
+        copy(((uint64_t)cmd->args[1] << 32) | cmd->args[0], cmd->args[2],
+             ((uint64_t)cmd->args[4] << 32) | cmd->args[3], cmd->args[5], cmd->args[6]);
+        break;
+    case CMD_NOP:
+    default:
+        break;
+    }
+}
+
+void _start(void)
+{
+    __asm__ volatile (
+        "lui sp, 0x180\n"
+        "j main\n"
+        : : : "sp"
+    );
+    __builtin_unreachable();
+}
+
+void main(void)
+{
+    struct cmd_ring ring;
+
+    cmd_ring_init(&ring, MAILBOX, L1_CMD_BASE, TID_RING);
+
+    for (;;) {
+        uint32_t count = cmd_ring_fetch(&ring, CMD_BATCH);
+        if (count == 0) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            run(&ring.cmds[i]);
+        }
+        cmd_ring_retire(&ring, count);
+    }
+}
@@ -0,0 +1,193 @@
+// Copy engine: resident firmware that copies between NOC endpoints on request
+// Used by tt::CopyEngine, e.g. for Device::dma_read() and Device::dma_write()
+//
+// Work arrives as descriptors in a ring in pinned host memory.  The host
+// writes descriptors, then bumps RING_TAIL here in L1 (a posted write).  The
+// core fetches new descriptors over PCIe, copies each one through an L1
+// staging buffer and, once the data has landed, writes the number of finished
+// descriptors to the host's completion word.  The host never has to read MMIO
+// to submit or wait, and the core keeps going for as long as there is work.
+//
+// Copies are pipelined through STAGING_SLOTS slots of L1.  Every slot has its
+// own read and write transaction IDs, so the core only waits for the one slot
+// it needs next: while chunk i is written out, chunks i+1 onwards are being
+// read in.  mcycle is sampled around each descriptor, and the totals are left
+// in the mailbox for the host to turn into cycles/byte.
+
+#include <stdint.h>
+
+#include "noc.h"
+
+// Mailbox (must match CopyEngine in include/holething.hpp)
+#define CE_MAILBOX        0x10000
+#define CE_STATUS         (CE_MAILBOX + 0x00)
+#define CE_RING_TAIL      (CE_MAILBOX + 0x04)   // Descriptors submitted (host writes)
+#define CE_RING_HEAD      (CE_MAILBOX + 0x08)   // Descriptors finished
+#define CE_RING_LO        (CE_MAILBOX + 0x0C)   // Ring NOC address
+#define CE_RING_MID       (CE_MAILBOX + 0x10)
+#define CE_RING_XY        (CE_MAILBOX + 0x14)
+#define CE_RING_ENTRIES   (CE_MAILBOX + 0x18)   // Power of two
+#define CE_COMPLETION_LO  (CE_MAILBOX + 0x1C)   // Where RING_HEAD is mirrored
+#define CE_COMPLETION_MID (CE_MAILBOX + 0x20)
+#define CE_COMPLETION_XY  (CE_MAILBOX + 0x24)
+#define CE_CYCLES_LO      (CE_MAILBOX + 0x28)   // mcycle spent copying
+#define CE_CYCLES_HI      (CE_MAILBOX + 0x2C)
+#define CE_BYTES_LO       (CE_MAILBOX + 0x30)   // Bytes copied
+#define CE_BYTES_HI       (CE_MAILBOX + 0x34)
+
+#define CE_STATUS_READY   0xC0B1E5ED
+
+// Descriptor, 32 bytes
+struct copy_desc {
+    uint32_t src_lo;
+    uint32_t src_mid;
+    uint32_t src_xy;
+    uint32_t dst_lo;
+    uint32_t dst_mid;
+    uint32_t dst_xy;
+    uint32_t size;
+    uint32_t reserved;
+};
+
+// Descriptors are fetched in batches of up to this many
+#define DESC_BATCH       16
+#define L1_DESC_BASE     0x11000
+
+// L1 staging buffer, split into slots
+#define L1_STAGING_BASE  0x20000
+#define L1_STAGING_SIZE  (512 * 1024)
+#define STAGING_SLOTS    4
+#define SLOT_SIZE        (L1_STAGING_SIZE / STAGING_SLOTS)
+
+// Transaction IDs: reads into slot n use n, writes out of it STAGING_SLOTS + n
+#define TID_READ(slot)   (slot)
+#define TID_WRITE(slot)  (STAGING_SLOTS + (slot))
+#define TID_MISC         15
+
+void _start(void) __attribute__((section(".start"), naked));
+void main(void) __attribute__((noreturn));
+
+static inline uint32_t reg_read(uint32_t addr)
+{
+    return *(volatile uint32_t*)addr;
+}
+
+static inline void reg_write(uint32_t addr, uint32_t value)
+{
+    *(volatile uint32_t*)addr = value;
+}
+
+static inline uint64_t read_mcycle(void)
+{
+    uint32_t hi, lo, hi2;
+    do {
+        __asm__ volatile ("csrr %0, mcycleh" : "=r"(hi));
+        __asm__ volatile ("csrr %0, mcycle" : "=r"(lo));
+        __asm__ volatile ("csrr %0, mcycleh" : "=r"(hi2));
+    } while (hi != hi2);
+    return ((uint64_t)hi << 32) | lo;
+}
+
+// Copy size bytes from src to dst through the staging slots.
+static void copy(uint64_t src, uint32_t src_xy, uint64_t dst, uint32_t dst_xy, uint32_t size)
+{
+    uint32_t chunks = (size + SLOT_SIZE - 1) / SLOT_SIZE;
+
+    // Fill the pipeline.
+    for (uint32_t i = 0; i < chunks && i < STAGING_SLOTS; i++) {
+        uint32_t offset = i * SLOT_SIZE;
+        uint32_t n = (size - offset > SLOT_SIZE) ? SLOT_SIZE : size - offset;
+        noc_async_read(0, src + offset, src_xy, L1_STAGING_BASE + i * SLOT_SIZE, n, TID_READ(i));
+    }
+
+    for (uint32_t i = 0; i < chunks; i++) {
+        uint32_t slot = i % STAGING_SLOTS;
+        uint32_t offset = i * SLOT_SIZE;
+        uint32_t n = (size - offset > SLOT_SIZE) ? SLOT_SIZE : size - offset;
+
+        noc_wait_tid(0, TID_READ(slot));
+        noc_async_write(0, L1_STAGING_BASE + slot * SLOT_SIZE, dst + offset, dst_xy, n, TID_WRITE(slot));
+
+        // Refill the slot written out last time around; its write has had a
+        // whole chunk to drain, and the one just issued keeps the NOC busy.
+        if (i == 0 || i - 1 + STAGING_SLOTS >= chunks) {
+            continue;
+        }
+        uint32_t prev = (i - 1) % STAGING_SLOTS;
+        uint32_t next = (i - 1 + STAGING_SLOTS) * SLOT_SIZE;
+        uint32_t m = (size - next > SLOT_SIZE) ? SLOT_SIZE : size - next;
+
+        noc_wait_tid(0, TID_WRITE(prev));
+        noc_async_read(0, src + next, src_xy, L1_STAGING_BASE + prev * SLOT_SIZE, m, TID_READ(prev));
+    }
+
+    for (uint32_t slot = 0; slot < STAGING_SLOTS; slot++) {
+        noc_wait_tid(0, TID_WRITE(slot));
+    }
+}
+
+void _start(void)
+{
+    __asm__ volatile (
+        "lui sp, 0x180\n"
+        "j main\n"
+        : : : "sp"
+    );
+    __builtin_unreachable();
+}
+
+void main(void)
+{
+    uint64_t ring = ((uint64_t)reg_read(CE_RING_MID) << 32) | reg_read(CE_RING_LO);
+    uint32_t ring_xy = reg_read(CE_RING_XY);
+    uint32_t entries = reg_read(CE_RING_ENTRIES);
+    uint64_t completion = ((uint64_t)reg_read(CE_COMPLETION_MID) << 32) | reg_read(CE_COMPLETION_LO);
+    uint32_t completion_xy = reg_read(CE_COMPLETION_XY);
+    volatile struct copy_desc* descs = (volatile struct copy_desc*)L1_DESC_BASE;
+    uint32_t head = reg_read(CE_RING_HEAD);
+    uint64_t cycles = 0;
+    uint64_t bytes = 0;
+
+    reg_write(CE_CYCLES_LO, 0);
+    reg_write(CE_CYCLES_HI, 0);
+    reg_write(CE_BYTES_LO, 0);
+    reg_write(CE_BYTES_HI, 0);
+    reg_write(CE_STATUS, CE_STATUS_READY);
+    __asm__ volatile ("fence" ::: "memory");
+
+    for (;;) {
+        uint32_t tail = reg_read(CE_RING_TAIL);
+        if (tail == head) {
+            continue;
+        }
+
+        // Fetch what's there, up to the end of the ring.
+        uint32_t slot = head & (entries - 1);
+        uint32_t count = tail - head;
+        if (count > entries - slot) count = entries - slot;
+        if (count > DESC_BATCH) count = DESC_BATCH;
+
+        noc_async_read(0, ring + slot * sizeof(struct copy_desc), ring_xy, L1_DESC_BASE,
+                       count * sizeof(struct copy_desc), TID_MISC);
+        noc_wait_tid(0, TID_MISC);
+
+        uint64_t start = read_mcycle();
+        for (uint32_t i = 0; i < count; i++) {
+            uint64_t src = ((uint64_t)descs[i].src_mid << 32) | descs[i].src_lo;
+            uint64_t dst = ((uint64_t)descs[i].dst_mid << 32) | descs[i].dst_lo;
+
+            copy(src, descs[i].src_xy, dst, descs[i].dst_xy, descs[i].size);
+            bytes += descs[i].size;
+        }
+        cycles += read_mcycle() - start;
+
+        reg_write(CE_CYCLES_LO, (uint32_t)cycles);
+        reg_write(CE_CYCLES_HI, (uint32_t)(cycles >> 32));
+        reg_write(CE_BYTES_LO, (uint32_t)bytes);
+        reg_write(CE_BYTES_HI, (uint32_t)(bytes >> 32));
+
+        // copy() waited for the data writes, so this lands after them.
+        head += count;
+        noc_post_completion(0, CE_RING_HEAD, head, completion, completion_xy, TID_MISC);
+    }
+}
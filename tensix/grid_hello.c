@@ -0,0 +1,30 @@
+// Grid hello: the smallest kernel for tt::Device::launch()
+//
+// Every core reports its first argument plus its own NOC coordinate
+// ((y << 6) | x), so the host can tell that each core ran, with its own
+// arguments.
+
+#include <stdint.h>
+
+#include "noc.h"
+#include "kernel.h"
+
+void _start(void) __attribute__((section(".start"), naked));
+void main(void) __attribute__((noreturn));
+
+void _start(void)
+{
+    __asm__ volatile (
+        "lui sp, 0x180\n"
+        "j main\n"
+        : : : "sp"
+    );
+    __builtin_unreachable();
+}
+
+void main(void)
+{
+    kernel_done(kernel_arg(0) + noc_local_xy(0), 0);
+
+    while (1);
+}
@@ -3,21 +3,24 @@
 
 #include <stdint.h>
 
-// Memory layout
-#define SRC_BUF_ADDR_LO   0x1000
-#define SRC_BUF_ADDR_MID  0x1004
-#define SRC_BUF_ADDR_HI   0x1008
-#define DST_BUF_ADDR_LO   0x100C
-#define DST_BUF_ADDR_MID  0x1010
-#define DST_BUF_ADDR_HI   0x1014
-#define TRANSFER_SIZE     0x1018
-#define READY_ADDR        0x101C
-#define DEBUG_SRC_LO      0x1020
-#define DEBUG_SRC_MID     0x1024
-#define DEBUG_DST_LO      0x1028
-#define DEBUG_DST_MID     0x102C
-#define DEBUG_NODE_ID     0x1030
-#define DEBUG_LOCAL_COORD 0x1034
+// Parameters and status.  These are ordinary (.bss) variables rather than
+// fixed L1 addresses; src/iter05.cpp finds them by name in iter05.elf.
+volatile uint32_t src_buf_addr_lo;
+volatile uint32_t src_buf_addr_mid;
+volatile uint32_t src_buf_addr_hi;
+volatile uint32_t dst_buf_addr_lo;
+volatile uint32_t dst_buf_addr_mid;
+volatile uint32_t dst_buf_addr_hi;
+volatile uint32_t transfer_size;
+volatile uint32_t ready;
+volatile uint32_t debug_src_lo;
+volatile uint32_t debug_src_mid;
+volatile uint32_t debug_dst_mid;
+volatile uint32_t debug_node_id;
+volatile uint32_t debug_local_coord;
+volatile uint32_t completion_lo;    // Host word ready is mirrored to
+volatile uint32_t completion_mid;
+volatile uint32_t completion_hi;    // 0: don't mirror
 
 // L1 staging buffer
 #define L1_STAGING_BASE  0x20000   // Start at 128KB to avoid conflicts
@@ -167,16 +170,7 @@ void _start(void)
 
 void main(void)
 {
-    volatile uint32_t* src_addr_lo = (volatile uint32_t*)SRC_BUF_ADDR_LO;
-    volatile uint32_t* src_addr_mid = (volatile uint32_t*)SRC_BUF_ADDR_MID;
-    volatile uint32_t* src_addr_hi = (volatile uint32_t*)SRC_BUF_ADDR_HI;
-    volatile uint32_t* dst_addr_lo = (volatile uint32_t*)DST_BUF_ADDR_LO;
-    volatile uint32_t* dst_addr_mid = (volatile uint32_t*)DST_BUF_ADDR_MID;
-    volatile uint32_t* dst_addr_hi = (volatile uint32_t*)DST_BUF_ADDR_HI;
-    volatile uint32_t* xfer_size = (volatile uint32_t*)TRANSFER_SIZE;
-    volatile uint32_t* ready = (volatile uint32_t*)READY_ADDR;
-
-    *ready = 0xAAAAAAAA;
+    ready = 0xAAAAAAAA;
     __asm__ volatile ("fence" ::: "memory");
 
     // Get local coordinates
@@ -187,34 +181,26 @@ void main(void)
     uint32_t local_coord = (local_y << 6) | local_x;
 
     // Read parameters
-    uint64_t src_buf = ((uint64_t)*src_addr_mid << 32) | *src_addr_lo;
-    uint32_t src_x = *src_addr_hi & 0x3F;
-    uint32_t src_y = (*src_addr_hi >> 6) & 0x3F;
+    uint64_t src_buf = ((uint64_t)src_buf_addr_mid << 32) | src_buf_addr_lo;
+    uint32_t src_x = src_buf_addr_hi & 0x3F;
+    uint32_t src_y = (src_buf_addr_hi >> 6) & 0x3F;
 
-    uint64_t dst_buf = ((uint64_t)*dst_addr_mid << 32) | *dst_addr_lo;
-    uint32_t dst_x = *dst_addr_hi & 0x3F;
-    uint32_t dst_y = (*dst_addr_hi >> 6) & 0x3F;
+    uint64_t dst_buf = ((uint64_t)dst_buf_addr_mid << 32) | dst_buf_addr_lo;
+    uint32_t dst_x = dst_buf_addr_hi & 0x3F;
+    uint32_t dst_y = (dst_buf_addr_hi >> 6) & 0x3F;
 
-    uint32_t total_size = *xfer_size;
-
-    // Debug: write addresses for host to inspect
-    volatile uint32_t* debug_src_lo = (volatile uint32_t*)DEBUG_SRC_LO;
-    volatile uint32_t* debug_src_mid = (volatile uint32_t*)DEBUG_SRC_MID;
-    volatile uint32_t* debug_dst_lo = (volatile uint32_t*)DEBUG_DST_LO;
-    volatile uint32_t* debug_dst_mid = (volatile uint32_t*)DEBUG_DST_MID;
-    volatile uint32_t* debug_node_id = (volatile uint32_t*)DEBUG_NODE_ID;
-    volatile uint32_t* debug_local_coord = (volatile uint32_t*)DEBUG_LOCAL_COORD;
+    uint32_t total_size = transfer_size;
 
     // Debug: write node_id and local_coord to dedicated locations
-    *debug_node_id = node_id;
-    *debug_local_coord = local_coord;
+    debug_node_id = node_id;
+    debug_local_coord = local_coord;
     __asm__ volatile ("fence" ::: "memory");
 
     // Debug: write total_size
-    *debug_src_lo = total_size;
+    debug_src_lo = total_size;
     __asm__ volatile ("fence" ::: "memory");
 
-    *ready = 0x11111111;  // Phase 1
+    ready = 0x11111111;  // Phase 1
     __asm__ volatile ("fence" ::: "memory");
 
     // Phase 1: PCIe -> L1 -> GDDR (in chunks)
@@ -227,7 +213,7 @@ void main(void)
 
         // Debug: save first read address for inspection
         if (num_chunks == 1) {
-            *debug_dst_mid = (uint32_t)((src_buf + transferred) >> 32);
+            debug_dst_mid = (uint32_t)((src_buf + transferred) >> 32);
         }
 
         // Read from PCIe to L1
@@ -244,10 +230,10 @@ void main(void)
     }
 
     // Debug: write number of chunks done in phase 1
-    *debug_src_mid = num_chunks;
+    debug_src_mid = num_chunks;
     noc_wait_reads_flushed();
 
-    *ready = 0x22222222;  // Phase 2
+    ready = 0x22222222;  // Phase 2
     __asm__ volatile ("fence" ::: "memory");
 
     // Phase 2: GDDR -> L1 -> PCIe (in chunks)
@@ -273,11 +259,21 @@ void main(void)
 
     noc_wait_reads_flushed();
     // Debug: write number of chunks done in phase 2
-    *debug_dst_mid = num_chunks;
+    debug_dst_mid = num_chunks;
 
-    *ready = 0xC0DEC0DE;
+    ready = 0xC0DEC0DE;
     __asm__ volatile ("fence" ::: "memory");
 
+    // Tell the host, which waits on its completion word rather than polling.
+    if (completion_hi) {
+        uint64_t completion = ((uint64_t)completion_mid << 32) | completion_lo;
+
+        noc_write((uint32_t)&ready, completion, completion_hi & 0x3F, (completion_hi >> 6) & 0x3F,
+                  sizeof(uint32_t), local_coord);
+        noc_wait_ready();
+        noc_wait_reads_flushed();
+    }
+
     while (1);
 }
 
@@ -0,0 +1,43 @@
+// Launch ABI for kernels started with tt::Device::launch()
+//
+// The host loads the same program on every core, then writes each core an
+// argument block at KERNEL_ARGS: a header saying where to report, followed by
+// the caller's arguments.  When a core is finished it calls kernel_done(),
+// which writes its result to a word in host memory, one word per NOC
+// coordinate, so the host waits without polling every core over MMIO.
+// Cores that share their arguments share the block, so the host can
+// multicast it.
+
+#ifndef TENSIX_KERNEL_H
+#define TENSIX_KERNEL_H
+
+#include <stdint.h>
+
+#include "noc.h"
+
+// Must match tt::Kernel in include/holething.hpp
+#define KERNEL_ARGS         0xF000
+#define KERNEL_DONE_LO      (KERNEL_ARGS + 0x00)    // Host result array
+#define KERNEL_DONE_MID     (KERNEL_ARGS + 0x04)
+#define KERNEL_DONE_XY      (KERNEL_ARGS + 0x08)
+#define KERNEL_SCRATCH      (KERNEL_ARGS + 0x0C)    // For kernel_done()
+#define KERNEL_USER_ARGS    (KERNEL_ARGS + 0x10)
+#define KERNEL_MAX_ARGS     1020
+
+static inline uint32_t kernel_arg(uint32_t i)
+{
+    return *(volatile uint32_t*)(KERNEL_USER_ARGS + i * 4);
+}
+
+// Tell the host this core is finished; result must be nonzero.  Writes issued
+// before this on tid have landed by the time the host sees it.
+static inline void kernel_done(uint32_t result, uint32_t tid)
+{
+    uint64_t done = ((uint64_t)*(volatile uint32_t*)KERNEL_DONE_MID << 32) | *(volatile uint32_t*)KERNEL_DONE_LO;
+    uint32_t done_xy = *(volatile uint32_t*)KERNEL_DONE_XY;
+
+    noc_post_completion(0, KERNEL_SCRATCH, result, done + noc_local_xy(0) * 4, done_xy, tid);
+    noc_wait_tid(0, tid);
+}
+
+#endif
@@ -0,0 +1,265 @@
+// NOC access for Tensix firmware (Blackhole register layout)
+//
+// Start new kernels from here rather than from the iterNN programs, which
+// each carry their own copy of the registers and wait on NOC_CMD_CTRL before
+// every command.  Here:
+//
+//   - Each NOC has NOC_NUM_CMD_BUFS command buffers.  noc_async_read() and
+//     noc_async_write() put each transaction on the next free one, and only
+//     spin if all of them are busy.
+//   - Transactions carry a transaction ID (0-15).  The NIU counts outstanding
+//     requests per ID, so noc_wait_tid() waits for one stream of work without
+//     draining the others.
+//   - Both NOCs: every call takes the NOC index, 0 or 1.
+//   - The *_batch() helpers issue a list of transfers back to back.
+//   - noc_post_completion() is the completion protocol: a status or sequence
+//     word written to host memory (a tt::Completion) after the work it covers,
+//     so the host never polls MMIO.
+//
+// Building with -DNOC_MOCK routes register accesses through
+// noc_mock_read()/noc_mock_write(), which the host test (noc_test.c)
+// provides, so the library can be tested without a device.
+
+#ifndef TENSIX_NOC_H
+#define TENSIX_NOC_H
+
+#include <stdint.h>
+
+#define NOC_BASE(noc)           (0xFFB20000 + (noc) * 0x10000)
+#define NOC_CMD_BUF_STRIDE      0x800
+#define NOC_NUM_CMD_BUFS        4
+#define NOC_NUM_TIDS            16
+#define NOC_MAX_TRANS_SIZE      16384
+
+// Per command buffer
+#define NOC_REG(noc, buf, off)  (NOC_BASE(noc) + (buf) * NOC_CMD_BUF_STRIDE + (off))
+#define NOC_TARG_ADDR_LO        0x00
+#define NOC_TARG_ADDR_MID       0x04
+#define NOC_TARG_ADDR_HI        0x08
+#define NOC_RET_ADDR_LO         0x0C
+#define NOC_RET_ADDR_MID        0x10
+#define NOC_RET_ADDR_HI         0x14
+#define NOC_PACKET_TAG          0x18
+#define NOC_CTRL                0x1C
+#define NOC_AT_LEN_BE           0x20
+#define NOC_AT_LEN_BE_1         0x24
+#define NOC_BRCST_EXCLUDE       0x2C
+#define NOC_CMD_CTRL            0x40
+#define NOC_NODE_ID             0x44
+
+// Per NOC
+#define NOC_STATUS(noc, n)      (NOC_BASE(noc) + 0x200 + (n) * 4)
+#define NIU_MST_REQS_OUTSTANDING_ID(id) (0x10 + (id))
+
+#define NOC_CMD_RD              0x0
+#define NOC_CMD_WR              0x2
+#define NOC_CMD_RESP_MARKED     (1 << 4)
+
+#define NOC_PACKET_TAG_TRANSACTION_ID(id) ((id) << 10)
+
+#define NOC_XY(x, y)            ((((y) & 0x3F) << 6) | ((x) & 0x3F))
+
+#ifdef NOC_MOCK
+uint32_t noc_mock_read(uint32_t addr);
+void noc_mock_write(uint32_t addr, uint32_t value);
+
+static inline uint32_t noc_reg_read(uint32_t addr)
+{
+    return noc_mock_read(addr);
+}
+
+static inline void noc_reg_write(uint32_t addr, uint32_t value)
+{
+    noc_mock_write(addr, value);
+}
+
+static inline void noc_l1_write32(uint32_t addr, uint32_t value)
+{
+    noc_mock_write(addr, value);
+}
+#else
+static inline uint32_t noc_reg_read(uint32_t addr)
+{
+    return *(volatile uint32_t*)addr;
+}
+
+static inline void noc_reg_write(uint32_t addr, uint32_t value)
+{
+    *(volatile uint32_t*)addr = value;
+}
+
+static inline void noc_l1_write32(uint32_t addr, uint32_t value)
+{
+    *(volatile uint32_t*)addr = value;
+    __asm__ volatile ("fence" ::: "memory");
+}
+#endif
+
+// One transaction, at most NOC_MAX_TRANS_SIZE bytes.  For reads the target is
+// remote and the return address local; for writes it's the other way round.
+struct noc_cmd {
+    uint32_t ctrl;
+    uint64_t targ;
+    uint32_t targ_xy;
+    uint64_t ret;
+    uint32_t ret_xy;
+    uint32_t len;
+    uint32_t tid;
+};
+
+// One transfer for the *_batch() helpers; any size.
+struct noc_xfer {
+    uint64_t remote;
+    uint32_t remote_xy;
+    uint32_t local;
+    uint32_t size;
+};
+
+// Where noc_issue() starts looking for a free command buffer, per NOC.  In
+// .bss, which nothing clears when firmware is loaded as a raw binary, so it's
+// reduced to a valid index wherever it's read.
+static uint32_t noc_next_cmd_buf[2];
+
+static inline uint32_t noc_local_xy(uint32_t noc)
+{
+    uint32_t node_id = noc_reg_read(NOC_REG(noc, 0, NOC_NODE_ID));
+    return NOC_XY(node_id & 0x3F, (node_id >> 6) & 0x3F);
+}
+
+static inline int noc_cmd_buf_ready(uint32_t noc, uint32_t buf)
+{
+    return (noc_reg_read(NOC_REG(noc, buf, NOC_CMD_CTRL)) & 1) == 0;
+}
+
+// Issue cmd on buf if it's free; 0 if it's still busy with the last one.
+static inline int noc_try_issue(uint32_t noc, uint32_t buf, const struct noc_cmd* cmd)
+{
+    if (!noc_cmd_buf_ready(noc, buf)) {
+        return 0;
+    }
+
+    noc_reg_write(NOC_REG(noc, buf, NOC_TARG_ADDR_LO), (uint32_t)cmd->targ);
+    noc_reg_write(NOC_REG(noc, buf, NOC_TARG_ADDR_MID), (uint32_t)(cmd->targ >> 32));
+    noc_reg_write(NOC_REG(noc, buf, NOC_TARG_ADDR_HI), cmd->targ_xy);
+    noc_reg_write(NOC_REG(noc, buf, NOC_RET_ADDR_LO), (uint32_t)cmd->ret);
+    noc_reg_write(NOC_REG(noc, buf, NOC_RET_ADDR_MID), (uint32_t)(cmd->ret >> 32));
+    noc_reg_write(NOC_REG(noc, buf, NOC_RET_ADDR_HI), cmd->ret_xy);
+    noc_reg_write(NOC_REG(noc, buf, NOC_AT_LEN_BE), cmd->len);
+    noc_reg_write(NOC_REG(noc, buf, NOC_AT_LEN_BE_1), 0);
+    noc_reg_write(NOC_REG(noc, buf, NOC_PACKET_TAG), NOC_PACKET_TAG_TRANSACTION_ID(cmd->tid));
+    noc_reg_write(NOC_REG(noc, buf, NOC_BRCST_EXCLUDE), 0);
+    noc_reg_write(NOC_REG(noc, buf, NOC_CTRL), cmd->ctrl);
+    noc_reg_write(NOC_REG(noc, buf, NOC_CMD_CTRL), 1);
+
+    return 1;
+}
+
+// Issue cmd on the first free command buffer, round robin; spins only while
+// every buffer is busy.
+static inline void noc_issue(uint32_t noc, const struct noc_cmd* cmd)
+{
+    for (uint32_t buf = noc_next_cmd_buf[noc] % NOC_NUM_CMD_BUFS;; buf = (buf + 1) % NOC_NUM_CMD_BUFS) {
+        if (noc_try_issue(noc, buf, cmd)) {
+            noc_next_cmd_buf[noc] = (buf + 1) % NOC_NUM_CMD_BUFS;
+            return;
+        }
+    }
+}
+
+// Every command buffer has handed its command to the NIU.
+static inline void noc_wait_issued(uint32_t noc)
+{
+    for (uint32_t buf = 0; buf < NOC_NUM_CMD_BUFS; buf++) {
+        while (!noc_cmd_buf_ready(noc, buf));
+    }
+}
+
+static inline uint32_t noc_tid_outstanding(uint32_t noc, uint32_t tid)
+{
+    return noc_reg_read(NOC_STATUS(noc, NIU_MST_REQS_OUTSTANDING_ID(tid)));
+}
+
+// Nothing issued with tid is still in flight.  Reads have landed in L1;
+// writes have been acknowledged by their destination.
+static inline int noc_tid_done(uint32_t noc, uint32_t tid)
+{
+    return noc_tid_outstanding(noc, tid) == 0;
+}
+
+static inline void noc_wait_tid(uint32_t noc, uint32_t tid)
+{
+    noc_wait_issued(noc);
+    while (!noc_tid_done(noc, tid));
+}
+
+// Remote (src_xy, src) -> local L1 dst, tagged with tid.  Returns once issued.
+static inline void noc_async_read(uint32_t noc, uint64_t src, uint32_t src_xy, uint32_t dst, uint32_t size,
+                                  uint32_t tid)
+{
+    struct noc_cmd cmd;
+
+    cmd.ctrl = NOC_CMD_RD | NOC_CMD_RESP_MARKED;
+    cmd.targ_xy = src_xy;
+    cmd.ret_xy = noc_local_xy(noc);
+    cmd.tid = tid;
+
+    while (size > 0) {
+        cmd.len = (size > NOC_MAX_TRANS_SIZE) ? NOC_MAX_TRANS_SIZE : size;
+        cmd.targ = src;
+        cmd.ret = dst;
+        noc_issue(noc, &cmd);
+        src += cmd.len;
+        dst += cmd.len;
+        size -= cmd.len;
+    }
+}
+
+// Local L1 src -> remote (dst_xy, dst), tagged with tid.  Returns once issued.
+static inline void noc_async_write(uint32_t noc, uint32_t src, uint64_t dst, uint32_t dst_xy, uint32_t size,
+                                   uint32_t tid)
+{
+    struct noc_cmd cmd;
+
+    cmd.ctrl = NOC_CMD_WR | NOC_CMD_RESP_MARKED;
+    cmd.targ_xy = noc_local_xy(noc);
+    cmd.ret_xy = dst_xy;
+    cmd.tid = tid;
+
+    while (size > 0) {
+        cmd.len = (size > NOC_MAX_TRANS_SIZE) ? NOC_MAX_TRANS_SIZE : size;
+        cmd.targ = src;
+        cmd.ret = dst;
+        noc_issue(noc, &cmd);
+        src += cmd.len;
+        dst += cmd.len;
+        size -= cmd.len;
+    }
+}
+
+static inline void noc_async_read_batch(uint32_t noc, const struct noc_xfer* xfers, uint32_t count, uint32_t tid)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        noc_async_read(noc, xfers[i].remote, xfers[i].remote_xy, xfers[i].local, xfers[i].size, tid);
+    }
+}
+
+static inline void noc_async_write_batch(uint32_t noc, const struct noc_xfer* xfers, uint32_t count, uint32_t tid)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        noc_async_write(noc, xfers[i].local, xfers[i].remote, xfers[i].remote_xy, xfers[i].size, tid);
+    }
+}
+
+// Write value to (dst_xy, dst), e.g. a tt::Completion, through the L1 word
+// at scratch.  Waits for everything already issued with tid to be
+// acknowledged first, so with the data writes on tid the value lands after
+// them.  Returns once issued; the next call on tid waits for it.
+static inline void noc_post_completion(uint32_t noc, uint32_t scratch, uint32_t value, uint64_t dst,
+                                       uint32_t dst_xy, uint32_t tid)
+{
+    noc_wait_tid(noc, tid);
+    noc_l1_write32(scratch, value);
+    noc_async_write(noc, scratch, dst, dst_xy, sizeof(uint32_t), tid);
+}
+
+#endif
@@ -0,0 +1,261 @@
+// Host-side test for noc.h against a mocked NOC register file
+//
+// Built by the top-level Makefile (make noc-test) with the host compiler and
+// -DNOC_MOCK.  The mock records every command a command buffer is started
+// with, keeps a buffer busy for a few polls after it's started, and retires
+// one outstanding transaction per poll of a transaction ID's counter.
+
+#include "noc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define MOCK_BASE       0xFFB20000
+#define MOCK_WORDS      (2 * 0x10000 / 4)
+#define MOCK_NODE_ID    NOC_XY(16, 11)
+#define MOCK_MAX_CMDS   64
+
+struct mock_cmd {
+    uint32_t noc;
+    uint32_t buf;
+    uint32_t ctrl;
+    uint64_t targ;
+    uint32_t targ_xy;
+    uint64_t ret;
+    uint32_t ret_xy;
+    uint32_t len;
+    uint32_t tid;
+};
+
+static uint32_t regs[MOCK_WORDS];
+static uint32_t busy_polls[2][NOC_NUM_CMD_BUFS];    // CMD_CTRL reads 1 until this runs out
+static uint32_t outstanding[2][NOC_NUM_TIDS];
+static uint32_t busy_after_issue;
+static struct mock_cmd cmds[MOCK_MAX_CMDS];
+static uint32_t num_cmds;
+static uint32_t l1_addr;        // Last write outside the register file
+static uint32_t l1_value;
+
+static void mock_reset(uint32_t busy)
+{
+    memset(regs, 0, sizeof(regs));
+    memset(busy_polls, 0, sizeof(busy_polls));
+    memset(outstanding, 0, sizeof(outstanding));
+    memset(noc_next_cmd_buf, 0, sizeof(noc_next_cmd_buf));
+    busy_after_issue = busy;
+    num_cmds = 0;
+    regs[(NOC_REG(0, 0, NOC_NODE_ID) - MOCK_BASE) / 4] = MOCK_NODE_ID;
+    regs[(NOC_REG(1, 0, NOC_NODE_ID) - MOCK_BASE) / 4] = MOCK_NODE_ID;
+}
+
+static uint32_t reg(uint32_t noc, uint32_t buf, uint32_t off)
+{
+    return regs[(NOC_REG(noc, buf, off) - MOCK_BASE) / 4];
+}
+
+uint32_t noc_mock_read(uint32_t addr)
+{
+    for (uint32_t noc = 0; noc < 2; noc++) {
+        for (uint32_t buf = 0; buf < NOC_NUM_CMD_BUFS; buf++) {
+            if (addr == NOC_REG(noc, buf, NOC_CMD_CTRL)) {
+                if (busy_polls[noc][buf] == 0) {
+                    return 0;
+                }
+                busy_polls[noc][buf]--;
+                return 1;
+            }
+        }
+        for (uint32_t tid = 0; tid < NOC_NUM_TIDS; tid++) {
+            if (addr == NOC_STATUS(noc, NIU_MST_REQS_OUTSTANDING_ID(tid))) {
+                uint32_t n = outstanding[noc][tid];
+                if (n > 0) {
+                    outstanding[noc][tid]--;
+                }
+                return n;
+            }
+        }
+    }
+
+    return regs[(addr - MOCK_BASE) / 4];
+}
+
+void noc_mock_write(uint32_t addr, uint32_t value)
+{
+    if (addr < MOCK_BASE || addr >= MOCK_BASE + sizeof(regs)) {
+        l1_addr = addr;
+        l1_value = value;
+        return;
+    }
+
+    regs[(addr - MOCK_BASE) / 4] = value;
+
+    for (uint32_t noc = 0; noc < 2; noc++) {
+        for (uint32_t buf = 0; buf < NOC_NUM_CMD_BUFS; buf++) {
+            if (addr != NOC_REG(noc, buf, NOC_CMD_CTRL) || value != 1 || num_cmds == MOCK_MAX_CMDS) {
+                continue;
+            }
+
+            struct mock_cmd* c = &cmds[num_cmds++];
+            c->noc = noc;
+            c->buf = buf;
+            c->ctrl = reg(noc, buf, NOC_CTRL);
+            c->targ = ((uint64_t)reg(noc, buf, NOC_TARG_ADDR_MID) << 32) | reg(noc, buf, NOC_TARG_ADDR_LO);
+            c->targ_xy = reg(noc, buf, NOC_TARG_ADDR_HI);
+            c->ret = ((uint64_t)reg(noc, buf, NOC_RET_ADDR_MID) << 32) | reg(noc, buf, NOC_RET_ADDR_LO);
+            c->ret_xy = reg(noc, buf, NOC_RET_ADDR_HI);
+            c->len = reg(noc, buf, NOC_AT_LEN_BE);
+            c->tid = reg(noc, buf, NOC_PACKET_TAG) >> 10;
+
+            busy_polls[noc][buf] = busy_after_issue;
+            outstanding[noc][c->tid]++;
+        }
+    }
+}
+
+static int failures;
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            printf("  %s:%d: %s\n", __FILE__, __LINE__, #cond);               \
+            failures++;                                                       \
+        }                                                                     \
+    } while (0)
+
+// A read bigger than one transaction is split, and the pieces go to
+// successive command buffers with the transaction ID in the packet tag.
+static void test_split_read(void)
+{
+    mock_reset(0);
+    noc_async_read(0, 0x1000, NOC_XY(17, 12), 0x20000, 2 * NOC_MAX_TRANS_SIZE + 64, 3);
+
+    CHECK(num_cmds == 3);
+    for (uint32_t i = 0; i < num_cmds; i++) {
+        CHECK(cmds[i].noc == 0);
+        CHECK(cmds[i].buf == i);
+        CHECK(cmds[i].ctrl == (NOC_CMD_RD | NOC_CMD_RESP_MARKED));
+        CHECK(cmds[i].targ == 0x1000 + i * NOC_MAX_TRANS_SIZE);
+        CHECK(cmds[i].targ_xy == NOC_XY(17, 12));
+        CHECK(cmds[i].ret == 0x20000 + i * NOC_MAX_TRANS_SIZE);
+        CHECK(cmds[i].ret_xy == MOCK_NODE_ID);
+        CHECK(cmds[i].tid == 3);
+    }
+    CHECK(cmds[2].len == 64);
+    CHECK(outstanding[0][3] == 3);
+}
+
+// Writes target the remote side through the return address, on NOC 1.
+static void test_write_noc1(void)
+{
+    mock_reset(0);
+    noc_async_write(1, 0x30000, 0x800000000ULL, NOC_XY(19, 24), 256, 5);
+
+    CHECK(num_cmds == 1);
+    CHECK(cmds[0].noc == 1);
+    CHECK(cmds[0].ctrl == (NOC_CMD_WR | NOC_CMD_RESP_MARKED));
+    CHECK(cmds[0].targ == 0x30000);
+    CHECK(cmds[0].targ_xy == MOCK_NODE_ID);
+    CHECK(cmds[0].ret == 0x800000000ULL);
+    CHECK(cmds[0].ret_xy == NOC_XY(19, 24));
+    CHECK(outstanding[1][5] == 1 && outstanding[0][5] == 0);
+}
+
+// A busy buffer is skipped rather than waited on; try_issue doesn't block.
+static void test_busy_buffer(void)
+{
+    struct noc_cmd cmd = {NOC_CMD_RD | NOC_CMD_RESP_MARKED, 0, 0, 0, 0, 64, 0};
+
+    mock_reset(0);
+    busy_polls[0][0] = 100;
+
+    CHECK(noc_try_issue(0, 0, &cmd) == 0);
+    CHECK(num_cmds == 0);
+
+    noc_issue(0, &cmd);
+    CHECK(num_cmds == 1 && cmds[0].buf == 1);
+    CHECK(busy_polls[0][0] > 90);
+}
+
+// Waiting on one transaction ID leaves the others' counters alone.
+static void test_wait_tid(void)
+{
+    mock_reset(2);
+    noc_async_read(0, 0, NOC_XY(17, 12), 0x20000, 4 * NOC_MAX_TRANS_SIZE, 1);
+    noc_async_read(0, 0, NOC_XY(17, 12), 0x40000, NOC_MAX_TRANS_SIZE, 2);
+
+    CHECK(!noc_tid_done(0, 1));
+    noc_wait_tid(0, 1);
+    CHECK(outstanding[0][1] == 0);
+    CHECK(outstanding[0][2] == 1);
+    for (uint32_t buf = 0; buf < NOC_NUM_CMD_BUFS; buf++) {
+        CHECK(noc_cmd_buf_ready(0, buf));
+    }
+}
+
+// Batches issue every transfer, each split as needed.
+static void test_batch(void)
+{
+    struct noc_xfer xfers[3] = {
+        {0x0, NOC_XY(17, 12), 0x20000, 1024},
+        {0x10000, NOC_XY(18, 12), 0x21000, NOC_MAX_TRANS_SIZE + 1024},
+        {0x20000, NOC_XY(17, 15), 0x30000, 4096},
+    };
+
+    mock_reset(1);
+    noc_async_write_batch(0, xfers, 3, 7);
+
+    CHECK(num_cmds == 4);
+    CHECK(cmds[0].ret_xy == NOC_XY(17, 12) && cmds[0].targ == 0x20000);
+    CHECK(cmds[2].ret == 0x10000 + NOC_MAX_TRANS_SIZE && cmds[2].len == 1024);
+    CHECK(cmds[3].ret_xy == NOC_XY(17, 15) && cmds[3].len == 4096);
+    CHECK(outstanding[0][7] == 4);
+}
+
+// The completion word goes out only after the data on its ID has landed.
+static void test_post_completion(void)
+{
+    mock_reset(0);
+    noc_async_write(0, 0x20000, 0x1000, NOC_XY(19, 24), 4 * NOC_MAX_TRANS_SIZE, 9);
+    noc_post_completion(0, 0x10008, 42, 0x2000, NOC_XY(19, 24), 9);
+
+    CHECK(num_cmds == 5);
+    CHECK(l1_addr == 0x10008 && l1_value == 42);
+    CHECK(cmds[4].targ == 0x10008 && cmds[4].len == 4);
+    CHECK(cmds[4].ret == 0x2000 && cmds[4].ret_xy == NOC_XY(19, 24));
+    CHECK(outstanding[0][9] == 1);
+}
+
+// Firmware loaded as a raw binary starts with whatever was in L1 where .bss
+// is; the first command must still go to a real command buffer.
+static void test_uninitialised_state(void)
+{
+    struct noc_cmd cmd = {NOC_CMD_RD | NOC_CMD_RESP_MARKED, 0, 0, 0, 0, 64, 0};
+
+    mock_reset(0);
+    noc_next_cmd_buf[0] = 0xDEADBEEF;
+    l1_addr = 0;
+
+    noc_issue(0, &cmd);
+    CHECK(num_cmds == 1 && cmds[0].buf == 0xDEADBEEF % NOC_NUM_CMD_BUFS);
+    CHECK(l1_addr == 0);
+    CHECK(noc_next_cmd_buf[0] < NOC_NUM_CMD_BUFS);
+}
+
+int main(void)
+{
+    test_split_read();
+    test_write_noc1();
+    test_busy_buffer();
+    test_wait_tid();
+    test_batch();
+    test_post_completion();
+    test_uninitialised_state();
+
+    if (failures) {
+        printf("NOC library test FAILED (%d checks)\n", failures);
+        return 1;
+    }
+
+    printf("NOC library test PASSED\n");
+    return 0;
+}
@@ -22,6 +22,11 @@
 //    TENSTORRENT_IOCTL_PIN_PAGES ioctl. Because this memory is cached by the
 //    CPU, this test will FAIL on non-coherent platforms.
 //
+// After each test, the program measures throughput for the buffer: CPU writes
+// and reads (uncached driver memory is much slower on non-coherent hosts) and
+// NOC writes into it from the device side.  A table comparing the two buffer
+// types is printed at the end.
+//
 // HOW TO BUILD:
 // =============
 // g++ -O2 -Wall io_coherency.cpp -o io_coherency
@@ -42,6 +47,8 @@
 #include <algorithm>
 #include <memory>
 #include <unordered_set>
+#include <chrono>
+#include <cstdio>
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -365,6 +372,15 @@ void fill_with_random_data(void* ptr, size_t bytes);
 bool get_pcie_coords(int fd, uint16_t& out_x, uint16_t& out_y);
 bool noc_write(int fd, uint16_t x, uint16_t y, uint64_t dest_addr, const void* src, size_t len);
 bool run_test(const std::string& test_name, int dev_fd, size_t buffer_size, void* user_mem, uint64_t noc_addr);
+void measure_throughput(const std::string& test_name, int dev_fd, size_t buffer_size, void* mem, uint64_t noc_addr);
+
+struct Throughput {
+    std::string name;
+    double cpu_write_mibs;
+    double cpu_read_mibs;
+    double noc_write_mibs;
+};
+static std::vector<Throughput> throughputs;
 
 
 /**
@@ -402,6 +418,7 @@ bool test_with_driver_allocated_buffer(int dev_fd, size_t buffer_size) {
     } else {
         // 3. Run the core test logic.
         success = run_test("Driver-Allocated", dev_fd, allocated_size, mapped_dma_buf, noc_target_addr);
+        measure_throughput("Driver-Allocated", dev_fd, allocated_size, mapped_dma_buf, noc_target_addr);
         munmap(mapped_dma_buf, allocated_size);
     }
 
@@ -451,6 +468,7 @@ bool test_with_user_pinned_buffer(int dev_fd, size_t buffer_size) {
 
     // 3. Run the core test logic.
     success = run_test("User-Pinned", dev_fd, aligned_size, user_mem, noc_target_addr);
+    measure_throughput("User-Pinned", dev_fd, aligned_size, user_mem, noc_target_addr);
 
     // 4. Unpin the memory.
     tenstorrent_unpin_pages unpin_cmd = {};
@@ -491,6 +509,15 @@ int main(int argc, char* argv[]) {
         bool driver_alloc_ok = test_with_driver_allocated_buffer(dev_fd, buffer_size);
         bool user_pinned_ok = test_with_user_pinned_buffer(dev_fd, buffer_size);
 
+        if (!throughputs.empty()) {
+            std::cout << "\n--- Throughput (MiB/s) ---" << std::endl;
+            printf("  %-18s %12s %12s %12s\n", "buffer", "CPU write", "CPU read", "NOC write");
+            for (const Throughput& t : throughputs) {
+                printf("  %-18s %12.1f %12.1f %12.1f\n", t.name.c_str(), t.cpu_write_mibs, t.cpu_read_mibs,
+                       t.noc_write_mibs);
+            }
+        }
+
         if (driver_alloc_ok && user_pinned_ok) {
             std::cout << "\n********************************" << std::endl;
             std::cout <<   "*** ALL TESTS PASSED         ***" << std::endl;
@@ -626,6 +653,53 @@ bool run_test(const std::string& test_name, int dev_fd, size_t buffer_size, void
 
 
 
+/**
+ * @brief Times CPU writes and reads of the buffer, and NOC writes into it.
+ * Results are added to the table printed at the end.
+ */
+void measure_throughput(const std::string& test_name, int dev_fd, size_t buffer_size, void* mem, uint64_t noc_addr) {
+    using clock = std::chrono::steady_clock;
+    const int reps = 16;
+    const double mib = (double)buffer_size * reps / (1024.0 * 1024.0);
+    volatile uint64_t* p = static_cast<volatile uint64_t*>(mem);
+    const size_t nwords = buffer_size / sizeof(uint64_t);
+    uint64_t sum = 0;
+
+    auto t0 = clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (size_t i = 0; i < nwords; i++) {
+            p[i] = i;
+        }
+    }
+    auto t1 = clock::now();
+    for (int r = 0; r < reps; r++) {
+        for (size_t i = 0; i < nwords; i++) {
+            sum += p[i];
+        }
+    }
+    auto t2 = clock::now();
+    (void)sum;
+
+    uint16_t pcie_x, pcie_y;
+    double noc_mibs = 0;
+    std::vector<uint8_t> source(buffer_size);
+    fill_with_random_data(source.data(), buffer_size);
+    if (get_pcie_coords(dev_fd, pcie_x, pcie_y)) {
+        auto t3 = clock::now();
+        bool ok = true;
+        for (int r = 0; r < reps && ok; r++) {
+            ok = noc_write(dev_fd, pcie_x, pcie_y, noc_addr, source.data(), buffer_size);
+        }
+        auto t4 = clock::now();
+        if (ok) {
+            noc_mibs = mib / std::chrono::duration<double>(t4 - t3).count();
+        }
+    }
+
+    throughputs.push_back({test_name, mib / std::chrono::duration<double>(t1 - t0).count(),
+                           mib / std::chrono::duration<double>(t2 - t1).count(), noc_mibs});
+}
+
 /**
  * @brief Fills a memory buffer with pseudorandom data.
  */